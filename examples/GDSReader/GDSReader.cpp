@@ -33,13 +33,10 @@ int main(int argc, char **argv) {
 
   geometry->insertNextLevelSet(plane);
 
-  auto layer0 =
-      mask->layerToLevelSet(0 /*layer*/, 0 /*base z position*/, 0.1 /*height*/);
-  geometry->insertNextLevelSet(layer0);
-
-  auto layer1 = mask->layerToLevelSet(1 /*layer*/, -0.15 /*base z position*/,
-                                      0.45 /*height*/);
-  geometry->insertNextLevelSet(layer1);
+  // extract both layers at once: {layer, base z position, height}
+  auto layers = mask->layersToLevelSets({{0, 0., 0.1}, {1, -0.15, 0.45}});
+  for (auto &layer : layers)
+    geometry->insertNextLevelSet(layer);
 
   geometry->saveSurfaceMesh("Geometry.vtp", true /* add material IDs */);
 
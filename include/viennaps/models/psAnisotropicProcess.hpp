@@ -23,7 +23,9 @@ class AnisotropicVelocityField : public VelocityField<NumericType> {
   const NumericType r110;
   const NumericType r111;
   const NumericType r311;
-  const std::vector<std::pair<Material, NumericType>> &materials;
+  // rates of the epitaxy materials
+  MaterialTable<NumericType> materialRates;
+  MaterialMask epitaxyMaterials;
 
 public:
   AnisotropicVelocityField(
@@ -32,8 +34,15 @@ public:
       const NumericType passedR110, const NumericType passedR111,
       const NumericType passedR311,
       const std::vector<std::pair<Material, NumericType>> &passedmaterials)
-      : r100(passedR100), r110(passedR110), r111(passedR111), r311(passedR311),
-        materials(passedmaterials) {
+      : r100(passedR100), r110(passedR110), r111(passedR111),
+        r311(passedR311) {
+    // the first entry of a material is used
+    for (const auto &[material, rate] : passedmaterials) {
+      if (!epitaxyMaterials.contains(material)) {
+        epitaxyMaterials.insert(material);
+        materialRates.set(material, rate);
+      }
+    }
 
     directions[0] = Normalize(direction100);
     directions[1] = Normalize(direction010);
@@ -47,49 +56,64 @@ public:
   NumericType getScalarVelocity(const Vec3D<NumericType> & /*coordinate*/,
                                 int material, const Vec3D<NumericType> &nv,
                                 unsigned long /*pointID*/) override {
-    for (auto epitaxyMaterial : materials) {
-      if (MaterialMap::isMaterial(material, epitaxyMaterial.first)) {
-        if (std::abs(Norm(nv) - 1.) > 1e-4)
-          return 0.;
-
-        Vec3D<NumericType> normalVector;
-        normalVector[0] = nv[0];
-        normalVector[1] = nv[1];
-        if (D == 3) {
-          normalVector[2] = nv[2];
-        } else {
-          normalVector[2] = 0;
-        }
-        Normalize(normalVector);
-
-        Vec3D<NumericType> N;
-        for (int i = 0; i < 3; i++) {
-          N[i] = std::fabs(DotProduct(directions[i], normalVector));
-        }
-        std::sort(N.begin(), N.end(), std::greater<NumericType>());
-
-        NumericType velocity;
-        if (DotProduct(N, Vec3D<NumericType>{-1., 1., 2.}) < 0) {
-          velocity = (r100 * (N[0] - N[1] - 2 * N[2]) + r110 * (N[1] - N[2]) +
-                      3 * r311 * N[2]) /
-                     N[0];
-        } else {
-          velocity = (r111 * ((N[1] - N[0]) * 0.5 + N[2]) +
-                      r110 * (N[1] - N[2]) + 1.5 * r311 * (N[0] - N[1])) /
-                     N[0];
-        }
-
-        return velocity * epitaxyMaterial.second;
-      }
-    }
-
+    const int idx = MaterialMap::getIndex(material);
     // not an epitaxy material
-    return 0.;
+    if (!epitaxyMaterials.testIndex(idx))
+      return 0.;
+
+    return calculateVelocity(nv) * materialRates.atIndex(idx);
+  }
+
+  void getScalarVelocities(const std::vector<Vec3D<NumericType>> &coordinates,
+                           const std::vector<int> &pointMaterials,
+                           const std::vector<Vec3D<NumericType>> &normalVectors,
+                           const std::vector<unsigned long> &,
+                           std::vector<NumericType> &velocities) override {
+    velocities.resize(coordinates.size());
+    for (std::size_t i = 0; i < coordinates.size(); ++i) {
+      const int idx = MaterialMap::getIndex(pointMaterials[i]);
+      velocities[i] = epitaxyMaterials.testIndex(idx)
+                          ? calculateVelocity(normalVectors[i]) *
+                                materialRates.atIndex(idx)
+                          : 0.;
+    }
   }
 
   // the translation field should be disabled when using a surface model
   // which only depends on an analytic velocity field
   int getTranslationFieldOptions() const override { return 0; }
+
+private:
+  NumericType calculateVelocity(const Vec3D<NumericType> &nv) const {
+    if (std::abs(Norm(nv) - 1.) > 1e-4)
+      return 0.;
+
+    Vec3D<NumericType> normalVector;
+    normalVector[0] = nv[0];
+    normalVector[1] = nv[1];
+    if (D == 3) {
+      normalVector[2] = nv[2];
+    } else {
+      normalVector[2] = 0;
+    }
+    Normalize(normalVector);
+
+    Vec3D<NumericType> N;
+    for (int i = 0; i < 3; i++) {
+      N[i] = std::fabs(DotProduct(directions[i], normalVector));
+    }
+    std::sort(N.begin(), N.end(), std::greater<NumericType>());
+
+    if (DotProduct(N, Vec3D<NumericType>{-1., 1., 2.}) < 0) {
+      return (r100 * (N[0] - N[1] - 2 * N[2]) + r110 * (N[1] - N[2]) +
+              3 * r311 * N[2]) /
+             N[0];
+    } else {
+      return (r111 * ((N[1] - N[0]) * 0.5 + N[2]) + r110 * (N[1] - N[2]) +
+              1.5 * r311 * (N[0] - N[1])) /
+             N[0];
+    }
+  }
 };
 } // namespace impl
 
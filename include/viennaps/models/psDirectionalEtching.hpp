@@ -15,13 +15,13 @@ class DirectionalEtchVelocityField : public VelocityField<NumericType> {
   const Vec3D<NumericType> direction_;
   const NumericType directionalVelocity_;
   const NumericType isotropicVelocity_;
-  const std::vector<int> maskMaterials_;
+  const MaterialMask maskMaterials_;
 
 public:
   DirectionalEtchVelocityField(Vec3D<NumericType> direction,
                                const NumericType directionalVelocity,
                                const NumericType isotropicVelocity,
-                               const std::vector<int> &mask)
+                               const MaterialMask &mask)
       : direction_(direction), directionalVelocity_(directionalVelocity),
         isotropicVelocity_(isotropicVelocity), maskMaterials_(mask) {}
 
@@ -29,18 +29,26 @@ public:
                                        int material,
                                        const Vec3D<NumericType> &normalVector,
                                        unsigned long) override {
-    if (isMaskMaterial(material)) {
+    if (maskMaterials_.test(material)) {
       return {0.};
     } else {
-      auto rate = direction_;
-      for (int i = 0; i < D; ++i) {
-        if (rate[i] == 0.) {
-          rate[i] -= isotropicVelocity_ * (normalVector[i] < 0 ? -1 : 1);
-        } else {
-          rate[i] *= directionalVelocity_;
-        }
+      return calculateVelocity(normalVector);
+    }
+  }
+
+  void
+  getVectorVelocities(const std::vector<Vec3D<NumericType>> &coordinates,
+                      const std::vector<int> &materials,
+                      const std::vector<Vec3D<NumericType>> &normalVectors,
+                      const std::vector<unsigned long> &,
+                      std::vector<Vec3D<NumericType>> &velocities) override {
+    velocities.resize(coordinates.size());
+    for (std::size_t i = 0; i < coordinates.size(); ++i) {
+      if (maskMaterials_.test(materials[i])) {
+        velocities[i] = {0.};
+      } else {
+        velocities[i] = calculateVelocity(normalVectors[i]);
       }
-      return rate;
     }
   }
 
@@ -49,12 +57,17 @@ public:
   int getTranslationFieldOptions() const override { return 0; }
 
 private:
-  bool isMaskMaterial(const int material) const {
-    for (const auto &mat : maskMaterials_) {
-      if (material == mat)
-        return true;
+  Vec3D<NumericType>
+  calculateVelocity(const Vec3D<NumericType> &normalVector) const {
+    auto rate = direction_;
+    for (int i = 0; i < D; ++i) {
+      if (rate[i] == 0.) {
+        rate[i] -= isotropicVelocity_ * (normalVector[i] < 0 ? -1 : 1);
+      } else {
+        rate[i] *= directionalVelocity_;
+      }
     }
-    return false;
+    return rate;
   }
 };
 } // namespace impl
@@ -71,11 +84,10 @@ public:
     auto surfModel = SmartPointer<SurfaceModel<NumericType>>::New();
 
     // velocity field
-    std::vector<int> maskMaterialsInt = {static_cast<int>(mask)};
     auto velField =
         SmartPointer<impl::DirectionalEtchVelocityField<NumericType, D>>::New(
             direction, directionalVelocity, isotropicVelocity,
-            maskMaterialsInt);
+            MaterialMask{mask});
 
     this->setSurfaceModel(surfModel);
     this->setVelocityField(velField);
@@ -89,15 +101,11 @@ public:
     // default surface model
     auto surfModel = SmartPointer<SurfaceModel<NumericType>>::New();
 
-    std::vector<int> maskMaterialsInt;
-    for (const auto &mat : maskMaterials) {
-      maskMaterialsInt.push_back(static_cast<int>(mat));
-    }
     // velocity field
     auto velField =
         SmartPointer<impl::DirectionalEtchVelocityField<NumericType, D>>::New(
             direction, directionalVelocity, isotropicVelocity,
-            maskMaterialsInt);
+            MaterialMask(maskMaterials));
 
     this->setSurfaceModel(surfModel);
     this->setVelocityField(velField);
@@ -2,8 +2,10 @@
 
 #include <cmath>
 
+#include "../psIonEnergyAngleDistribution.hpp"
 #include "../psMaterials.hpp"
 #include "../psProcessModel.hpp"
+#include "psIonTables.hpp"
 
 #include <rayParticle.hpp>
 #include <rayReflection.hpp>
@@ -156,188 +158,173 @@ public:
     const auto numPoints = materialIds.size();
     std::vector<NumericType> etchRate(numPoints, 0.);
 
-    auto ionEnhancedRate = rates->getScalarData("ionEnhancedRate");
-    auto ionSputteringRate = rates->getScalarData("ionSputteringRate");
-    auto ionpeRate = rates->getScalarData("ionpeRate");
-    auto polyRate = rates->getScalarData("polyRate");
+    // the data is fetched after the insertion, which might move the vectors
     rates->insertNextScalarData(etchRate, "F_ev");
-    auto F_ev_rate = rates->getScalarData("F_ev");
+    auto *F_ev_rate = rates->getScalarData("F_ev")->data();
+    const auto *ionpeRate = rates->getScalarData("ionpeRate")->data();
+    const auto *polyRate = rates->getScalarData("polyRate")->data();
+    auto *ionEnhancedRate = rates->getScalarData("ionEnhancedRate")->data();
+    auto *ionSputteringRate = rates->getScalarData("ionSputteringRate")->data();
 
-    const auto eCoverage = coverages->getScalarData("eCoverage");
-    const auto pCoverage = coverages->getScalarData("pCoverage");
-    const auto peCoverage = coverages->getScalarData("peCoverage");
+    const auto *eCoverage = coverages->getScalarData("eCoverage")->data();
+    const auto *pCoverage = coverages->getScalarData("pCoverage")->data();
+    const auto *peCoverage = coverages->getScalarData("peCoverage")->data();
 
     bool etchStop = false;
+#pragma omp parallel for reduction(|| : etchStop)
+    for (long i = 0; i < static_cast<long>(numPoints); ++i)
+      etchStop = etchStop || coordinates[i][D - 1] <= p.etchStopDepth;
 
-    // calculate etch rates
-    for (std::size_t i = 0; i < numPoints; ++i) {
-      if (coordinates[i][D - 1] <= p.etchStopDepth) {
-        etchStop = true;
-        break;
-      }
-
-      auto matId = MaterialMap::mapToMaterial(materialIds[i]);
-      if (matId == Material::Mask) {
-        etchRate[i] = (-1. / p.Mask.rho) * ionSputteringRate->at(i) * p.ionFlux;
-      } else if (pCoverage->at(i) >= 1.) {
-        // Deposition
-        etchRate[i] =
-            (1 / p.Polymer.rho) *
-            std::max((polyRate->at(i) * p.polyFlux * p.beta_p -
-                      ionpeRate->at(i) * p.ionFlux * peCoverage->at(i)),
-                     (NumericType)0);
-        assert(etchRate[i] >= 0 && "Negative deposition");
-      } else if (matId == Material::Polymer) {
-        // Etching depo layer
-        etchRate[i] =
-            std::min((1 / p.Polymer.rho) *
-                         (polyRate->at(i) * p.polyFlux * p.beta_p -
-                          ionpeRate->at(i) * p.ionFlux * peCoverage->at(i)),
-                     (NumericType)0);
-      } else {
-        NumericType density = 1.;
-        NumericType F_ev = 0.;
-        switch (matId) {
-        case Material::Si: {
-
-          density = -p.Si.rho;
-          F_ev = p.Si.K * p.etchantFlux *
-                 std::exp(-p.Si.E_a / (FluorocarbonParameters<NumericType>::kB *
-                                       p.temperature));
-          break;
-        }
-        case Material::SiO2: {
-
-          F_ev =
-              p.SiO2.K * p.etchantFlux *
-              std::exp(-p.SiO2.E_a / (FluorocarbonParameters<NumericType>::kB *
-                                      p.temperature));
-          density = -p.SiO2.rho;
-          break;
-        }
-        case Material::Si3N4: {
-
-          F_ev =
-              p.Si3N4.K * p.etchantFlux *
-              std::exp(-p.Si3N4.E_a / (FluorocarbonParameters<NumericType>::kB *
-                                       p.temperature));
-          density = -p.Si3N4.rho;
-          break;
-        }
-        default:
-          break;
-        }
-
-        etchRate[i] =
-            (1 / density) *
-            (F_ev * eCoverage->at(i) +
-             ionEnhancedRate->at(i) * p.ionFlux * eCoverage->at(i) +
-             ionSputteringRate->at(i) * p.ionFlux * (1. - eCoverage->at(i)));
-
-        F_ev_rate->at(i) = F_ev * eCoverage->at(i);
-        ionSputteringRate->at(i) =
-            ionSputteringRate->at(i) * p.ionFlux * (1. - eCoverage->at(i));
-        ionEnhancedRate->at(i) =
-            ionEnhancedRate->at(i) * p.ionFlux * eCoverage->at(i);
-      }
-
-      // etch rate is in nm / s
+    if (etchStop) {
+      Logger::getInstance().addInfo("Etch stop depth reached.").print();
+      return SmartPointer<std::vector<NumericType>>::New(std::move(etchRate));
+    }
 
-      assert(!std::isnan(etchRate[i]) && "etchRate NaN");
+    const auto F_ev = getEvaporationTable();
+    MaterialTable<NumericType> invDensity(1.);
+    invDensity.set(Material::Si, -1 / p.Si.rho);
+    invDensity.set(Material::SiO2, -1 / p.SiO2.rho);
+    invDensity.set(Material::Si3N4, -1 / p.Si3N4.rho);
+    const MaterialMask isMask{Material::Mask};
+    const MaterialMask isPolymer{Material::Polymer};
+
+    const auto *matIds = materialIds.data();
+    auto *rate = etchRate.data();
+    const NumericType ionFlux = p.ionFlux;
+    const NumericType polyFactor = p.polyFlux * p.beta_p;
+    const NumericType invMaskDensity = -1 / p.Mask.rho;
+    const NumericType invPolymerDensity = 1 / p.Polymer.rho;
+
+    // All cases are evaluated for every point and the result is selected by
+    // the material and the polymer coverage, which keeps the loop free of
+    // branches. Etch rates are in nm / s.
+#pragma omp parallel for simd
+    for (long i = 0; i < static_cast<long>(numPoints); ++i) {
+      const int m = MaterialMap::getIndex(matIds[i]);
+      const bool mask = isMask.testIndex(m);
+      const bool deposition = !mask && pCoverage[i] >= 1.;
+      const bool polymer = !mask && !deposition && isPolymer.testIndex(m);
+      const bool substrate = !mask && !deposition && !polymer;
+
+      const NumericType polymerRate =
+          invPolymerDensity * (polyRate[i] * polyFactor -
+                               ionpeRate[i] * ionFlux * peCoverage[i]);
+      const NumericType evaporation = F_ev.atIndex(m) * eCoverage[i];
+      const NumericType sputtering =
+          ionSputteringRate[i] * ionFlux * (1. - eCoverage[i]);
+      const NumericType enhanced = ionEnhancedRate[i] * ionFlux * eCoverage[i];
+
+      NumericType r =
+          invDensity.atIndex(m) * (evaporation + enhanced + sputtering);
+      r = polymer ? std::min(polymerRate, NumericType(0)) : r;
+      r = deposition ? std::max(polymerRate, NumericType(0)) : r;
+      r = mask ? invMaskDensity * ionSputteringRate[i] * ionFlux : r;
+      rate[i] = r;
+
+      F_ev_rate[i] = substrate ? evaporation : NumericType(0);
+      ionSputteringRate[i] = substrate ? sputtering : ionSputteringRate[i];
+      ionEnhancedRate[i] = substrate ? enhanced : ionEnhancedRate[i];
     }
 
-    if (etchStop) {
-      std::fill(etchRate.begin(), etchRate.end(), 0.);
-      Logger::getInstance().addInfo("Etch stop depth reached.").print();
+#ifndef NDEBUG
+    for (std::size_t i = 0; i < numPoints; ++i) {
+      assert(!std::isnan(etchRate[i]) && "etchRate NaN");
+      assert((isMask.test(matIds[i]) || pCoverage[i] < 1. ||
+              etchRate[i] >= 0) &&
+             "Negative deposition");
     }
+#endif
 
-    return SmartPointer<std::vector<NumericType>>::New(etchRate);
+    return SmartPointer<std::vector<NumericType>>::New(std::move(etchRate));
   }
 
   void updateCoverages(SmartPointer<viennals::PointData<NumericType>> rates,
                        const std::vector<NumericType> &materialIds) override {
 
-    const auto ionEnhancedRate = rates->getScalarData("ionEnhancedRate");
-    const auto ionpeRate = rates->getScalarData("ionpeRate");
-    const auto polyRate = rates->getScalarData("polyRate");
-    const auto etchantRate = rates->getScalarData("etchantRate");
-
-    const auto eCoverage = coverages->getScalarData("eCoverage");
-    const auto pCoverage = coverages->getScalarData("pCoverage");
-    const auto peCoverage = coverages->getScalarData("peCoverage");
+    const auto *ionEnhancedRate =
+        rates->getScalarData("ionEnhancedRate")->data();
+    const auto *ionpeRate = rates->getScalarData("ionpeRate")->data();
+    const auto *polyRate = rates->getScalarData("polyRate")->data();
+    const auto etchantRateData = rates->getScalarData("etchantRate");
+    const auto *etchantRate = etchantRateData->data();
 
     // update coverages based on fluxes
-    const auto numPoints = ionEnhancedRate->size();
-    eCoverage->resize(numPoints);
-    pCoverage->resize(numPoints);
-    peCoverage->resize(numPoints);
-
-    // pe coverage
-    for (std::size_t i = 0; i < numPoints; ++i) {
-      if (etchantRate->at(i) == 0.) {
-        peCoverage->at(i) = 0.;
-      } else {
-        peCoverage->at(i) = (etchantRate->at(i) * p.etchantFlux * p.beta_pe) /
-                            (etchantRate->at(i) * p.etchantFlux * p.beta_pe +
-                             ionpeRate->at(i) * p.ionFlux);
-      }
-      assert(!std::isnan(peCoverage->at(i)) && "peCoverage NaN");
+    const auto numPoints = etchantRateData->size();
+    auto eCoverageData = coverages->getScalarData("eCoverage");
+    auto pCoverageData = coverages->getScalarData("pCoverage");
+    auto peCoverageData = coverages->getScalarData("peCoverage");
+    eCoverageData->resize(numPoints);
+    pCoverageData->resize(numPoints);
+    peCoverageData->resize(numPoints);
+    auto *eCoverage = eCoverageData->data();
+    auto *pCoverage = pCoverageData->data();
+    auto *peCoverage = peCoverageData->data();
+
+    const auto F_ev = getEvaporationTable();
+    const auto *matIds = materialIds.data();
+    const NumericType ionFlux = p.ionFlux;
+    const NumericType peFactor = p.etchantFlux * p.beta_pe;
+    const NumericType polyFactor = p.polyFlux * p.beta_p;
+    const NumericType etchantFactor = p.etchantFlux * p.beta_e;
+    const NumericType k_ie = p.k_ie;
+    const NumericType k_ev = p.k_ev;
+    const NumericType delta_p = p.delta_p;
+
+    // The coverages are computed unconditionally and selected afterwards,
+    // which keeps the loop free of branches.
+#pragma omp parallel for simd
+    for (long i = 0; i < static_cast<long>(numPoints); ++i) {
+      const int m = MaterialMap::getIndex(matIds[i]);
+      const NumericType etchant = etchantRate[i] * etchantFactor;
+
+      // pe coverage
+      const NumericType pe =
+          etchantRate[i] * peFactor /
+          (etchantRate[i] * peFactor + ionpeRate[i] * ionFlux);
+      const NumericType peCov = etchantRate[i] == 0. ? NumericType(0) : pe;
+
+      // polymer coverage
+      const NumericType pc = polyRate[i] * polyFactor /
+                             (ionpeRate[i] * ionFlux * peCov + delta_p);
+      NumericType pCov =
+          (peCov < eps || ionpeRate[i] < eps) ? NumericType(1) : pc;
+      pCov = polyRate[i] < eps ? NumericType(0) : pCov;
+
+      // etchant coverage
+      const NumericType e =
+          etchant * (1. - pCov) /
+          (k_ie * ionEnhancedRate[i] * ionFlux + k_ev * F_ev.atIndex(m) +
+           etchant);
+      const bool covered = pCov >= 1. || etchantRate[i] == 0.;
+
+      peCoverage[i] = peCov;
+      pCoverage[i] = pCov;
+      eCoverage[i] = covered ? NumericType(0) : e;
     }
 
-    // polymer coverage
+#ifndef NDEBUG
     for (std::size_t i = 0; i < numPoints; ++i) {
-      if (polyRate->at(i) < eps) {
-        pCoverage->at(i) = 0.;
-      } else if (peCoverage->at(i) < eps || ionpeRate->at(i) < eps) {
-        pCoverage->at(i) = 1.;
-      } else {
-        pCoverage->at(i) =
-            (polyRate->at(i) * p.polyFlux * p.beta_p) /
-            (ionpeRate->at(i) * p.ionFlux * peCoverage->at(i) + p.delta_p);
-      }
-      assert(!std::isnan(pCoverage->at(i)) && "pCoverage NaN");
+      assert(!std::isnan(peCoverage[i]) && "peCoverage NaN");
+      assert(!std::isnan(pCoverage[i]) && "pCoverage NaN");
+      assert(!std::isnan(eCoverage[i]) && "eCoverage NaN");
     }
+#endif
+  }
 
-    // etchant coverage
-    for (std::size_t i = 0; i < numPoints; ++i) {
-      if (pCoverage->at(i) < 1.) {
-        if (etchantRate->at(i) == 0.) {
-          eCoverage->at(i) = 0;
-        } else {
-          NumericType F_ev = 0.;
-          switch (MaterialMap::mapToMaterial(materialIds[i])) {
-          case Material::Si:
-            F_ev =
-                p.Si.K * p.etchantFlux *
-                std::exp(-p.Si.E_a / (FluorocarbonParameters<NumericType>::kB *
-                                      p.temperature));
-            break;
-          case Material::SiO2:
-            F_ev = p.SiO2.K * p.etchantFlux *
-                   std::exp(-p.SiO2.E_a /
-                            (FluorocarbonParameters<NumericType>::kB *
-                             p.temperature));
-            break;
-          case Material::Si3N4:
-            F_ev = p.Si3N4.K * p.etchantFlux *
-                   std::exp(-p.Si3N4.E_a /
-                            (FluorocarbonParameters<NumericType>::kB *
-                             p.temperature));
-            break;
-          default:
-            F_ev = 0.;
-          }
-          eCoverage->at(i) =
-              (etchantRate->at(i) * p.etchantFlux * p.beta_e *
-               (1. - pCoverage->at(i))) /
-              (p.k_ie * ionEnhancedRate->at(i) * p.ionFlux + p.k_ev * F_ev +
-               etchantRate->at(i) * p.etchantFlux * p.beta_e);
-        }
-      } else {
-        eCoverage->at(i) = 0.;
-      }
-      assert(!std::isnan(eCoverage->at(i)) && "eCoverage NaN");
-    }
+private:
+  // Thermal etching rate of the materials. The Arrhenius factors only depend
+  // on the parameters, so they are evaluated once per call instead of once
+  // per point.
+  MaterialTable<NumericType> getEvaporationTable() const {
+    const NumericType kT =
+        FluorocarbonParameters<NumericType>::kB * p.temperature;
+    MaterialTable<NumericType> F_ev(0.);
+    F_ev.set(Material::Si, p.Si.K * p.etchantFlux * std::exp(-p.Si.E_a / kT));
+    F_ev.set(Material::SiO2,
+             p.SiO2.K * p.etchantFlux * std::exp(-p.SiO2.E_a / kT));
+    F_ev.set(Material::Si3N4,
+             p.Si3N4.K * p.etchantFlux * std::exp(-p.Si3N4.E_a / kT));
+    return F_ev;
   }
 };
 
@@ -345,21 +332,46 @@ template <typename NumericType, int D>
 class FluorocarbonIon
     : public viennaray::Particle<FluorocarbonIon<NumericType, D>, NumericType> {
   const FluorocarbonParameters<NumericType> &p;
+  SmartPointer<IonEnergyAngleDistribution<NumericType>> distribution;
   const NumericType A;
   const NumericType minEnergy;
+  const IonReflectionTable<NumericType> reflection;
+  IonYieldTable<NumericType> yields;
+  const NumericType sqrtEthPolymer;
   NumericType E;
+  SourceEnergy<NumericType> sourceEnergy;
 
 public:
-  FluorocarbonIon(const FluorocarbonParameters<NumericType> &parameters)
-      : p(parameters),
+  FluorocarbonIon(const FluorocarbonParameters<NumericType> &parameters,
+                  SmartPointer<IonEnergyAngleDistribution<NumericType>>
+                      pDistribution = nullptr)
+      : p(parameters), distribution(pDistribution),
         A(1. / (1. + p.Ions.n_l * (M_PI_2 / p.Ions.inflectAngle - 1.))),
-        minEnergy(std::min({p.Si.Eth_ie, p.SiO2.Eth_ie, p.Si3N4.Eth_ie})) {}
+        minEnergy(std::min({p.Si.Eth_ie, p.SiO2.Eth_ie, p.Si3N4.Eth_ie})),
+        reflection(A, p.Ions.inflectAngle, p.Ions.n_l),
+        sqrtEthPolymer(std::sqrt(p.Polymer.Eth_ie)) {
+    yields.setMaterial(Material::Si, p.Si.A_sp, p.Si.B_sp, p.Si.Eth_sp,
+                       p.Si.A_ie, p.Si.Eth_ie);
+    yields.setMaterial(Material::SiO2, p.SiO2.A_sp, p.SiO2.B_sp, p.SiO2.Eth_sp,
+                       p.SiO2.A_ie, p.SiO2.Eth_ie);
+    yields.setMaterial(Material::Si3N4, p.Si3N4.A_sp, p.Si3N4.B_sp,
+                       p.Si3N4.Eth_sp, p.Si3N4.A_ie, p.Si3N4.Eth_ie);
+    yields.setMaterial(Material::Polymer, p.Polymer.A_ie, 1., p.Polymer.Eth_ie,
+                       p.Polymer.A_ie, p.Polymer.Eth_ie);
+  }
+
+  // The tables are rebuilt for every copy the ray tracer makes, so changes of
+  // the parameters after the model was created are picked up.
+  FluorocarbonIon(const FluorocarbonIon &other)
+      : FluorocarbonIon(other.p, other.distribution) {}
+
   void surfaceCollision(NumericType rayWeight, const Vec3D<NumericType> &rayDir,
                         const Vec3D<NumericType> &geomNormal,
                         const unsigned int primID, const int materialId,
                         viennaray::TracingData<NumericType> &localData,
                         const viennaray::TracingData<NumericType> *globalData,
                         RNG &) override final {
+    sourceEnergy.update(E);
     // collect data for this hit
     assert(primID < localData.getVectorData(0).size() && "id out of bounds");
     assert(E >= 0 && "Negative energy ion");
@@ -369,63 +381,21 @@ public:
     assert(cosTheta >= 0 && "Hit backside of disc");
     assert(cosTheta <= 1 + 4 && "Error in calculating cos theta");
 
-    NumericType A_sp = 0.;
-    NumericType B_sp = 1.;
-    NumericType A_ie = 0.;
-    NumericType Eth_sp = 1.;
-    NumericType Eth_ie = 1.;
-    switch (MaterialMap::mapToMaterial(materialId)) {
-    case Material::Si:
-      A_sp = p.Si.A_sp;
-      B_sp = p.Si.B_sp;
-      A_ie = p.Si.A_ie;
-      Eth_sp = p.Si.Eth_sp;
-      Eth_ie = p.Si.Eth_ie;
-      break;
-    case Material::SiO2:
-      A_sp = p.SiO2.A_sp;
-      B_sp = p.SiO2.B_sp;
-      A_ie = p.SiO2.A_ie;
-      Eth_sp = p.SiO2.Eth_sp;
-      Eth_ie = p.SiO2.Eth_ie;
-      break;
-    case Material::Si3N4:
-      A_sp = p.Si3N4.A_sp;
-      B_sp = p.Si3N4.B_sp;
-      A_ie = p.Si3N4.A_ie;
-      Eth_sp = p.Si3N4.Eth_sp;
-      Eth_ie = p.Si3N4.Eth_ie;
-      break;
-    case Material::Polymer:
-      A_sp = p.Polymer.A_ie;
-      B_sp = 1.;
-      A_ie = p.Polymer.A_ie;
-      Eth_sp = p.Polymer.Eth_ie;
-      Eth_ie = p.Polymer.Eth_ie;
-      break;
-    default:
-      A_sp = 0.;
-      B_sp = 0.;
-      A_ie = 0.;
-      Eth_sp = 0.;
-      Eth_ie = 0.;
-    }
-
+    const auto &c = yields[materialId];
     const auto sqrtE = std::sqrt(E);
 
     // sputtering yield Y_s
     localData.getVectorData(0)[primID] +=
-        A_sp * std::max(sqrtE - std::sqrt(Eth_sp), (NumericType)0) *
-        (1 + B_sp * (1 - cosTheta * cosTheta)) * cosTheta;
+        c.A_sp * std::max(sqrtE - c.sqrtEth_sp, (NumericType)0) *
+        (1 + c.B_sp * (1 - cosTheta * cosTheta)) * cosTheta;
 
     // ion enhanced etching yield Y_ie
     localData.getVectorData(1)[primID] +=
-        A_ie * std::max(sqrtE - std::sqrt(Eth_ie), (NumericType)0) * cosTheta;
+        c.A_ie * std::max(sqrtE - c.sqrtEth_ie, (NumericType)0) * cosTheta;
 
     // polymer yield Y_p
     localData.getVectorData(2)[primID] +=
-        p.Polymer.A_ie *
-        std::max(sqrtE - std::sqrt(p.Polymer.Eth_ie), (NumericType)0) *
+        p.Polymer.A_ie * std::max(sqrtE - sqrtEthPolymer, (NumericType)0) *
         cosTheta;
   }
   std::pair<NumericType, Vec3D<NumericType>>
@@ -434,23 +404,15 @@ public:
                     const unsigned int primId, const int materialId,
                     const viennaray::TracingData<NumericType> *globalData,
                     RNG &Rng) override final {
+    sourceEnergy.update(E);
 
     // Small incident angles are reflected with the energy fraction centered at
-    // 0
-    NumericType incAngle = std::acos(-DotProduct(rayDir, geomNormal));
-    NumericType Eref_peak;
-    if (incAngle >= p.Ions.inflectAngle) {
-      Eref_peak =
-          1. - (1. - A) * (M_PI_2 - incAngle) / (M_PI_2 - p.Ions.inflectAngle);
-    } else {
-      Eref_peak = A * std::pow(incAngle / p.Ions.inflectAngle, p.Ions.n_l);
-    }
-    // Gaussian distribution around the Eref_peak scaled by the particle energy
-    NumericType newEnergy;
-    std::normal_distribution<NumericType> normalDist(Eref_peak * E, 0.1 * E);
-    do {
-      newEnergy = normalDist(Rng);
-    } while (newEnergy > E || newEnergy < 0.);
+    // 0, the fraction is normally distributed around the peak
+    const auto cosTheta = -DotProduct(rayDir, geomNormal);
+    const NumericType incAngle = reflection.getIncidentAngle(cosTheta);
+    const NumericType newEnergy =
+        E * reflection.sampleEnergyFraction(
+                reflection.getPeakEnergyFraction(cosTheta), Rng);
 
     if (newEnergy > minEnergy) {
       E = newEnergy;
@@ -463,6 +425,11 @@ public:
     }
   }
   void initNew(RNG &RNG) override final {
+    // the energy is sampled by the source
+    if (distribution) {
+      sourceEnergy.reset();
+      return;
+    }
     std::normal_distribution<NumericType> normalDist{p.Ions.meanEnergy,
                                                      p.Ions.sigmaEnergy};
     do {
@@ -602,6 +569,20 @@ public:
     params_ = parameters;
   }
 
+  // Sample the energy and polar angle of the ions from a tabulated
+  // distribution instead of the Gaussian energy distribution and the power
+  // cosine source. Passing nullptr restores the default source.
+  void setIonEnergyAngleDistribution(
+      SmartPointer<IonEnergyAngleDistribution<NumericType>> distribution) {
+    this->particles[0] =
+        std::make_unique<impl::FluorocarbonIon<NumericType, D>>(params_,
+                                                                 distribution);
+    this->setParticleSource(
+        0, distribution
+               ? SmartPointer<IEADSource<NumericType, D>>::New(distribution)
+               : nullptr);
+  }
+
 private:
   FluorocarbonParameters<NumericType> params_;
 
@@ -619,7 +600,7 @@ private:
             params_);
 
     // velocity field
-    auto velField = SmartPointer<DefaultVelocityField<NumericType>>::New(2);
+    auto velField = SmartPointer<DefaultVelocityField<NumericType>>::New(3);
 
     this->setSurfaceModel(surfModel);
     this->setVelocityField(velField);
@@ -627,6 +608,8 @@ private:
     this->insertNextParticleType(ion);
     this->insertNextParticleType(etchant);
     this->insertNextParticleType(poly);
+    // the ion flux does not depend on the surface coverages
+    this->setParticleCoverageIndependent(0);
   }
 };
 
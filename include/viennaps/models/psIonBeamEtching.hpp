@@ -1,7 +1,9 @@
 #pragma once
 
+#include "../psIonEnergyAngleDistribution.hpp"
 #include "../psMaterials.hpp"
 #include "../psProcessModel.hpp"
+#include "psIonTables.hpp"
 
 #include <rayParticle.hpp>
 #include <rayReflection.hpp>
@@ -32,12 +34,17 @@ namespace impl {
 template <typename NumericType>
 class IBESurfaceModel : public SurfaceModel<NumericType> {
   const IBEParameters<NumericType> params_;
-  const std::vector<Material> maskMaterials_;
+  const MaterialMask maskMaterials_;
+  NumericType meanEnergy_;
 
 public:
   IBESurfaceModel(const IBEParameters<NumericType> &params,
                   const std::vector<Material> &mask)
-      : maskMaterials_(mask), params_(params) {}
+      : params_(params), maskMaterials_(mask), meanEnergy_(params.meanEnergy) {}
+
+  // The flux is normalized with the mean ion energy, which is the mean energy
+  // of the IEAD if the ions are sampled from one.
+  void setMeanEnergy(const NumericType meanEnergy) { meanEnergy_ = meanEnergy; }
 
   SmartPointer<std::vector<NumericType>> calculateVelocities(
       SmartPointer<viennals::PointData<NumericType>> rates,
@@ -50,36 +57,37 @@ public:
 
     const NumericType norm =
         params_.planeWaferRate /
-        ((std::sqrt(params_.meanEnergy) - std::sqrt(params_.thresholdEnergy)) *
+        ((std::sqrt(meanEnergy_) - std::sqrt(params_.thresholdEnergy)) *
          params_.yieldFunction(std::cos(params_.tiltAngle * M_PI / 180.)));
 
     for (std::size_t i = 0; i < velocity->size(); i++) {
-      if (!isMaskMaterial(materialIds[i])) {
+      if (!maskMaterials_.test(materialIds[i])) {
         velocity->at(i) = -flux->at(i) * norm;
       }
     }
 
     return velocity;
   }
-
-private:
-  bool isMaskMaterial(const NumericType &material) const {
-    for (const auto &mat : maskMaterials_) {
-      if (MaterialMap::isMaterial(material, mat))
-        return true;
-    }
-    return false;
-  }
 };
 
 template <typename NumericType, int D>
 class IBEIon : public viennaray::Particle<IBEIon<NumericType, D>, NumericType> {
 public:
-  IBEIon(const IBEParameters<NumericType> &params)
-      : params_(params), normalDist_(params.meanEnergy, params.sigmaEnergy),
+  IBEIon(const IBEParameters<NumericType> &params,
+         SmartPointer<IonEnergyAngleDistribution<NumericType>> distribution =
+             nullptr)
+      : params_(params), distribution_(distribution),
+        normalDist_(params.meanEnergy, params.sigmaEnergy),
         A_(1. / (1. + params.n * (M_PI_2 / params.inflectAngle - 1.))),
         inflectAngle_(params.inflectAngle * M_PI / 180.),
-        minAngle_(params.minAngle * M_PI / 180.) {}
+        minAngle_(params.minAngle * M_PI / 180.),
+        sqrtThresholdEnergy_(std::sqrt(params.thresholdEnergy)),
+        yield_(params.yieldFunction),
+        reflection_(A_, inflectAngle_, params.n) {}
+
+  // The tables are rebuilt for every copy the ray tracer makes, so changes of
+  // the parameters after the model was created are picked up.
+  IBEIon(const IBEIon &other) : IBEIon(other.params_, other.distribution_) {}
 
   void surfaceCollision(NumericType rayWeight, const Vec3D<NumericType> &rayDir,
                         const Vec3D<NumericType> &geomNormal,
@@ -87,11 +95,12 @@ public:
                         viennaray::TracingData<NumericType> &localData,
                         const viennaray::TracingData<NumericType> *,
                         RNG &) override final {
+    sourceEnergy_.update(energy_);
     NumericType cosTheta = -DotProduct(rayDir, geomNormal);
 
     localData.getVectorData(0)[primID] +=
-        std::max(std::sqrt(energy_) - std::sqrt(params_.thresholdEnergy), 0.) *
-        params_.yieldFunction(cosTheta);
+        std::max(std::sqrt(energy_) - sqrtThresholdEnergy_, NumericType(0.)) *
+        yield_(cosTheta);
   }
 
   std::pair<NumericType, Vec3D<NumericType>>
@@ -100,24 +109,15 @@ public:
                     const unsigned int primID, const int materialId,
                     const viennaray::TracingData<NumericType> *globalData,
                     RNG &rngState) override final {
+    sourceEnergy_.update(energy_);
 
     // Small incident angles are reflected with the energy fraction centered at
-    // 0
-    NumericType incAngle = std::acos(-DotProduct(rayDir, geomNormal));
-    NumericType Eref_peak;
-    if (incAngle >= inflectAngle_) {
-      Eref_peak =
-          1. - (1. - A_) * (M_PI_2 - incAngle) / (M_PI_2 - inflectAngle_);
-    } else {
-      Eref_peak = A_ * std::pow(incAngle / inflectAngle_, params_.n);
-    }
-    // Gaussian distribution around the Eref_peak scaled by the particle energy
-    NumericType newEnergy;
-    std::normal_distribution<NumericType> normalDist(Eref_peak * energy_,
-                                                     0.1 * energy_);
-    do {
-      newEnergy = normalDist(rngState);
-    } while (newEnergy > energy_ || newEnergy < 0.);
+    // 0, the fraction is normally distributed around the peak
+    const NumericType cosTheta = -DotProduct(rayDir, geomNormal);
+    const NumericType incAngle = reflection_.getIncidentAngle(cosTheta);
+    const NumericType newEnergy =
+        energy_ * reflection_.sampleEnergyFraction(
+                      reflection_.getPeakEnergyFraction(cosTheta), rngState);
 
     if (newEnergy > params_.thresholdEnergy) {
       energy_ = newEnergy;
@@ -131,6 +131,11 @@ public:
   }
 
   void initNew(RNG &rngState) override final {
+    // the energy is sampled by the source
+    if (distribution_) {
+      sourceEnergy_.reset();
+      return;
+    }
     do {
       energy_ = normalDist_(rngState);
     } while (energy_ < params_.thresholdEnergy);
@@ -146,12 +151,18 @@ public:
 
 private:
   NumericType energy_;
+  SourceEnergy<NumericType> sourceEnergy_;
 
   const IBEParameters<NumericType> &params_;
+  SmartPointer<IonEnergyAngleDistribution<NumericType>> distribution_;
+  std::normal_distribution<NumericType> normalDist_;
+  const NumericType A_;
   const NumericType inflectAngle_;
   const NumericType minAngle_;
-  const NumericType A_;
-  std::normal_distribution<NumericType> normalDist_;
+  const NumericType sqrtThresholdEnergy_;
+  // the yield function is tabulated over cos(theta)
+  const LookupTable<NumericType> yield_;
+  const IonReflectionTable<NumericType> reflection_;
 };
 } // namespace impl
 
@@ -173,19 +184,39 @@ public:
     params_ = params;
   }
 
+  // Sample the energy and polar angle of the ions from a tabulated
+  // distribution instead of the Gaussian energy distribution and the power
+  // cosine source. Passing nullptr restores the default source.
+  // The source hands the sampled energy to the ion through a thread_local
+  // value, which relies on the ray tracer starting a ray at the source and
+  // tracing it to the end on the same thread before the thread starts the
+  // next ray. ViennaRay traces each ray within one OpenMP iteration, so this
+  // holds for any number of threads.
+  void setIonEnergyAngleDistribution(
+      SmartPointer<IonEnergyAngleDistribution<NumericType>> distribution) {
+    this->particles[0] =
+        std::make_unique<impl::IBEIon<NumericType, D>>(params_, distribution);
+    this->setParticleSource(
+        0, distribution
+               ? SmartPointer<IEADSource<NumericType, D>>::New(distribution)
+               : nullptr);
+    surfaceModel_->setMeanEnergy(distribution ? distribution->getMeanEnergy()
+                                              : params_.meanEnergy);
+  }
+
 private:
   void initialize(std::vector<Material> &&maskMaterial) {
     // particles
     auto particle = std::make_unique<impl::IBEIon<NumericType, D>>(params_);
 
     // surface model
-    auto surfModel = SmartPointer<impl::IBESurfaceModel<NumericType>>::New(
+    surfaceModel_ = SmartPointer<impl::IBESurfaceModel<NumericType>>::New(
         params_, maskMaterial);
 
     // velocity field
-    auto velField = SmartPointer<DefaultVelocityField<NumericType>>::New(2);
+    auto velField = SmartPointer<DefaultVelocityField<NumericType>>::New(3);
 
-    this->setSurfaceModel(surfModel);
+    this->setSurfaceModel(surfaceModel_);
     this->setVelocityField(velField);
     this->insertNextParticleType(particle);
     this->setProcessName("IonBeamEtching");
@@ -193,6 +224,7 @@ private:
 
 private:
   IBEParameters<NumericType> params_;
+  SmartPointer<impl::IBESurfaceModel<NumericType>> surfaceModel_;
 };
 
 } // namespace viennaps
@@ -0,0 +1,184 @@
+#pragma once
+
+#include "../psMaterials.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <type_traits>
+#include <vector>
+
+namespace viennaps {
+
+using namespace viennacore;
+
+namespace impl {
+
+/// A function sampled at equidistant points on [0, 1] and evaluated by linear
+/// interpolation.
+template <class NumericType> class LookupTable {
+  std::vector<NumericType> values_;
+  NumericType scale_ = 0.;
+
+public:
+  LookupTable() = default;
+
+  template <class Function,
+            class = std::enable_if_t<
+                !std::is_same_v<std::decay_t<Function>, LookupTable>>>
+  LookupTable(Function function, unsigned numSamples = 1024)
+      : values_(numSamples), scale_(numSamples - 1) {
+    for (unsigned i = 0; i < numSamples; ++i)
+      values_[i] = function(static_cast<double>(i) / (numSamples - 1));
+  }
+
+  NumericType operator()(NumericType x) const {
+    const NumericType pos =
+        std::min(std::max(x, NumericType(0.)), NumericType(1.)) * scale_;
+    const auto i = std::min(static_cast<std::size_t>(pos), values_.size() - 2);
+    const NumericType t = pos - i;
+    return values_[i] + t * (values_[i + 1] - values_[i]);
+  }
+};
+
+/// Tabulated reflection of ions. The incident angle and the peak of the
+/// reflected energy fraction are sampled over u = sqrt(1 - cos(theta)), which
+/// keeps both smooth near normal incidence. The energy fraction of a reflected
+/// ion follows a normal distribution with standard deviation 0.1 around the
+/// peak, truncated to [0, 1]. It is sampled by interpolating the tabulated
+/// inverse of its CDF, which replaces the rejection sampling.
+template <class NumericType> class IonReflectionTable {
+  static constexpr unsigned numPeakSamples = 129;
+  static constexpr unsigned numProbabilitySamples = 257;
+  static constexpr double energySigma = 0.1;
+
+  LookupTable<NumericType> angle_;
+  LookupTable<NumericType> peak_;
+
+public:
+  IonReflectionTable() = default;
+
+  // A is the energy fraction at the inflection angle.
+  IonReflectionTable(NumericType A, NumericType inflectAngle, NumericType n_l) {
+    auto angle = [](double u) { return 2. * std::asin(u / std::sqrt(2.)); };
+    angle_ = LookupTable<NumericType>(angle);
+    peak_ = LookupTable<NumericType>([=](double u) {
+      const double incAngle = std::min(angle(u), M_PI_2);
+      if (incAngle >= inflectAngle)
+        return 1. - (1. - A) * (M_PI_2 - incAngle) / (M_PI_2 - inflectAngle);
+      return A * std::pow(incAngle / inflectAngle, n_l);
+    });
+  }
+
+  NumericType getIncidentAngle(NumericType cosTheta) const {
+    return angle_(toTableCoordinate(cosTheta));
+  }
+
+  NumericType getPeakEnergyFraction(NumericType cosTheta) const {
+    return peak_(toTableCoordinate(cosTheta));
+  }
+
+  template <class RNG>
+  NumericType sampleEnergyFraction(NumericType peak, RNG &rngState) const {
+    static const std::vector<NumericType> table = buildInverseCDF();
+    std::uniform_real_distribution<NumericType> uniform(0., 1.);
+
+    const NumericType peakPos =
+        std::min(std::max(peak, NumericType(0.)), NumericType(1.)) *
+        (numPeakSamples - 1);
+    // the table is sampled at the centers of the probability bins
+    const NumericType probPos = std::min(
+        std::max(uniform(rngState) * numProbabilitySamples - NumericType(0.5),
+                 NumericType(0.)),
+        NumericType(numProbabilitySamples - 1));
+    const auto i =
+        std::min(static_cast<unsigned>(peakPos), numPeakSamples - 2);
+    const auto j =
+        std::min(static_cast<unsigned>(probPos), numProbabilitySamples - 2);
+    const NumericType s = peakPos - i;
+    const NumericType t = probPos - j;
+
+    const auto *row0 = &table[i * numProbabilitySamples + j];
+    const auto *row1 = row0 + numProbabilitySamples;
+    return (1 - s) * ((1 - t) * row0[0] + t * row0[1]) +
+           s * ((1 - t) * row1[0] + t * row1[1]);
+  }
+
+private:
+  static NumericType toTableCoordinate(NumericType cosTheta) {
+    return std::sqrt(std::max(NumericType(1.) - cosTheta, NumericType(0.)));
+  }
+
+  static std::vector<NumericType> buildInverseCDF() {
+    auto normalCDF = [](double x, double mean) {
+      return 0.5 * std::erfc(-(x - mean) / (energySigma * std::sqrt(2.)));
+    };
+
+    std::vector<NumericType> table(numPeakSamples * numProbabilitySamples);
+    for (unsigned i = 0; i < numPeakSamples; ++i) {
+      const double peak = static_cast<double>(i) / (numPeakSamples - 1);
+      const double lower = normalCDF(0., peak);
+      const double upper = normalCDF(1., peak);
+      for (unsigned j = 0; j < numProbabilitySamples; ++j) {
+        // sampling at the bin centers avoids the steep tails of the inverse
+        // CDF, which linear interpolation would overweight
+        const double target =
+            lower + (upper - lower) * (j + 0.5) / numProbabilitySamples;
+        // bisection on the CDF of the truncated distribution
+        double a = 0., b = 1.;
+        for (int k = 0; k < 40; ++k) {
+          const double x = 0.5 * (a + b);
+          if (normalCDF(x, peak) < target)
+            a = x;
+          else
+            b = x;
+        }
+        table[i * numProbabilitySamples + j] = 0.5 * (a + b);
+      }
+    }
+    return table;
+  }
+};
+
+/// Sputtering and ion enhanced etching coefficients of all materials, indexed
+/// by the material ID. The square roots of the threshold energies are
+/// precomputed.
+template <class NumericType> struct IonYieldCoefficients {
+  NumericType A_sp = 0.;
+  NumericType B_sp = 0.;
+  NumericType sqrtEth_sp = 0.;
+  NumericType A_ie = 0.;
+  NumericType sqrtEth_ie = 0.;
+};
+
+template <class NumericType> class IonYieldTable {
+  MaterialTable<IonYieldCoefficients<NumericType>> coefficients_;
+
+public:
+  // Set the coefficients of one material from the threshold energies.
+  void setMaterial(Material material, NumericType A_sp, NumericType B_sp,
+                   NumericType Eth_sp, NumericType A_ie, NumericType Eth_ie) {
+    auto &c = coefficients_[material];
+    c.A_sp = A_sp;
+    c.B_sp = B_sp;
+    c.sqrtEth_sp = std::sqrt(Eth_sp);
+    c.A_ie = A_ie;
+    c.sqrtEth_ie = std::sqrt(Eth_ie);
+  }
+
+  // Use the same coefficients for all materials.
+  void setAllMaterials(NumericType A_sp, NumericType B_sp, NumericType Eth_sp,
+                       NumericType A_ie, NumericType Eth_ie) {
+    setMaterial(Material::None, A_sp, B_sp, Eth_sp, A_ie, Eth_ie);
+    const auto c = coefficients_[Material::None];
+    coefficients_.fill(c);
+  }
+
+  template <class T>
+  const IonYieldCoefficients<NumericType> &operator[](T materialId) const {
+    return coefficients_.lookup(materialId);
+  }
+};
+
+} // namespace impl
+} // namespace viennaps
@@ -16,35 +16,36 @@ namespace impl {
 template <class NumericType, int D>
 class IsotropicVelocityField : public VelocityField<NumericType> {
   const NumericType rate_ = 1.;
-  const std::vector<int> maskMaterials_;
+  const MaterialMask maskMaterials_;
 
 public:
-  IsotropicVelocityField(NumericType rate, std::vector<int> &&mask)
-      : rate_{rate}, maskMaterials_{std::move(mask)} {}
+  IsotropicVelocityField(NumericType rate, const MaterialMask &mask)
+      : rate_{rate}, maskMaterials_{mask} {}
 
   NumericType getScalarVelocity(const std::array<NumericType, 3> &,
                                 int material,
                                 const std::array<NumericType, 3> &,
                                 unsigned long) override {
-    if (isMaskMaterial(material)) {
+    if (maskMaterials_.test(material)) {
       return 0.;
     } else {
       return rate_;
     }
   }
 
+  void getScalarVelocities(const std::vector<Vec3D<NumericType>> &coordinates,
+                           const std::vector<int> &materials,
+                           const std::vector<Vec3D<NumericType>> &,
+                           const std::vector<unsigned long> &,
+                           std::vector<NumericType> &velocities) override {
+    velocities.resize(coordinates.size());
+    for (std::size_t i = 0; i < coordinates.size(); ++i)
+      velocities[i] = maskMaterials_.test(materials[i]) ? 0. : rate_;
+  }
+
   // the translation field should be disabled when using a surface model
   // which only depends on an analytic velocity field
   int getTranslationFieldOptions() const override { return 0; }
-
-private:
-  bool isMaskMaterial(const int material) const {
-    for (const auto &mat : maskMaterials_) {
-      if (material == mat)
-        return true;
-    }
-    return false;
-  }
 };
 } // namespace impl
 
@@ -58,10 +59,9 @@ public:
     auto surfModel = SmartPointer<SurfaceModel<NumericType>>::New();
 
     // velocity field
-    std::vector<int> maskMaterialsInt = {static_cast<int>(maskMaterial)};
     auto velField =
         SmartPointer<impl::IsotropicVelocityField<NumericType, D>>::New(
-            isotropicRate, std::move(maskMaterialsInt));
+            isotropicRate, MaterialMask{maskMaterial});
 
     this->setSurfaceModel(surfModel);
     this->setVelocityField(velField);
@@ -74,13 +74,9 @@ public:
     auto surfModel = SmartPointer<SurfaceModel<NumericType>>::New();
 
     // velocity field
-    std::vector<int> maskMaterialsInt;
-    for (const auto &mat : maskMaterials) {
-      maskMaterialsInt.push_back(static_cast<int>(mat));
-    }
     auto velField =
         SmartPointer<impl::IsotropicVelocityField<NumericType, D>>::New(
-            isotropicRate, std::move(maskMaterialsInt));
+            isotropicRate, MaterialMask(maskMaterials));
 
     this->setSurfaceModel(surfModel);
     this->setVelocityField(velField);
@@ -0,0 +1,132 @@
+#pragma once
+
+#include "../psMaterials.hpp"
+#include "../psProcessModel.hpp"
+#include "../psSurfaceModel.hpp"
+#include "../psVelocityField.hpp"
+
+#include <vcSmartPointer.hpp>
+#include <vcVectorUtil.hpp>
+
+namespace viennaps {
+
+using namespace viennacore;
+
+namespace impl {
+
+template <class NumericType, int D>
+class MultiRateVelocityField : public VelocityField<NumericType> {
+  // rates of all materials, the directional rates of all directions are
+  // summed up into one velocity vector per material
+  MaterialTable<NumericType> isotropicRates_;
+  MaterialTable<Vec3D<NumericType>> directionalRates_;
+
+public:
+  MultiRateVelocityField()
+      : isotropicRates_(0.),
+        directionalRates_(Vec3D<NumericType>{0., 0., 0.}) {}
+
+  NumericType getScalarVelocity(const Vec3D<NumericType> &, int material,
+                                const Vec3D<NumericType> &,
+                                unsigned long) override {
+    return isotropicRates_.lookup(material);
+  }
+
+  Vec3D<NumericType> getVectorVelocity(const Vec3D<NumericType> &,
+                                       int material,
+                                       const Vec3D<NumericType> &,
+                                       unsigned long) override {
+    return directionalRates_.lookup(material);
+  }
+
+  void getScalarVelocities(const std::vector<Vec3D<NumericType>> &coordinates,
+                           const std::vector<int> &materials,
+                           const std::vector<Vec3D<NumericType>> &,
+                           const std::vector<unsigned long> &,
+                           std::vector<NumericType> &velocities) override {
+    velocities.resize(coordinates.size());
+    for (std::size_t i = 0; i < coordinates.size(); ++i)
+      velocities[i] = isotropicRates_.lookup(materials[i]);
+  }
+
+  void
+  getVectorVelocities(const std::vector<Vec3D<NumericType>> &coordinates,
+                      const std::vector<int> &materials,
+                      const std::vector<Vec3D<NumericType>> &,
+                      const std::vector<unsigned long> &,
+                      std::vector<Vec3D<NumericType>> &velocities) override {
+    velocities.resize(coordinates.size());
+    for (std::size_t i = 0; i < coordinates.size(); ++i)
+      velocities[i] = directionalRates_.lookup(materials[i]);
+  }
+
+  void setIsotropicRate(const Material material, const NumericType rate) {
+    isotropicRates_.set(material, rate);
+  }
+
+  void addDirectionalRate(const Material material,
+                          const Vec3D<NumericType> &direction,
+                          const NumericType rate) {
+    auto &velocity = directionalRates_[material];
+    for (int i = 0; i < D; ++i)
+      velocity[i] += direction[i] * rate;
+  }
+
+  // the translation field should be disabled when using a surface model
+  // which only depends on an analytic velocity field
+  int getTranslationFieldOptions() const override { return 0; }
+};
+} // namespace impl
+
+/// Isotropic and directional rates which depend on the material, advected
+/// together in a single sweep. Positive isotropic rates deposit, negative
+/// rates etch. A directional rate moves the surface along the given direction.
+/// Materials without a rate are not moved.
+template <typename NumericType, int D>
+class MultiRateProcess : public ProcessModel<NumericType, D> {
+  SmartPointer<impl::MultiRateVelocityField<NumericType, D>> velocityField_;
+
+public:
+  MultiRateProcess() {
+    // default surface model
+    auto surfModel = SmartPointer<SurfaceModel<NumericType>>::New();
+
+    // velocity field
+    velocityField_ =
+        SmartPointer<impl::MultiRateVelocityField<NumericType, D>>::New();
+
+    this->setSurfaceModel(surfModel);
+    this->setVelocityField(velocityField_);
+    this->setProcessName("MultiRateProcess");
+  }
+
+  // Set the isotropic rate of a material.
+  void setIsotropicRate(const Material material, const NumericType rate) {
+    velocityField_->setIsotropicRate(material, rate);
+  }
+
+  // Set the isotropic rate of several materials.
+  void setIsotropicRate(const std::vector<Material> &materials,
+                        const NumericType rate) {
+    for (const auto material : materials)
+      velocityField_->setIsotropicRate(material, rate);
+  }
+
+  // Add a directional rate to a material. The rates of several directions
+  // are superimposed.
+  void addDirectionalRate(const Material material,
+                          const Vec3D<NumericType> &direction,
+                          const NumericType rate) {
+    velocityField_->addDirectionalRate(material, Normalize(direction), rate);
+  }
+
+  void addDirectionalRate(const std::vector<Material> &materials,
+                          const Vec3D<NumericType> &direction,
+                          const NumericType rate) {
+    const auto normalized = Normalize(direction);
+    for (const auto material : materials)
+      velocityField_->addDirectionalRate(material, normalized, rate);
+  }
+};
+
+} // namespace viennaps
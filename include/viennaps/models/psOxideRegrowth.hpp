@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../psAdvectionCallback.hpp"
+#include "../psCellSetDiffusion.hpp"
 #include "../psProcessModel.hpp"
 #include "../psToDiskMesh.hpp"
 
@@ -40,32 +41,37 @@ private:
   const NumericType oxide_rate;
 };
 
+// The redeposition velocities are given on the surface disk mesh and mapped
+// to the Level-Set points with the translator of the mesh.
 template <class NumericType>
 class RedepositionVelocityField : public viennals::VelocityField<NumericType> {
 public:
   RedepositionVelocityField(const std::vector<NumericType> &passedVelocities,
-                            const std::vector<Vec3D<NumericType>> &points)
-      : velocities(passedVelocities), kdTree(points) {
-    assert(points.size() == passedVelocities.size());
-    kdTree.build();
-  }
+                            SmartPointer<Translator> passedTranslator)
+      : velocities(passedVelocities), translator(passedTranslator) {}
 
   NumericType getScalarVelocity(const Vec3D<NumericType> &coordinate, int matId,
                                 const Vec3D<NumericType> &normalVector,
                                 unsigned long pointId) override {
-    auto nearest = kdTree.findNearest(coordinate);
-    assert(nearest->first < velocities.size());
-    return velocities[nearest->first];
+    // only points close to the surface are advected, which are all part of
+    // the disk mesh
+    const auto meshId = translator->find(pointId);
+    if (meshId == Translator::invalidId)
+      return 0.;
+    assert(meshId < velocities.size());
+    return velocities[meshId];
   }
 
 private:
   const std::vector<NumericType> &velocities;
-  KDTree<NumericType, Vec3D<NumericType>> kdTree;
+  SmartPointer<Translator> translator;
 };
 
 template <class T, int D>
 class ByproductDynamics : public AdvectionCallback<T, D> {
   using AdvectionCallback<T, D>::domain;
+  using AdvectionCallback<T, D>::diskMesh;
+  using AdvectionCallback<T, D>::translator;
 
   const T diffusionCoefficient = 1.;
   const T sink = 1;
@@ -78,6 +84,9 @@ class ByproductDynamics : public AdvectionCallback<T, D> {
   const T reDepositionThreshold = 0.1;
   const T reDepoTimeInt = 60;
   const T timeStabilityFactor = 0.245;
+  T implicitTimeStep = 0.;
+  CellSetDiffusion<T, D> diffusion;
+  std::vector<char> topCells;
   std::vector<std::array<T, 3>> nodes;
   T prevProcTime = 0.;
   unsigned counter = 0;
@@ -97,13 +106,23 @@ public:
         reDepoTimeInt(passedRedepoTimeInt),
         timeStabilityFactor(passedTimeStabilityFactor) {}
 
+  // Integrate the byproduct diffusion implicitly with the given time step,
+  // which is not limited by the time stability factor. The explicit
+  // integration is used if the time step is not positive.
+  void setImplicitTimeStep(const T timeStep) { implicitTimeStep = timeStep; }
+
   bool applyPreAdvect(const T processTime) override {
     assert(domain->getCellSet());
     auto &cellSet = domain->getCellSet();
 
-    // redeposition
-    auto mesh = SmartPointer<viennals::Mesh<T>>::New();
-    ToDiskMesh<T, D>(domain, mesh).apply();
+    // redeposition, the surface of the process is used if available
+    auto mesh = diskMesh;
+    auto meshTranslator = translator;
+    if (!mesh || !meshTranslator) {
+      mesh = SmartPointer<viennals::Mesh<T>>::New();
+      meshTranslator = SmartPointer<Translator>::New();
+      ToDiskMesh<T, D>(domain, mesh, meshTranslator).apply();
+    }
 
     const auto &points = mesh->nodes;
     auto materialIds = mesh->getCellData().getScalarData("MaterialIds");
@@ -163,8 +182,8 @@ public:
       }
 
       // advect surface
-      auto redepoVelField =
-          SmartPointer<RedepositionVelocityField<T>>::New(depoRate, points);
+      auto redepoVelField = SmartPointer<RedepositionVelocityField<T>>::New(
+          depoRate, meshTranslator);
 
       viennals::Advect<T, D> advectionKernel;
       advectionKernel.insertNextLevelSet(domain->getLevelSets().back());
@@ -190,110 +209,114 @@ public:
                                   etchRate * advectedTime / gridDelta);
     }
 
-    diffuseByproducts(cellSet, advectedTime);
-
     return true;
   }
 
+  // the byproducts are only needed for the redeposition in the next
+  // applyPreAdvect
+  void applyPostAdvectDeferred(const T advectedTime) override {
+    diffuseByproducts(domain->getCellSet(), advectedTime);
+  }
+
 private:
   void diffuseByproducts(SmartPointer<viennacs::DenseCellSet<T, D>> cellSet,
                          const T timeStep) {
     auto data = cellSet->getFillingFractions();
-    auto materialIds = cellSet->getScalarData("Material");
-    auto elems = cellSet->getElements();
-    auto nodes = cellSet->getNodes();
     const auto gridDelta = cellSet->getGridDelta();
-    // calculate time discretization
-    const T dt = std::min(gridDelta * gridDelta / diffusionCoefficient *
-                              timeStabilityFactor,
-                          T(1.));
+    // time step of the explicit integration
+    const T explicitDt = std::min(
+        gridDelta * gridDelta / diffusionCoefficient * timeStabilityFactor,
+        T(1.));
+    const bool useImplicit = implicitTimeStep > 0.;
+    const T dt = useImplicit ? std::min(implicitTimeStep, timeStep)
+                             : explicitDt;
     const int numSteps = static_cast<int>(timeStep / dt);
-    const T C = dt * diffusionCoefficient / (gridDelta * gridDelta);
-    const T holeC = dt / gridDelta * holeStreamVel;
-    const T scallopC = dt / gridDelta * scallopStreamVel;
 
+    diffusion.update(cellSet, Material::GAS);
+    setupStencils();
+    diffusion.gather(*data);
+
+    // the sink strength is given per explicit time step
+    const T stepSink = sink * dt / explicitDt;
+    auto &solution = diffusion.getSolution();
+    const auto numCells = static_cast<long>(diffusion.size());
+    bool converged = true;
     for (int ts = 0; ts < numSteps; ts++) {
-      std::vector<T> solution(data->size(), 0.);
+      if (useImplicit) {
+        converged &= diffusion.implicitStep(dt);
+      } else {
+        diffusion.explicitStep(dt);
+      }
 
+      // sink at the top, the implicit solution is clamped to remove negative
+      // values within the tolerance of the linear solver
 #pragma omp parallel for
-      for (int e = 0; e < data->size(); e++) {
-        if (!MaterialMap::isMaterial(materialIds->at(e), Material::GAS)) {
-          continue;
-        }
+      for (long i = 0; i < numCells; i++) {
+        if (topCells[i])
+          solution[i] = std::max(solution[i] - stepSink, T(0.));
+        else if (useImplicit)
+          solution[i] = std::max(solution[i], T(0.));
+      }
+    }
+    if (!converged) {
+      Logger::getInstance()
+          .addWarning("Byproduct diffusion: linear solver did not converge.")
+          .print();
+    }
+    if (numSteps > 0)
+      diffusion.scatter(*data);
 
-        int numNeighbors = 0;
-        auto coord = nodes[elems[e][0]];
-        for (int i = 0; i < D; i++) {
-          coord[i] += gridDelta / 2.;
-        }
+    auto sum = cellSet->getScalarData("byproductSum");
+#pragma omp parallel for
+    for (long i = 0; i < numCells; i++) {
+      assert(solution[i] >= 0. && "Negative concentration");
+      sum->at(diffusion.getCellIndex(i)) += solution[i] * timeStep;
+    }
+  }
 
-        auto cellNeighbors = cellSet->getNeighbors(e);
-        for (const auto &n : cellNeighbors) {
-          if (n == -1 ||
-              !MaterialMap::isMaterial(materialIds->at(n), Material::GAS))
-            continue;
+  // Diffusion between the gas cells, the byproducts are streamed up in the
+  // hole and towards the hole in the scallops.
+  void setupStencils() {
+    const auto gridDelta = diffusion.getGridDelta();
+    const T holeRate = holeStreamVel / gridDelta;
+    const T scallopRate = scallopStreamVel / gridDelta;
+    const auto numCells = static_cast<long>(diffusion.size());
 
-          solution[e] += data->at(n);
-          numNeighbors++;
-        }
+    diffusion.setDiffusion(diffusionCoefficient);
+    auto &stencils = diffusion.getStencils();
+    topCells.resize(numCells);
 
-        // diffusion
-        solution[e] =
-            data->at(e) +
-            C * (solution[e] - static_cast<T>(numNeighbors) * data->at(e));
+#pragma omp parallel for
+    for (long i = 0; i < numCells; i++) {
+      const auto &coord = diffusion.getCellCenter(i);
+      const auto &neighbors = diffusion.getNeighbors(i);
+      auto &stencil = stencils[i];
 
-        // sink at the top
-        if (coord[D - 1] > top - gridDelta) {
-          solution[e] = std::max(solution[e] - sink, T(0.));
-          continue;
-        }
+      topCells[i] = coord[D - 1] > top - gridDelta;
+      if (topCells[i])
+        continue;
 
-        // convection
-        if (std::abs(coord[0]) < holeRadius) {
-          // in hole
-          assert((cellNeighbors[2] != -1 && D == 2) ||
-                 (cellNeighbors[4] != -1 && D == 3) &&
-                     "holeStream up neighbor wrong");
-          if (MaterialMap::isMaterial(
-                  materialIds->at(cellNeighbors[2 * (D - 1)]), Material::GAS)) {
-            solution[e] -= holeC * (((coord[D - 1] - gridDelta) / top) *
-                                        data->at(cellNeighbors[2 * (D - 1)]) -
-                                    (coord[D - 1] / top) * data->at(e));
-          }
-        } else {
-          if (coord[0] < 0) {
-            // left side scallop - use forward difference
-            assert(cellNeighbors[1] != -1 &&
-                   "scallopStream right neighbor wrong");
-            if (MaterialMap::isMaterial(materialIds->at(cellNeighbors[1]),
-                                        Material::GAS)) {
-              solution[e] -=
-                  scallopC * (data->at(cellNeighbors[1]) - data->at(e));
-            }
-          } else {
-            // right side scallop - use backward difference
-            assert(cellNeighbors[0] != -1 &&
-                   "scallopStream left neighbor wrong");
-            if (MaterialMap::isMaterial(materialIds->at(cellNeighbors[0]),
-                                        Material::GAS)) {
-              solution[e] +=
-                  scallopC * (data->at(e) - data->at(cellNeighbors[0]));
-            }
-          }
+      if (std::abs(coord[0]) < holeRadius) {
+        // in hole
+        constexpr int down = 2 * (D - 1);
+        if (neighbors[down] != -1) {
+          stencil.neighbors[down] -=
+              holeRate * (coord[D - 1] - gridDelta) / top;
+          stencil.diagonal += holeRate * coord[D - 1] / top;
+        }
+      } else if (coord[0] < 0) {
+        // left side scallop - use forward difference
+        if (neighbors[1] != -1) {
+          stencil.neighbors[1] -= scallopRate;
+          stencil.diagonal += scallopRate;
+        }
+      } else {
+        // right side scallop - use backward difference
+        if (neighbors[0] != -1) {
+          stencil.neighbors[0] -= scallopRate;
+          stencil.diagonal += scallopRate;
         }
       }
-      *data = std::move(solution);
-    }
-    auto sum = cellSet->getScalarData("byproductSum");
-
-#pragma omp parallel for shared(sum)
-    for (int e = 0; e < data->size(); e++) {
-      if (!MaterialMap::isMaterial(materialIds->at(e), Material::GAS)) {
-        continue;
-      }
-
-      assert(data->at(e) >= 0. && "Negative concentration");
-      sum->at(e) += data->at(e) * timeStep;
     }
   }
 };
@@ -303,6 +326,8 @@ private:
 // by psMakeStack
 template <class NumericType, int D>
 class OxideRegrowth : public ProcessModel<NumericType, D> {
+  SmartPointer<impl::ByproductDynamics<NumericType, D>> dynamics_;
+
 public:
   OxideRegrowth(const NumericType nitrideEtchRate,
                 const NumericType oxideEtchRate,
@@ -322,16 +347,23 @@ public:
 
     auto surfModel = SmartPointer<SurfaceModel<NumericType>>::New();
 
-    auto dynamics = SmartPointer<impl::ByproductDynamics<NumericType, D>>::New(
+    dynamics_ = SmartPointer<impl::ByproductDynamics<NumericType, D>>::New(
         diffusionCoefficient, sinkStrength, scallopVelocity, centerVelocity,
         topHeight, centerWidth / 2., nitrideEtchRate, redepositionRate,
         reDepositionThreshold, redepositionTimeInt, timeStabilityFactor);
 
     this->setVelocityField(velocityField);
     this->setSurfaceModel(surfModel);
-    this->setAdvectionCallback(dynamics);
+    this->setAdvectionCallback(dynamics_);
     this->setProcessName("OxideRegrowth");
   }
+
+  // Solve the byproduct diffusion implicitly with the given time step instead
+  // of the explicit time step limited by the time stability factor. A time
+  // step of 0 switches back to the explicit integration.
+  void setImplicitTimeStep(const NumericType timeStep) {
+    dynamics_->setImplicitTimeStep(timeStep);
+  }
 };
 
 } // namespace viennaps
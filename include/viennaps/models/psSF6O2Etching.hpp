@@ -4,10 +4,13 @@
 #include <rayReflection.hpp>
 #include <rayUtil.hpp>
 
+#include "../psIonEnergyAngleDistribution.hpp"
 #include "../psProcessModel.hpp"
 #include "../psSurfaceModel.hpp"
 #include "../psVelocityField.hpp"
 
+#include "psIonTables.hpp"
+
 namespace viennaps {
 
 using namespace viennacore;
@@ -100,35 +103,37 @@ public:
     const auto numPoints = rates->getScalarData(0)->size();
     std::vector<NumericType> etchRate(numPoints, 0.);
 
-    const auto ionEnhancedRate = rates->getScalarData("ionEnhancedRate");
-    const auto ionSputteringRate = rates->getScalarData("ionSputteringRate");
-    const auto etchantRate = rates->getScalarData("etchantRate");
-    const auto eCoverage = coverages->getScalarData("eCoverage");
-    const auto oCoverage = coverages->getScalarData("oCoverage");
-
-    bool stop = false;
-
-    for (size_t i = 0; i < numPoints; ++i) {
-      if (coordinates[i][D - 1] < params.etchStopDepth) {
-        stop = true;
-        break;
-      }
-
-      if (MaterialMap::isMaterial(materialIds[i], Material::Mask)) {
-        etchRate[i] =
-            -(1 / params.Mask.rho) * ionSputteringRate->at(i) * params.ionFlux;
-      } else {
-        etchRate[i] =
-            -(1 / params.Si.rho) * (params.Si.k_sigma * eCoverage->at(i) / 4. +
-                                    ionSputteringRate->at(i) * params.ionFlux +
-                                    eCoverage->at(i) * ionEnhancedRate->at(i) *
-                                        params.ionFlux); // in um / s
-      }
+    if (reachedEtchStop(coordinates, numPoints)) {
+      Logger::getInstance().addInfo("Etch stop depth reached.").print();
+      return SmartPointer<std::vector<NumericType>>::New(std::move(etchRate));
     }
 
-    if (stop) {
-      std::fill(etchRate.begin(), etchRate.end(), 0.);
-      Logger::getInstance().addInfo("Etch stop depth reached.").print();
+    // The mask is only sputtered, all other materials are etched like Si.
+    MaterialTable<NumericType> invDensity(-1 / params.Si.rho);
+    MaterialTable<NumericType> chemicalFactor(params.Si.k_sigma / 4.);
+    MaterialTable<NumericType> ionEnhancedFactor(params.ionFlux);
+    invDensity.set(Material::Mask, -1 / params.Mask.rho);
+    chemicalFactor.set(Material::Mask, 0.);
+    ionEnhancedFactor.set(Material::Mask, 0.);
+
+    const auto *ionEnhancedRate =
+        rates->getScalarData("ionEnhancedRate")->data();
+    const auto *ionSputteringRate =
+        rates->getScalarData("ionSputteringRate")->data();
+    const auto *eCoverage = coverages->getScalarData("eCoverage")->data();
+    const auto *matIds = materialIds.data();
+    auto *rate = etchRate.data();
+    const NumericType ionFlux = params.ionFlux;
+
+    // in um / s
+#pragma omp parallel for simd
+    for (long i = 0; i < static_cast<long>(numPoints); ++i) {
+      const int m = MaterialMap::getIndex(matIds[i]);
+      rate[i] = invDensity.atIndex(m) *
+                (chemicalFactor.atIndex(m) * eCoverage[i] +
+                 ionSputteringRate[i] * ionFlux +
+                 ionEnhancedFactor.atIndex(m) * eCoverage[i] *
+                     ionEnhancedRate[i]);
     }
 
     return SmartPointer<std::vector<NumericType>>::New(std::move(etchRate));
@@ -139,56 +144,81 @@ public:
     // update coverages based on fluxes
     const auto numPoints = rates->getScalarData(0)->size();
 
-    const auto etchantRate = rates->getScalarData("etchantRate");
-    const auto ionEnhancedRate = rates->getScalarData("ionEnhancedRate");
-    const auto oxygenRate = rates->getScalarData("oxygenRate");
-    const auto oxygenSputteringRate =
-        rates->getScalarData("oxygenSputteringRate");
+    const auto *etchantRate = rates->getScalarData("etchantRate")->data();
+    const auto *ionEnhancedRate =
+        rates->getScalarData("ionEnhancedRate")->data();
+    const auto *oxygenRate = rates->getScalarData("oxygenRate")->data();
+    const auto *oxygenSputteringRate =
+        rates->getScalarData("oxygenSputteringRate")->data();
 
     // etchant fluorine coverage
-    auto eCoverage = coverages->getScalarData("eCoverage");
-    eCoverage->resize(numPoints);
+    auto eCoverageData = coverages->getScalarData("eCoverage");
+    eCoverageData->resize(numPoints);
+    auto *eCoverage = eCoverageData->data();
     // oxygen coverage
-    auto oCoverage = coverages->getScalarData("oCoverage");
-    oCoverage->resize(numPoints);
-    for (size_t i = 0; i < numPoints; ++i) {
-      if (etchantRate->at(i) < 1e-6) {
-        eCoverage->at(i) = 0;
-      } else {
-        eCoverage->at(i) =
-            etchantRate->at(i) * params.etchantFlux * params.beta_F /
-            (etchantRate->at(i) * params.etchantFlux * params.beta_F +
-             (params.Si.k_sigma + 2 * ionEnhancedRate->at(i) * params.ionFlux) *
-                 (1 + (oxygenRate->at(i) * params.oxygenFlux * params.beta_O) /
-                          (params.Si.beta_sigma +
-                           oxygenSputteringRate->at(i) * params.ionFlux)));
-      }
-
-      if (oxygenRate->at(i) < 1e-6) {
-        oCoverage->at(i) = 0;
-      } else {
-        oCoverage->at(i) =
-            oxygenRate->at(i) * params.oxygenFlux * params.beta_O /
-            (oxygenRate->at(i) * params.oxygenFlux * params.beta_O +
-             (params.Si.beta_sigma +
-              oxygenSputteringRate->at(i) * params.ionFlux) *
-                 (1 +
-                  (etchantRate->at(i) * params.etchantFlux * params.beta_F) /
-                      (params.Si.k_sigma +
-                       2 * ionEnhancedRate->at(i) * params.ionFlux)));
-      }
+    auto oCoverageData = coverages->getScalarData("oCoverage");
+    oCoverageData->resize(numPoints);
+    auto *oCoverage = oCoverageData->data();
+
+    const NumericType etchantFactor = params.etchantFlux * params.beta_F;
+    const NumericType oxygenFactor = params.oxygenFlux * params.beta_O;
+    const NumericType ionFlux = params.ionFlux;
+    const NumericType k_sigma = params.Si.k_sigma;
+    const NumericType beta_sigma = params.Si.beta_sigma;
+
+    // Both coverages are computed unconditionally and selected afterwards,
+    // which keeps the loop free of branches.
+#pragma omp parallel for simd
+    for (long i = 0; i < static_cast<long>(numPoints); ++i) {
+      const NumericType etchant = etchantRate[i] * etchantFactor;
+      const NumericType oxygen = oxygenRate[i] * oxygenFactor;
+      const NumericType etchantRemoval =
+          k_sigma + 2 * ionEnhancedRate[i] * ionFlux;
+      const NumericType oxygenRemoval =
+          beta_sigma + oxygenSputteringRate[i] * ionFlux;
+
+      const NumericType e =
+          etchant / (etchant + etchantRemoval * (1 + oxygen / oxygenRemoval));
+      const NumericType o =
+          oxygen / (oxygen + oxygenRemoval * (1 + etchant / etchantRemoval));
+      eCoverage[i] = etchantRate[i] < 1e-6 ? NumericType(0) : e;
+      oCoverage[i] = oxygenRate[i] < 1e-6 ? NumericType(0) : o;
     }
   }
+
+private:
+  bool reachedEtchStop(const std::vector<Vec3D<NumericType>> &coordinates,
+                       const std::size_t numPoints) const {
+    bool stop = false;
+#pragma omp parallel for reduction(|| : stop)
+    for (long i = 0; i < static_cast<long>(numPoints); ++i)
+      stop = stop || coordinates[i][D - 1] < params.etchStopDepth;
+    return stop;
+  }
 };
 
 template <typename NumericType, int D>
 class SF6O2Ion
     : public viennaray::Particle<SF6O2Ion<NumericType, D>, NumericType> {
 public:
-  SF6O2Ion(const SF6O2Parameters<NumericType> &pParams)
-      : params(pParams),
+  SF6O2Ion(const SF6O2Parameters<NumericType> &pParams,
+           SmartPointer<IonEnergyAngleDistribution<NumericType>>
+               pDistribution = nullptr)
+      : params(pParams), distribution(pDistribution),
         A(1. /
-          (1. + params.Ions.n_l * (M_PI_2 / params.Ions.inflectAngle - 1.))) {}
+          (1. + params.Ions.n_l * (M_PI_2 / params.Ions.inflectAngle - 1.))),
+        reflection(A, params.Ions.inflectAngle, params.Ions.n_l),
+        sqrtEthPassivation(std::sqrt(params.Passivation.Eth_ie)) {
+    yields.setAllMaterials(params.Si.A_sp, params.Si.B_sp, params.Si.Eth_sp,
+                           params.Si.A_ie, params.Si.Eth_ie);
+    yields.setMaterial(Material::Mask, params.Si.A_sp, params.Mask.B_sp,
+                       params.Mask.Eth_sp, params.Si.A_ie, params.Si.Eth_ie);
+  }
+
+  // The tables are rebuilt for every copy the ray tracer makes, so changes of
+  // the parameters after the model was created are picked up.
+  SF6O2Ion(const SF6O2Ion &other)
+      : SF6O2Ion(other.params, other.distribution) {}
 
   void surfaceCollision(NumericType rayWeight, const Vec3D<NumericType> &rayDir,
                         const Vec3D<NumericType> &geomNormal,
@@ -196,44 +226,32 @@ public:
                         viennaray::TracingData<NumericType> &localData,
                         const viennaray::TracingData<NumericType> *globalData,
                         RNG &) override final {
+    sourceEnergy.update(E);
 
     // collect data for this hit
     assert(primID < localData.getVectorData(0).size() && "id out of bounds");
 
-    const double cosTheta = -DotProduct(rayDir, geomNormal);
+    const NumericType cosTheta = -DotProduct(rayDir, geomNormal);
 
     assert(cosTheta >= 0 && "Hit backside of disc");
     assert(cosTheta <= 1 + 1e6 && "Error in calculating cos theta");
     assert(rayWeight > 0. && "Invalid ray weight");
 
-    const double angle = std::acos(std::max(std::min(cosTheta, 1.), 0.));
-
-    NumericType f_ie_theta;
-    if (cosTheta > 0.5) {
-      f_ie_theta = 1.;
-    } else {
-      f_ie_theta = 3. - 6. * angle / M_PI;
-    }
-    NumericType A_sp = params.Si.A_sp;
-    NumericType B_sp = params.Si.B_sp;
-    NumericType Eth_sp = params.Si.Eth_sp;
-    if (MaterialMap::isMaterial(materialId, Material::Mask)) {
-      A_sp = params.Mask.A_sp;
-      B_sp = params.Mask.B_sp;
-      Eth_sp = params.Mask.Eth_sp;
-    }
-
-    NumericType f_sp_theta = (1 + B_sp * (1 - cosTheta * cosTheta)) * cosTheta;
-
-    double sqrtE = std::sqrt(E);
-    NumericType Y_sp =
-        params.Si.A_sp * std::max(sqrtE - std::sqrt(Eth_sp), 0.) * f_sp_theta;
-    NumericType Y_Si = params.Si.A_ie *
-                       std::max(sqrtE - std::sqrt(params.Si.Eth_ie), 0.) *
-                       f_ie_theta;
-    NumericType Y_O =
-        params.Passivation.A_ie *
-        std::max(sqrtE - std::sqrt(params.Passivation.Eth_ie), 0.) * f_ie_theta;
+    const NumericType f_ie_theta =
+        cosTheta > 0.5 ? 1. : 3. - 6. * reflection.getIncidentAngle(cosTheta) /
+                                      M_PI;
+    const auto &c = yields[materialId];
+    const NumericType f_sp_theta =
+        (1 + c.B_sp * (1 - cosTheta * cosTheta)) * cosTheta;
+
+    const NumericType sqrtE = std::sqrt(E);
+    const NumericType Y_sp =
+        c.A_sp * std::max(sqrtE - c.sqrtEth_sp, NumericType(0.)) * f_sp_theta;
+    const NumericType Y_Si =
+        c.A_ie * std::max(sqrtE - c.sqrtEth_ie, NumericType(0.)) * f_ie_theta;
+    const NumericType Y_O = params.Passivation.A_ie *
+                            std::max(sqrtE - sqrtEthPassivation, NumericType(0.)) *
+                            f_ie_theta;
 
     assert(Y_sp >= 0. && "Invalid yield");
     assert(Y_Si >= 0. && "Invalid yield");
@@ -255,31 +273,19 @@ public:
                     const unsigned int primId, const int materialId,
                     const viennaray::TracingData<NumericType> *globalData,
                     RNG &Rng) override final {
+    sourceEnergy.update(E);
     auto cosTheta = -DotProduct(rayDir, geomNormal);
 
     assert(cosTheta >= 0 && "Hit backside of disc");
     assert(cosTheta <= 1 + 1e-6 && "Error in calculating cos theta");
 
-    NumericType incAngle =
-        std::acos(std::max(std::min(cosTheta, static_cast<NumericType>(1.)),
-                           static_cast<NumericType>(0.)));
+    const NumericType incAngle = reflection.getIncidentAngle(cosTheta);
 
     // Small incident angles are reflected with the energy fraction centered at
-    // 0
-    NumericType Eref_peak;
-    if (incAngle >= params.Ions.inflectAngle) {
-      Eref_peak = (1 - (1 - A) * (M_PI_2 - incAngle) /
-                           (M_PI_2 - params.Ions.inflectAngle));
-    } else {
-      Eref_peak =
-          A * std::pow(incAngle / params.Ions.inflectAngle, params.Ions.n_l);
-    }
-    // Gaussian distribution around the Eref_peak scaled by the particle energy
-    NumericType NewEnergy;
-    std::normal_distribution<NumericType> normalDist(E * Eref_peak, 0.1 * E);
-    do {
-      NewEnergy = normalDist(Rng);
-    } while (NewEnergy > E || NewEnergy < 0.);
+    // 0, the fraction is normally distributed around the peak
+    const NumericType NewEnergy =
+        E * reflection.sampleEnergyFraction(
+                reflection.getPeakEnergyFraction(cosTheta), Rng);
 
     // Set the flag to stop tracing if the energy is below the threshold
     if (NewEnergy > params.Si.Eth_ie) {
@@ -293,6 +299,11 @@ public:
     }
   }
   void initNew(RNG &rngState) override final {
+    // the energy is sampled by the source
+    if (distribution) {
+      sourceEnergy.reset();
+      return;
+    }
     std::normal_distribution<NumericType> normalDist{params.Ions.meanEnergy,
                                                      params.Ions.sigmaEnergy};
     do {
@@ -308,8 +319,13 @@ public:
 
 private:
   const SF6O2Parameters<NumericType> &params;
+  SmartPointer<IonEnergyAngleDistribution<NumericType>> distribution;
   const NumericType A;
+  const IonReflectionTable<NumericType> reflection;
+  IonYieldTable<NumericType> yields;
+  const NumericType sqrtEthPassivation;
   NumericType E;
+  SourceEnergy<NumericType> sourceEnergy;
 };
 
 template <typename NumericType, int D>
@@ -436,6 +452,19 @@ public:
 
   SF6O2Parameters<NumericType> &getParameters() { return params; }
 
+  // Sample the energy and polar angle of the ions from a tabulated
+  // distribution instead of the Gaussian energy distribution and the power
+  // cosine source. Passing nullptr restores the default source.
+  void setIonEnergyAngleDistribution(
+      SmartPointer<IonEnergyAngleDistribution<NumericType>> distribution) {
+    this->particles[0] =
+        std::make_unique<impl::SF6O2Ion<NumericType, D>>(params, distribution);
+    this->setParticleSource(
+        0, distribution
+               ? SmartPointer<IEADSource<NumericType, D>>::New(distribution)
+               : nullptr);
+  }
+
 private:
   void initializeModel() {
     // particles
@@ -448,7 +477,7 @@ private:
         SmartPointer<impl::SF6O2SurfaceModel<NumericType, D>>::New(params);
 
     // velocity field
-    auto velField = SmartPointer<DefaultVelocityField<NumericType>>::New(2);
+    auto velField = SmartPointer<DefaultVelocityField<NumericType>>::New(3);
 
     this->setSurfaceModel(surfModel);
     this->setVelocityField(velField);
@@ -456,6 +485,8 @@ private:
     this->insertNextParticleType(ion);
     this->insertNextParticleType(etchant);
     this->insertNextParticleType(oxygen);
+    // the ion flux does not depend on the surface coverages
+    this->setParticleCoverageIndependent(0);
   }
 
   SF6O2Parameters<NumericType> params;
@@ -72,7 +72,7 @@ public:
            ev_ * Coverage->at(i)) *
           dt_ / s0_;
 
-      Coverage->at(i) = std::min(Coverage->at(i), 1.);
+      Coverage->at(i) = std::min<NumericType>(Coverage->at(i), 1.);
     }
   }
 };
@@ -151,7 +151,7 @@ public:
             coverageTimeStep, gpc, evFlux, inFlux, stickingProbability, s0);
 
     // velocity field
-    auto velField = SmartPointer<DefaultVelocityField<NumericType>>::New(2);
+    auto velField = SmartPointer<DefaultVelocityField<NumericType>>::New(3);
 
     this->setSurfaceModel(surfModel);
     this->setVelocityField(velField);
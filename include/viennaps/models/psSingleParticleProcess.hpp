@@ -14,7 +14,7 @@ namespace impl {
 template <typename NumericType, int D>
 class SingleParticleSurfaceModel : public viennaps::SurfaceModel<NumericType> {
   const NumericType rateFactor_;
-  const std::vector<Material> maskMaterials_;
+  const MaterialMask maskMaterials_;
 
 public:
   SingleParticleSurfaceModel(NumericType rate,
@@ -31,22 +31,13 @@ public:
     auto flux = rates->getScalarData("particleFlux");
 
     for (std::size_t i = 0; i < velocity->size(); i++) {
-      if (!isMaskMaterial(materialIds[i])) {
+      if (!maskMaterials_.test(materialIds[i])) {
         velocity->at(i) = flux->at(i) * rateFactor_;
       }
     }
 
     return velocity;
   }
-
-private:
-  bool isMaskMaterial(const NumericType &material) const {
-    for (const auto &mat : maskMaterials_) {
-      if (MaterialMap::isMaterial(material, mat))
-        return true;
-    }
-    return false;
-  }
 };
 
 template <typename NumericType, int D>
@@ -123,7 +114,7 @@ private:
             rate, maskMaterial);
 
     // velocity field
-    auto velField = SmartPointer<DefaultVelocityField<NumericType>>::New(2);
+    auto velField = SmartPointer<DefaultVelocityField<NumericType>>::New(3);
 
     this->setSurfaceModel(surfModel);
     this->setVelocityField(velField);
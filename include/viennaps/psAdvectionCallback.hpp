@@ -1,6 +1,9 @@
 #pragma once
 
 #include "psDomain.hpp"
+#include "psTranslator.hpp"
+
+#include <lsMesh.hpp>
 
 #include <vcSmartPointer.hpp>
 
@@ -11,6 +14,13 @@ using namespace viennacore;
 template <typename NumericType, int D> class AdvectionCallback {
 protected:
   SmartPointer<Domain<NumericType, D>> domain = nullptr;
+  // The surface disk mesh of the top Level-Set and the translator from
+  // Level-Set point IDs to mesh point IDs, both owned by the process. They
+  // are current when applyPreAdvect and applyPostAdvect are called, but not
+  // in applyPostAdvectDeferred. nullptr if the callback is applied without a
+  // surface.
+  SmartPointer<viennals::Mesh<NumericType>> diskMesh = nullptr;
+  SmartPointer<Translator> translator = nullptr;
 
 public:
   virtual ~AdvectionCallback() = default;
@@ -19,9 +29,22 @@ public:
     domain = passedDomain;
   }
 
+  void setSurface(SmartPointer<viennals::Mesh<NumericType>> passedDiskMesh,
+                  SmartPointer<Translator> passedTranslator) {
+    diskMesh = passedDiskMesh;
+    translator = passedTranslator;
+  }
+
   virtual bool applyPreAdvect(const NumericType processTime) { return true; }
 
   virtual bool applyPostAdvect(const NumericType advectionTime) { return true; }
+
+  // Work after the advection which only changes data owned by the callback
+  // (e.g. the Cell-Set) and is not needed to calculate the velocities of the
+  // next step. In a pipelined process it runs concurrently with the surface
+  // extraction and flux calculation of the next step and is always finished
+  // before the next call to applyPreAdvect.
+  virtual void applyPostAdvectDeferred(const NumericType advectionTime) {}
 };
 
 } // namespace viennaps
@@ -1,14 +1,17 @@
 #pragma once
 
+#include "psCheckpoint.hpp"
+#include "psCoverageStore.hpp"
 #include "psDomain.hpp"
 #include "psProcessModel.hpp"
+#include "psRayTracing.hpp"
+#include "psToDiskMesh.hpp"
 #include "psTranslationField.hpp"
 #include "psUtils.hpp"
 
 #include <lsAdvect.hpp>
 #include <lsDomain.hpp>
 #include <lsMesh.hpp>
-#include <lsToDiskMesh.hpp>
 
 #include <rayReflection.hpp>
 #include <raySource.hpp>
@@ -54,7 +57,7 @@ private:
 };
 
 template <typename NumericType, int D> class AtomicLayerProcess {
-  using translatorType = std::unordered_map<unsigned long, unsigned long>;
+  using translatorType = Translator;
   using psDomainType = SmartPointer<Domain<NumericType, D>>;
 
 public:
@@ -94,11 +97,58 @@ public:
 
   void setNumCycles(unsigned int numCycles) { numCycles_ = numCycles; }
 
+  // Write a checkpoint of the domain and the process state to the given file
+  // after completed cycles. The file is written in the background.
+  void setCheckpointFile(std::string fileName) {
+    checkpointFile_ = std::move(fileName);
+  }
+
+  // Set the number of cycles between two checkpoints. If this is set to zero,
+  // the number of cycles is not used to trigger checkpoints.
+  void setCheckpointInterval(unsigned int numCycles) {
+    checkpointInterval_ = numCycles;
+  }
+
+  // Set the wall-clock time in seconds between two checkpoints. If this is set
+  // to a non-positive value, the wall-clock time is not used to trigger
+  // checkpoints. Defaults to 600 seconds.
+  void setCheckpointWallClockInterval(double seconds) {
+    checkpointWallClockInterval_ = seconds;
+  }
+
+  // Resume the process from a checkpoint file. The completed cycles stored in
+  // the checkpoint are skipped. The file is only used for the next call to
+  // apply().
+  void setRestartFile(std::string fileName) {
+    restartFile_ = std::move(fileName);
+  }
+
   // Specify the number of rays to be traced for each particle throughout the
   // process. The total count of rays is the product of this number and the
   // number of points in the process geometry.
   void setNumberOfRaysPerPoint(unsigned numRays) { raysPerPoint_ = numRays; }
 
+  /// Enable adaptive ray tracing. Each particle type is first traced with
+  /// initialRaysPerPoint rays per point. If the mean relative error of the
+  /// flux is above targetError, the missing rays are traced in a second batch.
+  /// The number of rays per point set with setNumberOfRaysPerPoint is the
+  /// upper limit.
+  void enableAdaptiveRayTracing(NumericType targetError = 0.05,
+                                unsigned initialRaysPerPoint = 100) {
+    adaptiveRayTracing_.enabled = true;
+    adaptiveRayTracing_.targetError = targetError;
+    adaptiveRayTracing_.initialRaysPerPoint = initialRaysPerPoint;
+  }
+
+  // Trace the fixed number of rays per point for every particle type.
+  void disableAdaptiveRayTracing() { adaptiveRayTracing_.enabled = false; }
+
+  // Returns the number of rays traced in each coverage time step of the last
+  // process.
+  const std::vector<std::size_t> &getTracedRaysPerStep() const {
+    return tracedRaysPerStep_;
+  }
+
   // Set the integration scheme for solving the level-set equation.
   // Possible integration schemes are specified in
   // viennals::IntegrationSchemeEnum.
@@ -122,18 +172,35 @@ public:
     /* ---------- Process Setup --------- */
     Timer processTimer;
     processTimer.start();
+    tracedRaysPerStep_.clear();
 
     auto name = pModel_->getProcessName().value_or("default");
 
+    // restore the domain and the completed cycles from a checkpoint, this has
+    // to happen before the material map is passed on
+    CheckpointState<NumericType> restartState;
+    bool resumed = false;
+    if (!restartFile_.empty()) {
+      resumed = Checkpoint<NumericType, D>::read(restartFile_, pDomain_,
+                                                 restartState);
+      if (resumed) {
+        Logger::getInstance()
+            .addInfo("Resuming process from checkpoint after cycle " +
+                     std::to_string(restartState.counter) + ".")
+            .print();
+      } else {
+        Logger::getInstance()
+            .addWarning("Could not resume from checkpoint " + restartFile_ +
+                        ". Starting from the beginning.")
+            .print();
+      }
+      restartFile_.clear();
+    }
+
     const NumericType gridDelta = pDomain_->getGrid().getGridDelta();
     auto diskMesh = SmartPointer<viennals::Mesh<NumericType>>::New();
     auto translator = SmartPointer<translatorType>::New();
-    viennals::ToDiskMesh<NumericType, D> meshConverter(diskMesh);
-    meshConverter.setTranslator(translator);
-    if (pDomain_->getMaterialMap()) {
-      meshConverter.setMaterialMap(
-          pDomain_->getMaterialMap()->getMaterialMap());
-    }
+    ToDiskMesh<NumericType, D> meshConverter(pDomain_, diskMesh, translator);
 
     auto transField = SmartPointer<TranslationField<NumericType>>::New(
         pModel_->getVelocityField(), pDomain_->getMaterialMap());
@@ -145,7 +212,6 @@ public:
     advectionKernel.setAdvectionTime(1.);
 
     for (auto dom : pDomain_->getLevelSets()) {
-      meshConverter.insertNextLevelSet(dom);
       advectionKernel.insertNextLevelSet(dom);
     }
 
@@ -183,6 +249,8 @@ public:
         particleDataLogs_[i].data[0].resize(logSize);
       }
     }
+    if (resumed && restartState.particleDataLogs.size() == numParticles)
+      particleDataLogs_ = std::move(restartState.particleDataLogs);
 
     auto surfaceModel = pModel_->getSurfaceModel();
 
@@ -193,8 +261,14 @@ public:
     if (useProcessParams)
       Logger::getInstance().addInfo("Using process parameters.").print();
 
+    CheckpointWriter<NumericType, D> checkpointWriter;
+    const bool useCheckpoints = !checkpointFile_.empty();
+    auto lastCheckpointClock = std::chrono::steady_clock::now();
+
+    CoverageStore<NumericType> coverageStore;
     size_t counter = 0;
-    int numCycles = 0;
+    int numCycles = resumed ? static_cast<int>(restartState.counter) : 0;
+    int lastCheckpointCycle = numCycles;
     while (numCycles++ < numCycles_) {
       Logger::getInstance()
           .addInfo("Cycle: " + std::to_string(numCycles) + "/" +
@@ -204,6 +278,10 @@ public:
       meshConverter.apply();
       auto numPoints = diskMesh->nodes.size();
       surfaceModel->initializeCoverages(numPoints);
+      coverageStore.initialize(surfaceModel->getCoverages(),
+                               useProcessParams
+                                   ? surfaceModel->getProcessParameters()
+                                   : nullptr);
       auto rates = SmartPointer<viennals::PointData<NumericType>>::New();
       auto const materialIds =
           *diskMesh->getCellData().getScalarData("MaterialIds");
@@ -228,54 +306,30 @@ public:
             .print();
 
         // move coverages to ray tracer
-        auto rayTraceCoverages =
-            movePointDataToRayData(surfaceModel->getCoverages());
-
-        if (useProcessParams) {
-          // store scalars in addition to coverages
-          auto processParams = surfaceModel->getProcessParameters();
-          NumericType numParams = processParams->getScalarData().size();
-          rayTraceCoverages.setNumberOfScalarData(numParams);
-          for (size_t i = 0; i < numParams; ++i) {
-            rayTraceCoverages.setScalarData(
-                i, processParams->getScalarData(i),
-                processParams->getScalarDataLabel(i));
-          }
-        }
-        rayTracer.setGlobalData(rayTraceCoverages);
+        rayTracer.setGlobalData(coverageStore.moveToRayData());
 
-        rates->clear();
+        impl::RateStore<NumericType> rateStore;
         std::size_t particleIdx = 0;
+        std::size_t tracedRays = 0;
         for (auto &particle : pModel_->getParticleTypes()) {
-          int dataLogSize = pModel_->getParticleLogSize(particleIdx);
-          if (dataLogSize > 0) {
-            rayTracer.getDataLog().data.resize(1);
-            rayTracer.getDataLog().data[0].resize(dataLogSize, 0.);
-          }
-          rayTracer.setParticleType(particle);
-          rayTracer.apply();
-
           // fill up rates vector with rates from this particle type
-          auto numRates = particle->getLocalDataLabels().size();
-          auto &localData = rayTracer.getLocalData();
-          for (int i = 0; i < numRates; ++i) {
-            auto rate = std::move(localData.getVectorData(i));
-
-            // normalize rates
-            rayTracer.normalizeFlux(rate);
-            rayTracer.smoothFlux(rate);
-            rates->insertNextScalarData(std::move(rate),
-                                        localData.getVectorDataLabel(i));
-          }
-
-          if (dataLogSize > 0) {
-            particleDataLogs_[particleIdx].merge(rayTracer.getDataLog());
-          }
+          tracedRays += impl::traceParticle(
+              rayTracer, particle, points.size(), raysPerPoint_,
+              adaptiveRayTracing_, true, rateStore,
+              particleDataLogs_[particleIdx],
+              pModel_->getParticleLogSize(particleIdx));
           ++particleIdx;
         }
+        rates = rateStore.toPointData();
+        tracedRaysPerStep_.push_back(tracedRays);
+        if (adaptiveRayTracing_.enabled) {
+          Logger::getInstance()
+              .addInfo("Traced rays: " + std::to_string(tracedRays))
+              .print();
+        }
 
         // move coverages back to model
-        moveRayDataToPointData(surfaceModel->getCoverages(), rayTraceCoverages);
+        coverageStore.moveToPointData();
         surfaceModel->updateCoverages(rates, materialIds);
 
         // print debug output
@@ -319,8 +373,7 @@ public:
           purgeTracer.setPrimaryDirection(primaryDirection.value());
 
         // move coverages to ray tracer
-        auto rayTraceCoverages =
-            movePointDataToRayData(surfaceModel->getCoverages());
+        auto &rayTraceCoverages = coverageStore.moveToRayData();
         purgeTracer.setGlobalData(rayTraceCoverages);
 
         std::size_t particleIdx = 0;
@@ -348,6 +401,7 @@ public:
           ++particleIdx;
         }
 
+        coverageStore.moveToPointData();
         surfaceModel->updateCoverages(purgeRates, materialIds);
 
       } // end of purge pulse
@@ -356,8 +410,7 @@ public:
       auto velocities =
           surfaceModel->calculateVelocities(rates, points, materialIds);
       pModel_->getVelocityField()->setVelocities(velocities);
-      if (pModel_->getVelocityField()->getTranslationFieldOptions() == 2)
-        transField->buildKdTree(points);
+      transField->buildNearestPointIndex(points, gridDelta);
 
       // print debug output
       if (Logger::getLogLevel() >= 4) {
@@ -367,6 +420,28 @@ public:
       }
 
       advectionKernel.apply();
+
+      if (useCheckpoints) {
+        const auto now = std::chrono::steady_clock::now();
+        const double wallClockTime =
+            std::chrono::duration<double>(now - lastCheckpointClock).count();
+        if ((checkpointInterval_ > 0 &&
+             numCycles - lastCheckpointCycle >=
+                 static_cast<int>(checkpointInterval_)) ||
+            (checkpointWallClockInterval_ > 0. &&
+             wallClockTime >= checkpointWallClockInterval_)) {
+          checkpointWriter.write(checkpointFile_, pDomain_,
+                                 getCheckpointState(numCycles));
+          lastCheckpointClock = now;
+          lastCheckpointCycle = numCycles;
+        }
+      }
+    }
+
+    if (useCheckpoints) {
+      checkpointWriter.write(checkpointFile_, pDomain_,
+                             getCheckpointState(numCycles - 1));
+      checkpointWriter.wait();
     }
 
     processTimer.finish();
@@ -391,35 +466,20 @@ public:
   }
 
 private:
+  CheckpointState<NumericType> getCheckpointState(int completedCycles) const {
+    CheckpointState<NumericType> state;
+    state.processDuration = numCycles_;
+    state.elapsedTime = completedCycles;
+    state.counter = completedCycles;
+    state.particleDataLogs = particleDataLogs_;
+    return state;
+  }
+
   void printDiskMesh(SmartPointer<viennals::Mesh<NumericType>> mesh,
                      std::string name) const {
     viennals::VTKWriter<NumericType>(mesh, std::move(name)).apply();
   }
 
-  viennaray::TracingData<NumericType> movePointDataToRayData(
-      SmartPointer<viennals::PointData<NumericType>> pointData) {
-    viennaray::TracingData<NumericType> rayData;
-    const auto numData = pointData->getScalarDataSize();
-    rayData.setNumberOfVectorData(numData);
-    for (size_t i = 0; i < numData; ++i) {
-      auto label = pointData->getScalarDataLabel(i);
-      rayData.setVectorData(i, std::move(*pointData->getScalarData(label)),
-                            label);
-    }
-
-    return std::move(rayData);
-  }
-
-  void moveRayDataToPointData(
-      SmartPointer<viennals::PointData<NumericType>> pointData,
-      viennaray::TracingData<NumericType> &rayData) {
-    pointData->clear();
-    const auto numData = rayData.getVectorData().size();
-    for (size_t i = 0; i < numData; ++i)
-      pointData->insertNextScalarData(std::move(rayData.getVectorData(i)),
-                                      rayData.getVectorDataLabel(i));
-  }
-
   void checkInput() const {
     if (!pDomain_) {
       Logger::getInstance()
@@ -480,6 +540,8 @@ private:
   viennals::IntegrationSchemeEnum integrationScheme_ =
       viennals::IntegrationSchemeEnum::ENGQUIST_OSHER_1ST_ORDER;
   unsigned raysPerPoint_ = 1000;
+  AdaptiveRayTracingParameters<NumericType> adaptiveRayTracing_;
+  std::vector<std::size_t> tracedRaysPerStep_;
   bool useRandomSeeds_ = true;
   std::vector<viennaray::DataLog<NumericType>> particleDataLogs_;
 
@@ -488,6 +550,11 @@ private:
   NumericType purgePulseTime_ = 0.;
   NumericType coverageTimeStep_ = 1.;
   std::vector<NumericType> desorptionRates_;
+
+  std::string checkpointFile_;
+  std::string restartFile_;
+  unsigned int checkpointInterval_ = 0;
+  double checkpointWallClockInterval_ = 600.;
 };
 
 } // namespace viennaps
@@ -0,0 +1,310 @@
+#pragma once
+
+#include "psMaterials.hpp"
+
+#include <csDenseCellSet.hpp>
+
+#include <vcSmartPointer.hpp>
+#include <vcVectorUtil.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace viennaps {
+
+using namespace viennacore;
+
+/// Diffusion-advection solver for a scalar quantity on the cells of a dense
+/// cell set. Only the cells of one material (the active cells) take part.
+/// They are compacted into contiguous arrays, together with a neighbor table
+/// which refers to the compacted indices. The neighbor table of the whole
+/// cell set is only queried again if the cell set changes, a change of the
+/// cell materials only requires the compaction to be repeated.
+///
+/// The transport is described by a linear stencil per active cell,
+///   du_i/dt = diagonal_i * u_i + sum_k neighbors_ik * u_k,
+/// which is integrated either explicitly (forward Euler) or implicitly
+/// (backward Euler). The implicit system is solved with a Jacobi
+/// preconditioned BiCGSTAB method and is not subject to the stability limit
+/// of the explicit integration.
+template <class NumericType, int D> class CellSetDiffusion {
+public:
+  using NeighborArray = std::array<int, 2 * D>;
+
+  struct Stencil {
+    NumericType diagonal = 0.;
+    std::array<NumericType, 2 * D> neighbors{};
+  };
+
+  // Update the active cells from the current materials of the cell set.
+  void update(SmartPointer<viennacs::DenseCellSet<NumericType, D>> cellSet,
+              const Material activeMaterial) {
+    const auto numCells = cellSet->getNumberOfCells();
+    if (cellSet.get() != cellSet_ || numCells != cellNeighbors_.size())
+      buildCellTables(cellSet);
+
+    auto materialIds = cellSet->getScalarData("Material");
+    std::vector<int> compactIds(numCells, -1);
+    activeCells_.clear();
+    for (unsigned e = 0; e < numCells; ++e) {
+      if (MaterialMap::isMaterial((*materialIds)[e], activeMaterial)) {
+        compactIds[e] = static_cast<int>(activeCells_.size());
+        activeCells_.push_back(e);
+      }
+    }
+
+    const auto numActive = activeCells_.size();
+    neighbors_.resize(numActive);
+    for (std::size_t i = 0; i < numActive; ++i) {
+      const auto &cellNeighbors = cellNeighbors_[activeCells_[i]];
+      for (int k = 0; k < 2 * D; ++k) {
+        neighbors_[i][k] =
+            cellNeighbors[k] == -1 ? -1 : compactIds[cellNeighbors[k]];
+      }
+    }
+
+    stencils_.assign(numActive, Stencil{});
+    solution_.resize(numActive);
+    buffer_.resize(numActive);
+  }
+
+  // Set the stencils to isotropic diffusion between active cells, with zero
+  // flux to inactive cells and the boundaries.
+  void setDiffusion(const NumericType diffusionCoefficient) {
+    const NumericType rate = diffusionCoefficient / (gridDelta_ * gridDelta_);
+    const auto numActive = static_cast<long>(activeCells_.size());
+#pragma omp parallel for
+    for (long i = 0; i < numActive; ++i) {
+      auto &stencil = stencils_[i];
+      stencil.diagonal = 0.;
+      for (int k = 0; k < 2 * D; ++k) {
+        const bool active = neighbors_[i][k] != -1;
+        stencil.neighbors[k] = active ? rate : NumericType(0.);
+        stencil.diagonal -= active ? rate : NumericType(0.);
+      }
+    }
+  }
+
+  // Copy the values of the active cells from the cell data.
+  void gather(const std::vector<NumericType> &cellData) {
+    const auto numActive = static_cast<long>(activeCells_.size());
+#pragma omp parallel for
+    for (long i = 0; i < numActive; ++i)
+      solution_[i] = cellData[activeCells_[i]];
+  }
+
+  // Write the values of the active cells to the cell data. All other cells
+  // are set to the given value.
+  void scatter(std::vector<NumericType> &cellData,
+               const NumericType inactiveValue = 0.) const {
+    std::fill(cellData.begin(), cellData.end(), inactiveValue);
+    const auto numActive = static_cast<long>(activeCells_.size());
+#pragma omp parallel for
+    for (long i = 0; i < numActive; ++i)
+      cellData[activeCells_[i]] = solution_[i];
+  }
+
+  void explicitStep(const NumericType dt) {
+    applyStencils(solution_.data(), buffer_.data(), dt);
+    std::swap(solution_, buffer_);
+  }
+
+  // Returns false if the linear solver did not converge.
+  bool implicitStep(const NumericType dt) {
+    const auto numActive = static_cast<long>(activeCells_.size());
+    if (numActive == 0)
+      return true;
+
+    // Solve (I - dt * L) x = b with b the current solution.
+    auto &x = buffer_;
+    auto &b = solution_;
+    invDiagonal_.resize(numActive);
+    r_.resize(numActive);
+    rHat_.resize(numActive);
+    p_.resize(numActive);
+    v_.resize(numActive);
+    y_.resize(numActive);
+    t_.resize(numActive);
+
+#pragma omp parallel for
+    for (long i = 0; i < numActive; ++i) {
+      invDiagonal_[i] = NumericType(1.) / (1 - dt * stencils_[i].diagonal);
+      x[i] = b[i];
+    }
+
+    // the solution of the last step is the initial guess
+    applySystem(x.data(), r_.data(), dt);
+    NumericType bNorm = 0.;
+#pragma omp parallel for reduction(+ : bNorm)
+    for (long i = 0; i < numActive; ++i) {
+      r_[i] = b[i] - r_[i];
+      rHat_[i] = r_[i];
+      p_[i] = 0.;
+      v_[i] = 0.;
+      bNorm += b[i] * b[i];
+    }
+    const NumericType tolerance =
+        relativeTolerance_ * relativeTolerance_ *
+        std::max(bNorm, std::numeric_limits<NumericType>::min());
+
+    NumericType rho = 1., alpha = 1., omega = 1.;
+    bool converged = dot(r_, r_) <= tolerance;
+    for (unsigned it = 0; it < maxIterations_ && !converged; ++it) {
+      const NumericType rhoNew = dot(rHat_, r_);
+      if (rhoNew == 0.)
+        break;
+      const NumericType beta = (rhoNew / rho) * (alpha / omega);
+#pragma omp parallel for
+      for (long i = 0; i < numActive; ++i) {
+        p_[i] = r_[i] + beta * (p_[i] - omega * v_[i]);
+        y_[i] = invDiagonal_[i] * p_[i];
+      }
+      applySystem(y_.data(), v_.data(), dt);
+      alpha = rhoNew / dot(rHat_, v_);
+
+      // r is reused for s, y for z = M^-1 s
+      NumericType sNorm = 0.;
+#pragma omp parallel for reduction(+ : sNorm)
+      for (long i = 0; i < numActive; ++i) {
+        x[i] += alpha * y_[i];
+        r_[i] -= alpha * v_[i];
+        y_[i] = invDiagonal_[i] * r_[i];
+        sNorm += r_[i] * r_[i];
+      }
+      if (sNorm <= tolerance) {
+        converged = true;
+        break;
+      }
+
+      applySystem(y_.data(), t_.data(), dt);
+      NumericType ts = 0., tt = 0.;
+#pragma omp parallel for reduction(+ : ts, tt)
+      for (long i = 0; i < numActive; ++i) {
+        ts += t_[i] * r_[i];
+        tt += t_[i] * t_[i];
+      }
+      if (tt == 0.)
+        break;
+      omega = ts / tt;
+
+      NumericType rNorm = 0.;
+#pragma omp parallel for reduction(+ : rNorm)
+      for (long i = 0; i < numActive; ++i) {
+        x[i] += omega * y_[i];
+        r_[i] -= omega * t_[i];
+        rNorm += r_[i] * r_[i];
+      }
+      converged = rNorm <= tolerance;
+      rho = rhoNew;
+    }
+
+    std::swap(solution_, buffer_);
+    return converged;
+  }
+
+  void setRelativeTolerance(const NumericType tolerance) {
+    relativeTolerance_ = tolerance;
+  }
+
+  void setMaxIterations(const unsigned maxIterations) {
+    maxIterations_ = maxIterations;
+  }
+
+  std::size_t size() const { return activeCells_.size(); }
+
+  // Index of the active cell in the cell set.
+  unsigned getCellIndex(std::size_t i) const { return activeCells_[i]; }
+
+  const Vec3D<NumericType> &getCellCenter(std::size_t i) const {
+    return cellCenters_[activeCells_[i]];
+  }
+
+  // Compacted indices of the neighbors of an active cell, -1 if the neighbor
+  // is not active. The order is the same as in the cell set.
+  const NeighborArray &getNeighbors(std::size_t i) const {
+    return neighbors_[i];
+  }
+
+  std::vector<Stencil> &getStencils() { return stencils_; }
+
+  std::vector<NumericType> &getSolution() { return solution_; }
+
+  NumericType getGridDelta() const { return gridDelta_; }
+
+private:
+  void buildCellTables(
+      SmartPointer<viennacs::DenseCellSet<NumericType, D>> cellSet) {
+    cellSet_ = cellSet.get();
+    gridDelta_ = cellSet->getGridDelta();
+    const auto numCells = cellSet->getNumberOfCells();
+    const auto &elems = cellSet->getElements();
+    const auto &nodes = cellSet->getNodes();
+
+    cellNeighbors_.resize(numCells);
+    cellCenters_.resize(numCells);
+    for (unsigned e = 0; e < numCells; ++e) {
+      const auto &cellNeighbors = cellSet->getNeighbors(e);
+      std::copy(cellNeighbors.begin(), cellNeighbors.end(),
+                cellNeighbors_[e].begin());
+      const auto &node = nodes[elems[e][0]];
+      for (int i = 0; i < 3; ++i)
+        cellCenters_[e][i] = node[i] + (i < D ? gridDelta_ / 2 : 0.);
+    }
+  }
+
+  // out = in + dt * L * in
+  void applyStencils(const NumericType *in, NumericType *out,
+                     const NumericType dt) const {
+    const auto numActive = static_cast<long>(activeCells_.size());
+#pragma omp parallel for
+    for (long i = 0; i < numActive; ++i) {
+      const auto &stencil = stencils_[i];
+      NumericType flux = stencil.diagonal * in[i];
+      for (int k = 0; k < 2 * D; ++k) {
+        const int n = neighbors_[i][k];
+        if (n != -1)
+          flux += stencil.neighbors[k] * in[n];
+      }
+      out[i] = in[i] + dt * flux;
+    }
+  }
+
+  // out = (I - dt * L) * in
+  void applySystem(const NumericType *in, NumericType *out,
+                   const NumericType dt) const {
+    applyStencils(in, out, -dt);
+  }
+
+  NumericType dot(const std::vector<NumericType> &a,
+                  const std::vector<NumericType> &b) const {
+    const auto numActive = static_cast<long>(a.size());
+    NumericType result = 0.;
+#pragma omp parallel for reduction(+ : result)
+    for (long i = 0; i < numActive; ++i)
+      result += a[i] * b[i];
+    return result;
+  }
+
+  // tables of the whole cell set
+  const viennacs::DenseCellSet<NumericType, D> *cellSet_ = nullptr;
+  std::vector<NeighborArray> cellNeighbors_;
+  std::vector<Vec3D<NumericType>> cellCenters_;
+  NumericType gridDelta_ = 1.;
+
+  // compacted active cells
+  std::vector<unsigned> activeCells_;
+  std::vector<NeighborArray> neighbors_;
+  std::vector<Stencil> stencils_;
+  std::vector<NumericType> solution_;
+  std::vector<NumericType> buffer_;
+
+  // implicit solver
+  NumericType relativeTolerance_ = 1e-6;
+  unsigned maxIterations_ = 200;
+  std::vector<NumericType> invDiagonal_, r_, rHat_, p_, v_, y_, t_;
+};
+
+} // namespace viennaps
@@ -0,0 +1,377 @@
+#pragma once
+
+#include "psDomain.hpp"
+
+#include <lsPointData.hpp>
+#include <rayParticle.hpp>
+
+#include <vcLogger.hpp>
+#include <vcSmartPointer.hpp>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <future>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace viennaps {
+
+using namespace viennacore;
+
+/// Loop state of a process which is stored in a checkpoint together with the
+/// domain.
+template <class NumericType> struct CheckpointState {
+  NumericType processDuration = 0.;
+  NumericType elapsedTime = 0.;
+  NumericType previousTimeStep = 0.;
+  // Output counter (Process) or number of completed cycles
+  // (AtomicLayerProcess).
+  std::uint64_t counter = 0;
+  bool coveragesInitialized = false;
+  SmartPointer<viennals::PointData<NumericType>> coverages = nullptr;
+  std::vector<viennaray::DataLog<NumericType>> particleDataLogs;
+};
+
+/// Binary checkpoint of a process run. A checkpoint holds all Level-Sets of
+/// the domain, the material map, the Cell-Set data and the process state, so
+/// an interrupted run can be resumed from the last checkpoint.
+template <class NumericType, int D> class Checkpoint {
+  using psDomainType = SmartPointer<Domain<NumericType, D>>;
+  using StateType = CheckpointState<NumericType>;
+
+  static constexpr char fileIdentifier[] = "psCheckpoint";
+  static constexpr std::uint32_t fileVersion = 1;
+
+public:
+  static void serialize(std::ostream &stream, psDomainType domain,
+                        const StateType &state) {
+    stream.write(fileIdentifier, sizeof(fileIdentifier));
+    writeValue(stream, fileVersion);
+    writeValue(stream, static_cast<std::uint32_t>(D));
+    writeValue(stream, static_cast<std::uint32_t>(sizeof(NumericType)));
+
+    // Level-Sets
+    const auto &levelSets = domain->getLevelSets();
+    writeValue(stream, static_cast<std::uint64_t>(levelSets.size()));
+    for (auto &ls : levelSets)
+      ls->serialize(stream);
+
+    // material map
+    const auto &materialMap = domain->getMaterialMap();
+    const std::uint64_t numMaterials = materialMap ? materialMap->size() : 0;
+    writeValue(stream, numMaterials);
+    for (std::size_t i = 0; i < numMaterials; ++i)
+      writeValue(stream, static_cast<std::int32_t>(
+                             materialMap->getMaterialAtIdx(i)));
+
+    // Cell-Set data
+    const auto &cellSet = domain->getCellSet();
+    const auto cellLabels =
+        cellSet ? cellSet->getScalarDataLabels() : std::vector<std::string>{};
+    writeValue(stream, static_cast<std::uint64_t>(cellLabels.size()));
+    for (const auto &label : cellLabels) {
+      writeString(stream, label);
+      writeVector(stream, *cellSet->getScalarData(label));
+    }
+
+    // process state
+    writeValue(stream, state.processDuration);
+    writeValue(stream, state.elapsedTime);
+    writeValue(stream, state.previousTimeStep);
+    writeValue(stream, state.counter);
+    writeValue(stream, static_cast<std::uint8_t>(state.coveragesInitialized));
+
+    const std::uint64_t numCoverages =
+        state.coverages ? state.coverages->getScalarDataSize() : 0;
+    writeValue(stream, numCoverages);
+    for (std::size_t i = 0; i < numCoverages; ++i) {
+      writeString(stream, state.coverages->getScalarDataLabel(i));
+      writeVector(stream, *state.coverages->getScalarData(i));
+    }
+
+    writeValue(stream,
+               static_cast<std::uint64_t>(state.particleDataLogs.size()));
+    for (const auto &log : state.particleDataLogs) {
+      writeValue(stream, static_cast<std::uint64_t>(log.data.size()));
+      for (const auto &data : log.data)
+        writeVector(stream, data);
+    }
+  }
+
+  // Restore the domain and the process state from a stream. The domain has to
+  // contain the same number of Level-Sets as the domain the checkpoint was
+  // written from, its Level-Sets are overwritten in place. The checkpoint is
+  // read into temporaries first, so the domain and the state are left
+  // unchanged if the stream is not a valid checkpoint.
+  static bool deserialize(std::istream &stream, psDomainType domain,
+                          StateType &state) {
+    char identifier[sizeof(fileIdentifier)];
+    stream.read(identifier, sizeof(fileIdentifier));
+    if (!stream ||
+        std::memcmp(identifier, fileIdentifier, sizeof(fileIdentifier)) != 0) {
+      Logger::getInstance()
+          .addWarning("Checkpoint: Not a ViennaPS checkpoint file.")
+          .print();
+      return false;
+    }
+    if (readValue<std::uint32_t>(stream) != fileVersion ||
+        readValue<std::uint32_t>(stream) != static_cast<std::uint32_t>(D) ||
+        readValue<std::uint32_t>(stream) != sizeof(NumericType)) {
+      Logger::getInstance()
+          .addWarning("Checkpoint: File version, dimension or numeric type "
+                      "does not match.")
+          .print();
+      return false;
+    }
+
+    // Level-Sets
+    const auto &domainLevelSets = domain->getLevelSets();
+    const auto numLevelSets = readValue<std::uint64_t>(stream);
+    if (numLevelSets != domainLevelSets.size()) {
+      Logger::getInstance()
+          .addWarning("Checkpoint: Number of Level-Sets in checkpoint (" +
+                      std::to_string(numLevelSets) +
+                      ") does not match the domain (" +
+                      std::to_string(domainLevelSets.size()) + ").")
+          .print();
+      return false;
+    }
+    std::vector<SmartPointer<viennals::Domain<NumericType, D>>> levelSets;
+    for (const auto &domainLs : domainLevelSets) {
+      if (!stream)
+        break;
+      auto ls = SmartPointer<viennals::Domain<NumericType, D>>::New(domainLs);
+      ls->deserialize(stream);
+      levelSets.push_back(ls);
+    }
+
+    // material map
+    SmartPointer<MaterialMap> materialMap = nullptr;
+    const auto numMaterials = readSize(stream, sizeof(std::int32_t));
+    if (numMaterials > 0) {
+      materialMap = SmartPointer<MaterialMap>::New();
+      for (std::size_t i = 0; i < numMaterials; ++i)
+        materialMap->insertNextMaterial(
+            static_cast<Material>(readValue<std::int32_t>(stream)));
+    }
+
+    // Cell-Set data, each entry holds at least the sizes of label and data
+    std::vector<std::pair<std::string, std::vector<NumericType>>> cellData(
+        readSize(stream, 2 * sizeof(std::uint64_t)));
+    for (auto &[label, data] : cellData) {
+      label = readString(stream);
+      data = readVector<NumericType>(stream);
+    }
+
+    // process state
+    StateType newState;
+    newState.processDuration = readValue<NumericType>(stream);
+    newState.elapsedTime = readValue<NumericType>(stream);
+    newState.previousTimeStep = readValue<NumericType>(stream);
+    newState.counter = readValue<std::uint64_t>(stream);
+    newState.coveragesInitialized = readValue<std::uint8_t>(stream) != 0;
+
+    const auto numCoverages = readSize(stream, 2 * sizeof(std::uint64_t));
+    if (numCoverages > 0) {
+      newState.coverages =
+          SmartPointer<viennals::PointData<NumericType>>::New();
+    }
+    for (std::size_t i = 0; i < numCoverages; ++i) {
+      auto label = readString(stream);
+      newState.coverages->insertNextScalarData(readVector<NumericType>(stream),
+                                               label);
+    }
+
+    newState.particleDataLogs.resize(readSize(stream, sizeof(std::uint64_t)));
+    for (auto &log : newState.particleDataLogs) {
+      log.data.resize(readSize(stream, sizeof(std::uint64_t)));
+      for (auto &data : log.data)
+        data = readVector<NumericType>(stream);
+    }
+
+    if (!stream) {
+      Logger::getInstance()
+          .addWarning("Checkpoint: Unexpected end of file or corrupt data.")
+          .print();
+      return false;
+    }
+
+    // the whole checkpoint is valid, commit it to the domain and the state
+    for (std::size_t i = 0; i < levelSets.size(); ++i)
+      domainLevelSets[i]->deepCopy(levelSets[i]);
+    if (materialMap)
+      domain->setMaterialMap(materialMap);
+
+    auto &cellSet = domain->getCellSet();
+    if (!cellData.empty() && !cellSet) {
+      Logger::getInstance()
+          .addWarning("Checkpoint: Cell-Set data found, but the domain has no "
+                      "Cell-Set. The data is ignored.")
+          .print();
+    }
+    for (auto &[label, data] : cellData) {
+      if (!cellSet)
+        break;
+      if (data.size() != cellSet->getNumberOfCells()) {
+        Logger::getInstance()
+            .addWarning("Checkpoint: Cell-Set size does not match, data '" +
+                        label + "' is ignored.")
+            .print();
+        continue;
+      }
+      if (!cellSet->getScalarData(label))
+        cellSet->addScalarData(label, 0.);
+      *cellSet->getScalarData(label) = std::move(data);
+    }
+
+    state = std::move(newState);
+    return true;
+  }
+
+  static bool write(const std::string &fileName, psDomainType domain,
+                    const StateType &state) {
+    std::ofstream file(fileName, std::ios::binary);
+    if (!file.is_open()) {
+      Logger::getInstance()
+          .addWarning("Checkpoint: Could not open file " + fileName + ".")
+          .print();
+      return false;
+    }
+    serialize(file, domain, state);
+    return file.good();
+  }
+
+  static bool read(const std::string &fileName, psDomainType domain,
+                   StateType &state) {
+    std::ifstream file(fileName, std::ios::binary);
+    if (!file.is_open()) {
+      Logger::getInstance()
+          .addWarning("Checkpoint: Could not open file " + fileName + ".")
+          .print();
+      return false;
+    }
+    return deserialize(file, domain, state);
+  }
+
+private:
+  template <class T> static void writeValue(std::ostream &stream, T value) {
+    stream.write(reinterpret_cast<const char *>(&value), sizeof(T));
+  }
+
+  template <class T> static T readValue(std::istream &stream) {
+    T value{};
+    stream.read(reinterpret_cast<char *>(&value), sizeof(T));
+    return value;
+  }
+
+  static void writeString(std::ostream &stream, const std::string &str) {
+    writeValue(stream, static_cast<std::uint64_t>(str.size()));
+    stream.write(str.data(), str.size());
+  }
+
+  // Number of bytes left in the stream. Streams which cannot seek are not
+  // limited.
+  static std::uint64_t remainingBytes(std::istream &stream) {
+    const auto pos = stream.tellg();
+    if (pos < 0)
+      return std::numeric_limits<std::uint64_t>::max();
+    stream.seekg(0, std::ios::end);
+    const auto end = stream.tellg();
+    stream.seekg(pos);
+    return end > pos ? static_cast<std::uint64_t>(end - pos) : 0;
+  }
+
+  // Read the number of entries of a container. A size which does not fit
+  // into the rest of the stream marks the stream as failed, so a corrupt file
+  // never leads to a huge allocation.
+  static std::uint64_t readSize(std::istream &stream,
+                                const std::size_t minEntryBytes) {
+    const auto size = readValue<std::uint64_t>(stream);
+    if (!stream || size > remainingBytes(stream) / minEntryBytes) {
+      stream.setstate(std::ios::failbit);
+      return 0;
+    }
+    return size;
+  }
+
+  static std::string readString(std::istream &stream) {
+    std::string str(readSize(stream, 1), '\0');
+    stream.read(str.data(), str.size());
+    return str;
+  }
+
+  template <class T>
+  static void writeVector(std::ostream &stream, const std::vector<T> &vec) {
+    writeValue(stream, static_cast<std::uint64_t>(vec.size()));
+    stream.write(reinterpret_cast<const char *>(vec.data()),
+                 vec.size() * sizeof(T));
+  }
+
+  template <class T> static std::vector<T> readVector(std::istream &stream) {
+    std::vector<T> vec(readSize(stream, sizeof(T)));
+    stream.read(reinterpret_cast<char *>(vec.data()), vec.size() * sizeof(T));
+    return vec;
+  }
+};
+
+/// Writes checkpoints in the background. The domain and the process state are
+/// serialized into memory on the calling thread, so the simulation can
+/// continue right away, while the buffer is written to disk asynchronously.
+/// The file is first written to a temporary file and then renamed, so a crash
+/// during writing never corrupts the previous checkpoint.
+template <class NumericType, int D> class CheckpointWriter {
+  std::future<bool> pendingWrite_;
+
+public:
+  CheckpointWriter() = default;
+  CheckpointWriter(const CheckpointWriter &) = delete;
+  CheckpointWriter &operator=(const CheckpointWriter &) = delete;
+
+  ~CheckpointWriter() { wait(); }
+
+  void write(const std::string &fileName,
+             SmartPointer<Domain<NumericType, D>> domain,
+             const CheckpointState<NumericType> &state) {
+    std::ostringstream stream(std::ios::binary);
+    Checkpoint<NumericType, D>::serialize(stream, domain, state);
+
+    // only one write can be in flight
+    wait();
+    pendingWrite_ =
+        std::async(std::launch::async, [fileName, buffer = stream.str()]() {
+          const auto tmpFileName = fileName + ".tmp";
+          {
+            std::ofstream file(tmpFileName, std::ios::binary);
+            if (!file.is_open())
+              return false;
+            file.write(buffer.data(), buffer.size());
+            if (!file.good())
+              return false;
+          }
+          if (std::rename(tmpFileName.c_str(), fileName.c_str()) == 0)
+            return true;
+          // renaming onto an existing file is not allowed on all platforms
+          std::remove(fileName.c_str());
+          return std::rename(tmpFileName.c_str(), fileName.c_str()) == 0;
+        });
+  }
+
+  // Block until the last checkpoint is written to disk.
+  bool wait() {
+    if (!pendingWrite_.valid())
+      return true;
+    const bool success = pendingWrite_.get();
+    if (!success) {
+      Logger::getInstance()
+          .addWarning("Checkpoint: Writing checkpoint failed.")
+          .print();
+    }
+    return success;
+  }
+};
+
+} // namespace viennaps
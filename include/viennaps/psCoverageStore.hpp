@@ -0,0 +1,84 @@
+#pragma once
+
+#include "psProcessParams.hpp"
+
+#include <lsPointData.hpp>
+#include <rayTracingData.hpp>
+
+#include <vcSmartPointer.hpp>
+
+#include <utility>
+#include <vector>
+
+namespace viennaps {
+
+using namespace viennacore;
+
+/// Coverage storage shared by the surface model and the ray tracer. The layout
+/// of the ray tracing data (coverages as vector data, process parameters as
+/// scalar data) is resolved once when the store is initialized. Afterwards the
+/// coverage arrays are handed between the surface model and the ray tracer by
+/// swapping buffers, without allocations or label lookups. The ray tracing
+/// data is only read during a trace, so it can be shared by several
+/// concurrently running tracers.
+template <class NumericType> class CoverageStore {
+  viennaray::TracingData<NumericType> rayData_;
+  SmartPointer<viennals::PointData<NumericType>> coverages_ = nullptr;
+  SmartPointer<ProcessParams<NumericType>> processParams_ = nullptr;
+  std::size_t numCoverages_ = 0;
+  bool onRayTracer_ = false;
+
+public:
+  void initialize(SmartPointer<viennals::PointData<NumericType>> coverages,
+                  SmartPointer<ProcessParams<NumericType>> processParams) {
+    coverages_ = coverages;
+    processParams_ = processParams;
+    onRayTracer_ = false;
+
+    numCoverages_ = coverages_ ? coverages_->getScalarDataSize() : 0;
+    rayData_.setNumberOfVectorData(numCoverages_);
+    for (std::size_t i = 0; i < numCoverages_; ++i)
+      rayData_.setVectorData(i, std::vector<NumericType>{},
+                             coverages_->getScalarDataLabel(i));
+
+    const std::size_t numParams =
+        processParams_ ? processParams_->getScalarData().size() : 0;
+    rayData_.setNumberOfScalarData(numParams);
+    for (std::size_t i = 0; i < numParams; ++i)
+      rayData_.setScalarData(i, processParams_->getScalarData(i),
+                             processParams_->getScalarDataLabel(i));
+  }
+
+  // Hand the coverages to the ray tracer. The returned data is the same
+  // object for the whole run.
+  viennaray::TracingData<NumericType> &moveToRayData() {
+    if (onRayTracer_)
+      return rayData_;
+    // the surface model changed the number of coverages
+    if (coverages_ && coverages_->getScalarDataSize() != numCoverages_)
+      initialize(coverages_, processParams_);
+
+    for (std::size_t i = 0; i < numCoverages_; ++i)
+      std::swap(*coverages_->getScalarData(i), rayData_.getVectorData(i));
+    // parameter values might have been changed by the surface model
+    if (processParams_) {
+      for (std::size_t i = 0; i < processParams_->getScalarData().size(); ++i)
+        rayData_.getScalarData(i) = processParams_->getScalarData(i);
+    }
+    onRayTracer_ = true;
+    return rayData_;
+  }
+
+  // Hand the coverages back to the surface model.
+  void moveToPointData() {
+    if (!onRayTracer_)
+      return;
+    for (std::size_t i = 0; i < numCoverages_; ++i)
+      std::swap(*coverages_->getScalarData(i), rayData_.getVectorData(i));
+    onRayTracer_ = false;
+  }
+
+  viennaray::TracingData<NumericType> &getRayData() { return rayData_; }
+};
+
+} // namespace viennaps
@@ -1,24 +1,33 @@
 #pragma once
 
 #include "psGDSUtils.hpp"
+#include "psPolygonTriangulation.hpp"
 
 #include <lsBooleanOperation.hpp>
 #include <lsDomain.hpp>
 #include <lsFromSurfaceMesh.hpp>
 #include <lsGeometries.hpp>
 #include <lsMakeGeometry.hpp>
-#include <lsTransformMesh.hpp>
 
 #include <vcLogger.hpp>
 #include <vcSmartPointer.hpp>
 
+#include <algorithm>
+#include <cmath>
+#include <set>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 namespace viennaps {
 
 using namespace viennacore;
 
 template <class NumericType, int D = 3> class GDSGeometry {
-  using StructureLayers =
-      std::unordered_map<int16_t, SmartPointer<viennals::Mesh<NumericType>>>;
   using lsDomainType = SmartPointer<viennals::Domain<NumericType, D>>;
   using BoundaryType = typename viennals::Domain<NumericType, D>::BoundaryType;
 
@@ -47,6 +56,24 @@ public:
     boundaryPadding[1] = yPadding;
   }
 
+  /// Only import the part of the layout inside the window. The domain bounds
+  /// follow the window and only elements which intersect the domain are
+  /// converted to level sets.
+  void setClipWindow(const NumericType xMin, const NumericType yMin,
+                     const NumericType xMax, const NumericType yMax) {
+    clipWindow_ = {{{std::min(xMin, xMax), std::min(yMin, yMax)},
+                    {std::max(xMin, xMax), std::max(yMin, yMax)}}};
+    clip_ = true;
+    if (!hierarchyLayers.empty())
+      calculateBoundingBoxes();
+  }
+
+  void clearClipWindow() {
+    clip_ = false;
+    if (!hierarchyLayers.empty())
+      calculateBoundingBoxes();
+  }
+
   void setBoundaryConditions(BoundaryType boundaryConds[3]) {
     for (int i = 0; i < 3; i++)
       boundaryConds_[i] = boundaryConds[i];
@@ -60,114 +87,157 @@ public:
     std::cout << "============================" << std::endl;
   }
 
+  /// Extrusion of a single layer, used to extract several layers at once.
+  struct LayerExtrusion {
+    int16_t layer = 0;
+    NumericType baseHeight = 0.;
+    NumericType height = 1.;
+    bool mask = false;
+  };
+
   lsDomainType layerToLevelSet(const int16_t layer,
                                const NumericType baseHeight,
                                const NumericType height, bool mask = false) {
+    return layersToLevelSets({{layer, baseHeight, height, mask}})[0];
+  }
 
-    auto levelSet = lsDomainType::New(bounds_, boundaryConds_, gridDelta_);
-
-    for (auto &str : structures) { // loop over all structures
-      if (!str.isRef) {
-        // add single elements
-        if (auto contains = str.containsLayers.find(layer);
-            contains != str.containsLayers.end()) {
-          for (auto &el : str.elements) {
-            if (el.layer == layer) {
-              if (el.elementType == GDS::ElementType::elBox) {
-                addBox(levelSet, el, baseHeight, height, 0., 0.);
-              } else {
-                addPolygon(levelSet, el, baseHeight, height, 0, 0);
-              }
-            }
+  // Extract several layers with a single pass over the structures. The
+  // elements are converted to level sets in parallel and the level sets of
+  // each layer are merged by pairwise unions. Returns one level set per
+  // extrusion, in the given order.
+  std::vector<lsDomainType>
+  layersToLevelSets(const std::vector<LayerExtrusion> &extrusions) {
+    std::unordered_map<int16_t, std::vector<std::size_t>> layerExtrusions;
+    for (std::size_t i = 0; i < extrusions.size(); ++i)
+      layerExtrusions[extrusions[i].layer].push_back(i);
+
+    const auto window = selectionWindow();
+    std::vector<ExtrusionPart> parts;
+    std::unordered_map<int16_t, std::vector<ElementInstance>> layerInstances;
+    for (std::size_t strIdx = 0; strIdx < structures.size(); ++strIdx) {
+      auto &str = structures[strIdx];
+      if (str.isRef || (clip_ && !GDS::intersects(str.boundingBox, window)))
+        continue;
+
+      // add single elements
+      auto addElement = [&](const unsigned elIdx) {
+        const auto &el = str.elements[elIdx];
+        auto it = layerExtrusions.find(el.layer);
+        if (it == layerExtrusions.end())
+          return;
+        for (const auto idx : it->second) {
+          ExtrusionPart part{idx};
+          if (el.elementType == GDS::ElementType::elBox) {
+            part.boxMin = el.pointCloud[1];
+            part.boxMin[2] = extrusions[idx].baseHeight;
+            part.boxMax = el.pointCloud[3];
+            part.boxMax[2] =
+                extrusions[idx].baseHeight + extrusions[idx].height;
+          } else {
+            // triangulated in parallel
+            part.polygon = &el;
           }
+          parts.push_back(std::move(part));
         }
+      };
+      if (clip_) {
+        str.elementIndex.query(str.elements, window, addElement);
+      } else {
+        for (unsigned elIdx = 0; elIdx < str.elements.size(); ++elIdx)
+          addElement(elIdx);
+      }
 
-        // add structure references
-        auto strMesh = SmartPointer<viennals::Mesh<NumericType>>::New();
-        for (auto &sref : str.sRefs) {
-          auto refStr = getStructure(sref.strName);
-          if (auto contains = refStr->containsLayers.find(layer);
-              contains != refStr->containsLayers.end()) {
-            assert(assembledStructures[refStr->name][layer]);
-
-            // copy mesh here
-            auto copy = assembledStructures[refStr->name][layer];
-            auto preBuiltStrMesh =
-                SmartPointer<viennals::Mesh<NumericType>>::New();
-            preBuiltStrMesh->nodes = copy->nodes;
-            preBuiltStrMesh->triangles = copy->triangles;
-            adjustPreBuiltMeshHeight(preBuiltStrMesh, baseHeight, height);
-
-            if (sref.angle > 0.) {
-              viennals::TransformMesh<NumericType>(
-                  preBuiltStrMesh, viennals::TransformEnum::ROTATION,
-                  hrleVectorType<double, 3>{0., 0., 1.}, deg2rad(sref.angle))
-                  .apply();
-            }
-
-            if (sref.magnification > 0.) {
-              viennals::TransformMesh<NumericType>(
-                  preBuiltStrMesh, viennals::TransformEnum::SCALE,
-                  hrleVectorType<double, 3>{sref.magnification,
-                                            sref.magnification, 1.})
-                  .apply();
-            }
-
-            if (sref.flipped) {
-              Logger::getInstance()
-                  .addWarning("Flipping x-axis currently not supported.")
-                  .print();
-              continue;
-            }
-
-            viennals::TransformMesh<NumericType>(
-                preBuiltStrMesh, viennals::TransformEnum::TRANSLATION,
-                hrleVectorType<double, 3>{sref.refPoint[0], sref.refPoint[1],
-                                          0.})
-                .apply();
-
-            strMesh->append(*preBuiltStrMesh);
-          }
-        }
-        if (strMesh->nodes.size() > 0) {
-          auto tmpLS = lsDomainType::New(levelSet->getGrid());
-          viennals::FromSurfaceMesh<NumericType, D>(tmpLS, strMesh).apply();
-          viennals::BooleanOperation<NumericType, D>(
-              levelSet, tmpLS, viennals::BooleanOperationEnum::UNION)
-              .apply();
-        }
+      // add the elements of referenced structures
+      for (const auto &layer : layerExtrusions) {
+        forEachInstance(str, [&](const std::size_t child,
+                                 const Transform &transform) {
+          collectInstances(child, layer.first, transform, window,
+                           layerInstances[layer.first]);
+        });
       }
     }
 
-    if (mask) {
-      auto topPlane = lsDomainType::New(bounds_, boundaryConds_, gridDelta_);
-      NumericType normal[3] = {0., 0., 1.};
-      NumericType origin[3] = {0., 0., baseHeight + height};
-      viennals::MakeGeometry<NumericType, D>(
-          topPlane,
-          SmartPointer<viennals::Plane<NumericType, D>>::New(origin, normal))
-          .apply();
-
-      auto botPlane = lsDomainType::New(bounds_, boundaryConds_, gridDelta_);
-      normal[D - 1] = -1.;
-      origin[D - 1] = baseHeight;
-      viennals::MakeGeometry<NumericType, D>(
-          botPlane,
-          SmartPointer<viennals::Plane<NumericType, D>>::New(origin, normal))
-          .apply();
+    buildElementMeshes(layerInstances);
+    for (const auto &instances : layerInstances) {
+      for (const auto idx : layerExtrusions[instances.first]) {
+        for (auto &mesh : stampInstances(instances.second,
+                                         extrusions[idx].baseHeight,
+                                         extrusions[idx].height))
+          parts.push_back(ExtrusionPart{idx, mesh});
+      }
+    }
 
-      viennals::BooleanOperation<NumericType, D>(
-          topPlane, botPlane, viennals::BooleanOperationEnum::INTERSECT)
-          .apply();
+    auto emptyLS = lsDomainType::New(bounds_, boundaryConds_, gridDelta_);
+    const auto &grid = emptyLS->getGrid();
 
-      viennals::BooleanOperation<NumericType, D>(
-          topPlane, levelSet,
-          viennals::BooleanOperationEnum::RELATIVE_COMPLEMENT)
-          .apply();
+    std::vector<lsDomainType> partLevelSets(parts.size());
+    parallelApply(parts.size(), [&](std::size_t i) {
+      auto tmpLS = lsDomainType::New(grid);
+      if (parts[i].polygon) {
+        const auto &extrusion = extrusions[parts[i].extrusion];
+        parts[i].mesh = polygonToSurfaceMesh(
+            *parts[i].polygon, extrusion.baseHeight, extrusion.height);
+      }
+      if (parts[i].mesh) {
+        viennals::FromSurfaceMesh<NumericType, D>(tmpLS, parts[i].mesh)
+            .apply();
+      } else {
+        viennals::MakeGeometry<NumericType, D>(
+            tmpLS, SmartPointer<viennals::Box<NumericType, D>>::New(
+                       parts[i].boxMin.data(), parts[i].boxMax.data()))
+            .apply();
+      }
+      partLevelSets[i] = tmpLS;
+    });
+    std::vector<int16_t> failedLayers;
+    for (const auto &part : parts) {
+      if (part.polygon && part.mesh->getNodes().empty())
+        failedLayers.push_back(part.polygon->layer);
+    }
+    warnFailedTriangulations(failedLayers);
+
+    std::vector<std::vector<lsDomainType>> levelSets(extrusions.size());
+    for (std::size_t i = 0; i < parts.size(); ++i)
+      levelSets[parts[i].extrusion].push_back(std::move(partLevelSets[i]));
+    parts.clear();
+
+    // Tree reduction: every round unites pairs of level sets of all layers,
+    // which halves the number of level sets per layer.
+    std::vector<std::pair<lsDomainType, lsDomainType>> pairs;
+    do {
+      pairs.clear();
+      for (auto &layerLevelSets : levelSets) {
+        const std::size_t half = (layerLevelSets.size() + 1) / 2;
+        for (std::size_t i = 0; i + half < layerLevelSets.size(); ++i)
+          pairs.emplace_back(layerLevelSets[i], layerLevelSets[i + half]);
+        layerLevelSets.resize(half);
+      }
+      parallelApply(pairs.size(), [&](std::size_t i) {
+        viennals::BooleanOperation<NumericType, D>(
+            pairs[i].first, pairs[i].second,
+            viennals::BooleanOperationEnum::UNION)
+            .apply();
+      });
+    } while (!pairs.empty());
+
+    std::vector<lsDomainType> result;
+    result.reserve(extrusions.size());
+    for (std::size_t idx = 0; idx < extrusions.size(); ++idx) {
+      lsDomainType levelSet;
+      if (levelSets[idx].empty()) {
+        levelSet = lsDomainType::New(bounds_, boundaryConds_, gridDelta_);
+      } else {
+        levelSet = levelSets[idx][0];
+        // distribute the points over all threads again
+        levelSet->getDomain().segment();
+      }
 
-      return topPlane;
+      if (extrusions[idx].mask)
+        levelSet = applyMask(levelSet, extrusions[idx].baseHeight,
+                             extrusions[idx].height);
+      result.push_back(levelSet);
     }
-    return levelSet;
+    return result;
   }
 
   void printBound() const {
@@ -176,6 +246,7 @@ public:
               << std::endl;
   }
 
+  // Extent of the geometry, limited to the clip window if one is set.
   std::array<std::array<NumericType, 2>, 2> getBoundingBox() const {
     return {minBounds, maxBounds};
   }
@@ -186,65 +257,213 @@ public:
     structures.push_back(structure);
   }
 
+  void insertNextStructure(GDS::Structure<NumericType> &&structure) {
+    structures.push_back(std::move(structure));
+  }
+
   void finalize() {
     checkReferences();
-    preBuildStructures();
+    indexElements();
+    analyzeHierarchy();
     calculateBoundingBoxes();
   }
 
 private:
-  GDS::Structure<NumericType> *getStructure(const std::string &strName) {
-    for (size_t i = 0; i < structures.size(); i++) {
-      if (strName == structures[i].name) {
-        return &structures[i];
+  /// Affine transformation of a structure reference, x' = m * x + t.
+  struct Transform {
+    std::array<NumericType, 4> m = {1., 0., 0., 1.};
+    std::array<NumericType, 2> t = {0., 0.};
+
+    // GDS order: reflection about the x-axis, magnification, rotation and
+    // translation to the reference point
+    static Transform fromReference(const NumericType angle,
+                                   const NumericType magnification,
+                                   const bool flipped,
+                                   const std::array<NumericType, 2> &point) {
+      const NumericType scale = magnification > 0. ? magnification : 1.;
+      const NumericType c = std::cos(deg2rad(angle)) * scale;
+      const NumericType s = std::sin(deg2rad(angle)) * scale;
+      const NumericType f = flipped ? -1. : 1.;
+      return Transform{{c, -s * f, s, c * f}, point};
+    }
+
+    // the child transformation is applied first
+    Transform operator*(const Transform &child) const {
+      Transform result;
+      result.m = {m[0] * child.m[0] + m[1] * child.m[2],
+                  m[0] * child.m[1] + m[1] * child.m[3],
+                  m[2] * child.m[0] + m[3] * child.m[2],
+                  m[2] * child.m[1] + m[3] * child.m[3]};
+      result.t = apply(child.t[0], child.t[1]);
+      return result;
+    }
+
+    std::array<NumericType, 2> apply(const NumericType x,
+                                     const NumericType y) const {
+      return {m[0] * x + m[1] * y + t[0], m[2] * x + m[3] * y + t[1]};
+    }
+
+    bool isReflection() const { return m[0] * m[3] - m[1] * m[2] < 0.; }
+
+    Transform inverse() const {
+      const NumericType det = m[0] * m[3] - m[1] * m[2];
+      Transform result;
+      result.m = {m[3] / det, -m[1] / det, -m[2] / det, m[0] / det};
+      result.t = result.apply(-t[0], -t[1]);
+      return result;
+    }
+
+    // axis aligned bounding box of the transformed box
+    GDS::BoundingBox<NumericType>
+    apply(const GDS::BoundingBox<NumericType> &box) const {
+      auto result = GDS::emptyBoundingBox<NumericType>();
+      for (int corner = 0; corner < 4; ++corner) {
+        const auto point = apply(box[corner & 1][0], box[corner >> 1][1]);
+        for (int i = 0; i < 2; ++i) {
+          result[0][i] = std::min(result[0][i], point[i]);
+          result[1][i] = std::max(result[1][i], point[i]);
+        }
+      }
+      return result;
+    }
+  };
+
+  // One element of a referenced structure at its position in the layout.
+  struct ElementInstance {
+    std::size_t structure;
+    unsigned element;
+    Transform transform;
+  };
+
+  // Call the function with the index and the transformation of every
+  // instance which is referenced by the structure. Array references are
+  // expanded into their instances.
+  template <class Function>
+  void forEachInstance(const GDS::Structure<NumericType> &str,
+                       Function &&function) const {
+    for (const auto &sref : str.sRefs) {
+      auto it = structureIndices.find(sref.strName);
+      if (it == structureIndices.end())
+        continue;
+      function(it->second,
+               Transform::fromReference(sref.angle, sref.magnification,
+                                        sref.flipped,
+                                        {sref.refPoint[0], sref.refPoint[1]}));
+    }
+
+    for (const auto &aref : str.aRefs) {
+      auto it = structureIndices.find(aref.strName);
+      if (it == structureIndices.end())
+        continue;
+      // the reference points are the origin and the origin displaced by all
+      // columns and by all rows
+      const int rows = std::max<int>(aref.arrayDims[0], 1);
+      const int cols = std::max<int>(aref.arrayDims[1], 1);
+      const auto &p = aref.refPoints;
+      const std::array<NumericType, 2> colStep = {(p[1][0] - p[0][0]) / cols,
+                                                  (p[1][1] - p[0][1]) / cols};
+      const std::array<NumericType, 2> rowStep = {(p[2][0] - p[0][0]) / rows,
+                                                  (p[2][1] - p[0][1]) / rows};
+      for (int r = 0; r < rows; ++r) {
+        for (int c = 0; c < cols; ++c) {
+          function(it->second,
+                   Transform::fromReference(
+                       aref.angle, aref.magnification, aref.flipped,
+                       {p[0][0] + c * colStep[0] + r * rowStep[0],
+                        p[0][1] + c * colStep[1] + r * rowStep[1]}));
+        }
       }
     }
-    return nullptr;
   }
 
   void checkReferences() {
-    for (auto &str : structures) {
-      for (auto &sref : str.sRefs) {
-        auto refStr = getStructure(sref.strName);
-        refStr->isRef = true;
+    structureIndices.clear();
+    for (std::size_t i = 0; i < structures.size(); ++i)
+      structureIndices[structures[i].name] = i;
+
+    auto markReferenced = [&](const std::string &strName) {
+      auto it = structureIndices.find(strName);
+      if (it == structureIndices.end()) {
+        Logger::getInstance()
+            .addError("Referenced structure " + strName + " does not exist.")
+            .print();
+        return;
       }
+      structures[it->second].isRef = true;
+    };
+    for (const auto &str : structures) {
+      for (const auto &sref : str.sRefs)
+        markReferenced(sref.strName);
+      for (const auto &aref : str.aRefs)
+        markReferenced(aref.strName);
     }
   }
 
-  void preBuildStructures() {
-    int n = 0;
-    for (auto &str : structures) {
-      if (str.isRef) {
-        if (!str.sRefs.empty()) {
-          std::cerr << "Referenced structure contains references" << std::endl;
-          continue;
-        }
-
-        StructureLayers strLayerMapping;
-
-        for (auto layer : str.containsLayers) {
-          strLayerMapping.insert(
-              {layer, SmartPointer<viennals::Mesh<NumericType>>::New()});
+  // Build the spatial index and the element lists per layer of every
+  // structure. The element meshes of referenced structures are built when
+  // they are first needed.
+  void indexElements() {
+    layerElements.assign(structures.size(), {});
+    elementMeshes.assign(structures.size(), {});
+    for (std::size_t idx = 0; idx < structures.size(); ++idx) {
+      auto &str = structures[idx];
+      for (unsigned elIdx = 0; elIdx < str.elements.size(); ++elIdx) {
+        auto &el = str.elements[elIdx];
+        // elements which were not created by the reader
+        if (el.boundingBox[0][0] > el.boundingBox[1][0]) {
+          for (const auto &point : el.pointCloud)
+            el.addToBoundingBox(point[0], point[1]);
         }
+        layerElements[idx][el.layer].push_back(elIdx);
+      }
+      str.elementIndex.build(str.elements);
+      elementMeshes[idx].resize(str.elements.size());
+    }
+  }
 
-        for (auto &el : str.elements) {
-          SmartPointer<viennals::Mesh<NumericType>> mesh;
-          if (el.elementType == GDS::ElementType::elBox) {
-            mesh = boxToSurfaceMesh(el, 0, 1, 0, 0);
-          } else {
-            bool retry = false;
-            mesh = polygonToSurfaceMesh(el, 0, 1, 0, 0, retry);
-            if (retry) {
-              pointOrderFlag = !pointOrderFlag;
-              mesh = polygonToSurfaceMesh(el, 0, 1, 0, 0, retry);
-            }
-          }
-          strLayerMapping[el.layer]->append(*mesh);
-        }
+  // Bounding boxes and layers of the structures including all referenced
+  // structures. Every structure is visited once.
+  void analyzeHierarchy() {
+    hierarchyLayers.assign(structures.size(), {});
+    std::vector<char> state(structures.size(), 0);
+    for (std::size_t i = 0; i < structures.size(); ++i) {
+      if (state[i] == 0)
+        visitStructure(i, state);
+    }
+  }
 
-        assembledStructures.insert({str.name, strLayerMapping});
+  // state: 0 not visited, 1 in progress, 2 done
+  void visitStructure(const std::size_t idx, std::vector<char> &state) {
+    state[idx] = 1;
+    auto &str = structures[idx];
+    str.boundingBox = str.elementBoundingBox;
+    hierarchyLayers[idx] = str.containsLayers;
+
+    forEachInstance(str, [&](const std::size_t child,
+                             const Transform &transform) {
+      if (state[child] == 1) {
+        Logger::getInstance()
+            .addError("Structure " + structures[child].name +
+                      " references itself.")
+            .print();
+        return;
       }
-    }
+      if (state[child] == 0)
+        visitStructure(child, state);
+
+      hierarchyLayers[idx].insert(hierarchyLayers[child].begin(),
+                                  hierarchyLayers[child].end());
+      const auto &box = structures[child].boundingBox;
+      if (box[0][0] > box[1][0])
+        return; // empty structure
+
+      const auto childBox = transform.apply(box);
+      for (int i = 0; i < 2; ++i) {
+        str.boundingBox[0][i] = std::min(str.boundingBox[0][i], childBox[0][i]);
+        str.boundingBox[1][i] = std::max(str.boundingBox[1][i], childBox[1][i]);
+      }
+    });
+    state[idx] = 2;
   }
 
   void calculateBoundingBoxes() {
@@ -254,113 +473,234 @@ private:
     maxBounds[0] = std::numeric_limits<NumericType>::lowest();
     maxBounds[1] = std::numeric_limits<NumericType>::lowest();
 
-    size_t numStructures = structures.size();
-    std::unordered_map<std::string, bool> processed;
     for (const auto &str : structures) {
-      processed.insert({str.name, false});
-    }
-
-    while (!std::all_of(processed.begin(), processed.end(),
-                        [](std::pair<const std::basic_string<char>, bool> &p) {
-                          return p.second;
-                        })) {
-      for (size_t i = 0; i < numStructures; i++) {
-        if (processed[structures[i].name])
-          continue;
-
-        structures[i].boundingBox = structures[i].elementBoundingBox;
-        bool finish = true;
-        for (const auto sref : structures[i].sRefs) {
-          auto refStr = getStructure(sref.strName);
-          assert(refStr);
-          if (!processed[refStr->name]) {
-            finish = false;
-            break;
-          }
+      if (str.isRef)
+        continue;
+      for (int i = 0; i < 2; ++i) {
+        minBounds[i] = std::min(minBounds[i], str.boundingBox[0][i]);
+        maxBounds[i] = std::max(maxBounds[i], str.boundingBox[1][i]);
+      }
+    }
 
-          auto minPoint_x = sref.refPoint[0] - refStr->boundingBox[0][0];
-          auto minPoint_y = sref.refPoint[1] - refStr->boundingBox[0][1];
+    // the domain follows the clip window
+    auto domain = std::array<std::array<NumericType, 2>, 2>{minBounds,
+                                                            maxBounds};
+    if (clip_) {
+      domain = clipWindow_;
+      for (int i = 0; i < 2; ++i) {
+        minBounds[i] = std::max(minBounds[i], clipWindow_[0][i]);
+        maxBounds[i] = std::min(maxBounds[i], clipWindow_[1][i]);
+      }
+    }
 
-          auto maxPoint_x = sref.refPoint[0] + refStr->boundingBox[1][0];
-          auto maxPoint_y = sref.refPoint[1] + refStr->boundingBox[1][1];
+    bounds_[0] = domain[0][0] - boundaryPadding[0];
+    bounds_[1] = domain[1][0] + boundaryPadding[0];
+    bounds_[2] = domain[0][1] - boundaryPadding[1];
+    bounds_[3] = domain[1][1] + boundaryPadding[1];
+    bounds_[4] = -1.;
+    bounds_[5] = 1.;
+  }
 
-          if (minPoint_x < structures[i].boundingBox[0][0]) {
-            structures[i].boundingBox[0][0] = minPoint_x;
-          }
-          if (minPoint_y < structures[i].boundingBox[0][1]) {
-            structures[i].boundingBox[0][1] = minPoint_y;
-          }
-          if (maxPoint_x > structures[i].boundingBox[1][0]) {
-            structures[i].boundingBox[1][0] = maxPoint_x;
-          }
-          if (maxPoint_y > structures[i].boundingBox[1][1]) {
-            structures[i].boundingBox[1][1] = maxPoint_y;
-          }
-        }
-        if (!finish)
-          continue;
+  // Elements which intersect this window are converted to level sets. It
+  // covers the domain and a few grid points outside of it.
+  GDS::BoundingBox<NumericType> selectionWindow() const {
+    const NumericType margin = 3 * gridDelta_;
+    return {{{static_cast<NumericType>(bounds_[0]) - margin,
+              static_cast<NumericType>(bounds_[2]) - margin},
+             {static_cast<NumericType>(bounds_[1]) + margin,
+              static_cast<NumericType>(bounds_[3]) + margin}}};
+  }
 
-        if (!structures[i].isRef) {
-          if (structures[i].boundingBox[0][0] < minBounds[0]) {
-            minBounds[0] = structures[i].boundingBox[0][0];
-          }
-          if (structures[i].boundingBox[0][1] < minBounds[1]) {
-            minBounds[1] = structures[i].boundingBox[0][1];
-          }
-          if (structures[i].boundingBox[1][0] > maxBounds[0]) {
-            maxBounds[0] = structures[i].boundingBox[1][0];
-          }
-          if (structures[i].boundingBox[1][1] > maxBounds[1]) {
-            maxBounds[1] = structures[i].boundingBox[1][1];
-          }
-        }
+  // A surface mesh, a polygon or a box which is converted to a level set.
+  struct ExtrusionPart {
+    std::size_t extrusion;
+    SmartPointer<viennals::Mesh<NumericType>> mesh = nullptr;
+    const GDS::Element<NumericType> *polygon = nullptr;
+    std::array<NumericType, 3> boxMin{};
+    std::array<NumericType, 3> boxMax{};
+  };
+
+  // Call the function for all tasks in parallel. Each task runs its level set
+  // operations on a single thread, a single task uses all threads.
+  template <class Function>
+  static void parallelApply(const std::size_t numTasks, Function &&function) {
+    if (numTasks == 1) {
+      function(0);
+      return;
+    }
+#pragma omp parallel
+    {
+#ifdef _OPENMP
+      omp_set_num_threads(1);
+#endif
+#pragma omp for schedule(dynamic)
+      for (long i = 0; i < static_cast<long>(numTasks); ++i)
+        function(static_cast<std::size_t>(i));
+    }
+  }
+
+  // Collect the elements on the layer of the instance of a structure and of
+  // all structures it references. With a clip window only the instances and
+  // elements which intersect the window are collected.
+  void collectInstances(const std::size_t idx, const int16_t layer,
+                        const Transform &transform,
+                        const GDS::BoundingBox<NumericType> &window,
+                        std::vector<ElementInstance> &instances) const {
+    if (hierarchyLayers[idx].find(layer) == hierarchyLayers[idx].end())
+      return;
+
+    const auto &str = structures[idx];
+    bool inside = !clip_;
+    if (clip_) {
+      const auto box = transform.apply(str.boundingBox);
+      if (!GDS::intersects(box, window))
+        return;
+      inside = box[0][0] >= window[0][0] && box[1][0] <= window[1][0] &&
+               box[0][1] >= window[0][1] && box[1][1] <= window[1][1];
+    }
 
-        processed[structures[i].name] = true;
+    if (inside) {
+      if (auto it = layerElements[idx].find(layer);
+          it != layerElements[idx].end()) {
+        for (const auto elIdx : it->second)
+          instances.push_back(ElementInstance{idx, elIdx, transform});
       }
+    } else {
+      // the window in the coordinates of the structure
+      str.elementIndex.query(str.elements, transform.inverse().apply(window),
+                             [&](const unsigned elIdx) {
+                               if (str.elements[elIdx].layer == layer)
+                                 instances.push_back(
+                                     ElementInstance{idx, elIdx, transform});
+                             });
     }
-    bounds_[0] = minBounds[0] - boundaryPadding[0];
-    bounds_[1] = maxBounds[0] + boundaryPadding[0];
-    bounds_[2] = minBounds[1] - boundaryPadding[1];
-    bounds_[3] = maxBounds[1] + boundaryPadding[1];
-    bounds_[4] = -1.;
-    bounds_[5] = 1.;
+
+    forEachInstance(str, [&](const std::size_t child,
+                             const Transform &childTransform) {
+      collectInstances(child, layer, transform * childTransform, window,
+                       instances);
+    });
+  }
+
+  // Triangulate the collected elements which do not have a mesh yet. The
+  // meshes extend from 0 to 1 in z and are reused by all instances.
+  void buildElementMeshes(
+      const std::unordered_map<int16_t, std::vector<ElementInstance>>
+          &layerInstances) {
+    std::vector<std::pair<std::size_t, unsigned>> missing;
+    for (const auto &instances : layerInstances) {
+      for (const auto &instance : instances.second) {
+        if (!elementMeshes[instance.structure][instance.element])
+          missing.emplace_back(instance.structure, instance.element);
+      }
+    }
+    std::sort(missing.begin(), missing.end());
+    missing.erase(std::unique(missing.begin(), missing.end()), missing.end());
+
+    parallelApply(missing.size(), [&](std::size_t i) {
+      auto &el = structures[missing[i].first].elements[missing[i].second];
+      elementMeshes[missing[i].first][missing[i].second] =
+          el.elementType == GDS::ElementType::elBox
+              ? boxToSurfaceMesh(el, 0, 1, 0, 0)
+              : polygonToSurfaceMesh(el, 0, 1);
+    });
+    std::vector<int16_t> failedLayers;
+    for (const auto &element : missing) {
+      if (elementMeshes[element.first][element.second]->getNodes().empty())
+        failedLayers.push_back(
+            structures[element.first].elements[element.second].layer);
+    }
+    warnFailedTriangulations(failedLayers);
   }
 
-  void addBox(lsDomainType levelSet, GDS::Element<NumericType> &element,
-              const NumericType baseHeight, const NumericType height,
-              const NumericType xOffset, const NumericType yOffset) const {
-    auto tmpLS = lsDomainType::New(levelSet->getGrid());
+  // The polygons are triangulated in parallel and the Logger is not
+  // thread-safe, so the failures are collected and reported once afterwards.
+  static void warnFailedTriangulations(std::vector<int16_t> layers) {
+    if (layers.empty())
+      return;
+    const auto numFailed = layers.size();
+    std::sort(layers.begin(), layers.end());
+    layers.erase(std::unique(layers.begin(), layers.end()), layers.end());
+    std::string layerList;
+    for (const auto layer : layers)
+      layerList += (layerList.empty() ? "" : ", ") + std::to_string(layer);
+    Logger::getInstance()
+        .addWarning("Could not triangulate " + std::to_string(numFailed) +
+                    " GDS polygon(s) on layer(s) " + layerList +
+                    ", they are ignored.")
+        .print();
+  }
+
+  // Surface meshes of the element instances between the base height and the
+  // top. The instances are collected in meshes of bounded size.
+  std::vector<SmartPointer<viennals::Mesh<NumericType>>>
+  stampInstances(const std::vector<ElementInstance> &instances,
+                 const NumericType baseHeight, const NumericType height) const {
+    std::vector<SmartPointer<viennals::Mesh<NumericType>>> meshes;
+    for (const auto &instance : instances) {
+      appendInstance(*elementMeshes[instance.structure][instance.element],
+                     instance.transform, baseHeight, height, meshes);
+    }
+    return meshes;
+  }
+
+  // Append a transformed copy of the mesh of an element.
+  void appendInstance(
+      const viennals::Mesh<NumericType> &cell, const Transform &transform,
+      const NumericType baseHeight, const NumericType height,
+      std::vector<SmartPointer<viennals::Mesh<NumericType>>> &meshes) const {
+    if (meshes.empty() || meshes.back()->triangles.size() +
+                                  cell.triangles.size() >
+                              instanceMeshSize) {
+      meshes.push_back(SmartPointer<viennals::Mesh<NumericType>>::New());
+    }
+    auto &mesh = *meshes.back();
+
+    const auto offset = static_cast<unsigned>(mesh.nodes.size());
+    for (const auto &node : cell.nodes) {
+      const auto point = transform.apply(node[0], node[1]);
+      mesh.nodes.push_back({point[0], point[1], baseHeight + node[2] * height});
+    }
+    // a reflection reverses the orientation of the triangles
+    const bool reflection = transform.isReflection();
+    for (auto triangle : cell.triangles) {
+      for (auto &i : triangle)
+        i += offset;
+      if (reflection)
+        std::swap(triangle[0], triangle[2]);
+      mesh.triangles.push_back(triangle);
+    }
+  }
 
-    auto minPoint = element.pointCloud[1];
-    minPoint[2] = baseHeight;
-    auto maxPoint = element.pointCloud[3];
-    maxPoint[2] = baseHeight + height;
+  // Remove the level set from a slab between the base height and the top of
+  // the layer.
+  lsDomainType applyMask(lsDomainType levelSet, const NumericType baseHeight,
+                         const NumericType height) const {
+    auto topPlane = lsDomainType::New(bounds_, boundaryConds_, gridDelta_);
+    NumericType normal[3] = {0., 0., 1.};
+    NumericType origin[3] = {0., 0., baseHeight + height};
+    viennals::MakeGeometry<NumericType, D>(
+        topPlane,
+        SmartPointer<viennals::Plane<NumericType, D>>::New(origin, normal))
+        .apply();
 
+    auto botPlane = lsDomainType::New(bounds_, boundaryConds_, gridDelta_);
+    normal[D - 1] = -1.;
+    origin[D - 1] = baseHeight;
     viennals::MakeGeometry<NumericType, D>(
-        tmpLS, SmartPointer<viennals::Box<NumericType, D>>::New(
-                   minPoint.data(), maxPoint.data()))
+        botPlane,
+        SmartPointer<viennals::Plane<NumericType, D>>::New(origin, normal))
         .apply();
+
     viennals::BooleanOperation<NumericType, D>(
-        levelSet, tmpLS, viennals::BooleanOperationEnum::UNION)
+        topPlane, botPlane, viennals::BooleanOperationEnum::INTERSECT)
         .apply();
-  }
 
-  void addPolygon(lsDomainType levelSet, GDS::Element<NumericType> &element,
-                  const NumericType baseHeight, const NumericType height,
-                  const NumericType xOffset, const NumericType yOffset) {
-    bool retry = false;
-    auto mesh = polygonToSurfaceMesh(element, baseHeight, height, xOffset,
-                                     yOffset, retry);
-    if (retry) {
-      pointOrderFlag = !pointOrderFlag;
-      mesh = polygonToSurfaceMesh(element, baseHeight, height, xOffset, yOffset,
-                                  retry);
-    }
-    auto tmpLS = lsDomainType::New(levelSet->getGrid());
-    viennals::FromSurfaceMesh<NumericType, D>(tmpLS, mesh).apply();
     viennals::BooleanOperation<NumericType, D>(
-        levelSet, tmpLS, viennals::BooleanOperationEnum::UNION)
+        topPlane, levelSet, viennals::BooleanOperationEnum::RELATIVE_COMPLEMENT)
         .apply();
+
+    return topPlane;
   }
 
   SmartPointer<viennals::Mesh<NumericType>>
@@ -396,188 +736,76 @@ private:
     return mesh;
   }
 
+  // Extrude the polygon between the base height and the top. The caps are
+  // triangulated in O(n log n), the orientation of the polygon is detected
+  // from its area. Returns an empty mesh if the polygon can not be
+  // triangulated; this is called in parallel and does not log.
   SmartPointer<viennals::Mesh<NumericType>>
-  polygonToSurfaceMesh(GDS::Element<NumericType> &element,
-                       const NumericType baseHeight, const NumericType height,
-                       const NumericType xOffset, const NumericType yOffset,
-                       bool &retry) {
+  polygonToSurfaceMesh(const GDS::Element<NumericType> &element,
+                       const NumericType baseHeight,
+                       const NumericType height) const {
     auto mesh = SmartPointer<viennals::Mesh<NumericType>>::New();
-
-    unsigned numPointsFlat = element.pointCloud.size();
-
-    // sidewalls
+    const unsigned numPointsFlat = element.pointCloud.size();
+
+    std::vector<std::array<NumericType, 2>> boundary;
+    boundary.reserve(numPointsFlat);
+    for (const auto &point : element.pointCloud)
+      boundary.push_back({point[0], point[1]});
+    impl::PolygonTriangulation<NumericType> triangulation(std::move(boundary));
+    if (!triangulation.apply())
+      return mesh;
+
+    for (const auto &point : element.pointCloud)
+      mesh->insertNextNode({point[0], point[1], baseHeight});
+    for (const auto &point : element.pointCloud)
+      mesh->insertNextNode({point[0], point[1], baseHeight + height});
+
+    // sidewalls with outward normals
+    const bool counterClockwise = triangulation.isCounterClockwise();
     for (unsigned i = 0; i < numPointsFlat; i++) {
-      std::array<NumericType, 3> offsetPoint = element.pointCloud[i];
-      offsetPoint[0] += xOffset;
-      offsetPoint[1] += yOffset;
-      offsetPoint[2] = baseHeight;
-      mesh->insertNextNode(offsetPoint);
-
-      if (pointOrderFlag) {
-        mesh->insertNextTriangle(std::array<unsigned, 3>{
-            i, (i + 1) % numPointsFlat, i + numPointsFlat});
+      const unsigned j = (i + 1) % numPointsFlat;
+      if (counterClockwise) {
+        mesh->insertNextTriangle({i, j, i + numPointsFlat});
+        mesh->insertNextTriangle({j, j + numPointsFlat, i + numPointsFlat});
       } else {
-        mesh->insertNextTriangle(std::array<unsigned, 3>{
-            i + numPointsFlat, (i + 1) % numPointsFlat, i});
+        mesh->insertNextTriangle({i + numPointsFlat, j, i});
+        mesh->insertNextTriangle({i + numPointsFlat, j + numPointsFlat, j});
       }
     }
 
-    for (unsigned i = 0; i < numPointsFlat; i++) {
-      unsigned upPoint = i + numPointsFlat;
-      std::array<NumericType, 3> offsetPoint = element.pointCloud[i];
-      offsetPoint[0] += xOffset;
-      offsetPoint[1] += yOffset;
-      offsetPoint[2] = baseHeight + height;
-      mesh->insertNextNode(offsetPoint);
-
-      if (pointOrderFlag) {
-        mesh->insertNextTriangle(std::array<unsigned, 3>{
-            upPoint, (upPoint + 1) % numPointsFlat,
-            (upPoint + 1) % numPointsFlat + numPointsFlat});
-      } else {
-        mesh->insertNextTriangle(std::array<unsigned, 3>{
-            (upPoint + 1) % numPointsFlat + numPointsFlat,
-            (upPoint + 1) % numPointsFlat, upPoint});
-      }
-    }
-
-    // polygon triangulation (ear clipping algorithm)
-    std::vector<unsigned> leftNeighbors(numPointsFlat);
-    std::vector<unsigned> rightNeighbors(numPointsFlat);
-
-    // initialize neighbors
-    for (unsigned i = 0; i < numPointsFlat; i++) {
-      leftNeighbors[i] = ((i - 1) + numPointsFlat) % numPointsFlat;
-      rightNeighbors[i] = ((i + 1) + numPointsFlat) % numPointsFlat;
-    }
-
-    unsigned numTriangles = 0;
-    unsigned i = numPointsFlat - 1;
-    unsigned counter = 0;
-    while (numTriangles < (numPointsFlat - 2)) {
-      i = rightNeighbors[i];
-      if (isEar(leftNeighbors[i], i, rightNeighbors[i], mesh, numPointsFlat)) {
-        if (pointOrderFlag) {
-
-          mesh->insertNextTriangle(
-              std::array<unsigned, 3>{rightNeighbors[i], i, leftNeighbors[i]});
-        } else {
-          mesh->insertNextTriangle(
-              std::array<unsigned, 3>{leftNeighbors[i], i, rightNeighbors[i]});
-        }
-
-        // remove point
-        leftNeighbors[rightNeighbors[i]] = leftNeighbors[i];
-        rightNeighbors[leftNeighbors[i]] = rightNeighbors[i];
-
-        numTriangles++;
-      }
-
-      if (counter++ > triangulationTimeOut) {
-        if (!retry) {
-          retry = true;
-          return mesh;
-        } else {
-          Logger::getInstance()
-              .addError("Timeout in surface triangulation.")
-              .print();
-        }
-      }
-    }
-
-    // use same triangles for other side
-    auto &triangles = mesh->template getElements<3>();
-    unsigned numPrevTriangles = triangles.size() - 1;
-    for (unsigned j = 0; j < numTriangles; j++) {
-      auto triangle = triangles[numPrevTriangles - j];
-      for (int d = 0; d < 3; d++) {
-        triangle[d] += numPointsFlat;
-      }
-      std::swap(triangle[0], triangle[2]); // swap for correct orientation
-      mesh->insertNextTriangle(triangle);
+    // the triangles are counterclockwise, the bottom faces downwards
+    for (const auto &triangle : triangulation.getTriangles()) {
+      mesh->insertNextTriangle({triangle[2], triangle[1], triangle[0]});
+      mesh->insertNextTriangle({triangle[0] + numPointsFlat,
+                                triangle[1] + numPointsFlat,
+                                triangle[2] + numPointsFlat});
     }
 
     return mesh;
   }
 
-  bool isEar(int i, int j, int k,
-             SmartPointer<viennals::Mesh<NumericType>> mesh,
-             unsigned numPoints) const {
-    auto &points = mesh->getNodes();
-
-    // check if triangle is clockwise orientated
-    if (((points[i][0] * points[j][1] + points[i][1] * points[k][0] +
-          points[j][0] * points[k][1] - points[k][0] * points[j][1] -
-          points[k][1] * points[i][0] - points[j][0] * points[i][1]) < 0.) !=
-        !pointOrderFlag)
-      return false;
-
-    for (unsigned m = 0; m < numPoints; m++) {
-      if ((m != i) && (m != j) && (m != k)) {
-        // check if point in triangle
-        auto side_1 =
-            (points[m][0] - points[j][0]) * (points[i][1] - points[j][1]) -
-            (points[i][0] - points[j][0]) * (points[m][1] - points[j][1]);
-        // Segment B to C
-        auto side_2 =
-            (points[m][0] - points[k][0]) * (points[j][1] - points[k][1]) -
-            (points[j][0] - points[k][0]) * (points[m][1] - points[k][1]);
-        // Segment C to A
-        auto side_3 =
-            (points[m][0] - points[i][0]) * (points[k][1] - points[i][1]) -
-            (points[k][0] - points[i][0]) * (points[m][1] - points[i][1]);
-
-        // All the signs must be positive or all negative
-        if (((side_1 < eps) && (side_2 < eps) && (side_3 < eps)) ||
-            ((side_1 > -eps) && (side_2 > -eps) && (side_3 > -eps)))
-          return false;
-      }
-    }
-
-    return true;
-  }
-
-  void adjustPreBuiltMeshHeight(SmartPointer<viennals::Mesh<NumericType>> mesh,
-                                const NumericType baseHeight,
-                                const NumericType height) const {
-    auto &nodes = mesh->getNodes();
-
-    for (auto &n : nodes) {
-      if (n[2] < 1.) {
-        n[2] = baseHeight;
-      } else {
-        n[2] = baseHeight + height;
-      }
-    }
-  }
-
-  void resetPreBuiltMeshHeight(SmartPointer<viennals::Mesh<NumericType>> mesh,
-                               const NumericType baseHeight,
-                               const NumericType height) const {
-    auto &nodes = mesh->getNodes();
-
-    for (auto &n : nodes) {
-      if (n[2] == baseHeight) {
-        n[2] = 0.;
-      } else {
-        n[2] = 1.;
-      }
-    }
-  }
-
   static inline NumericType deg2rad(const NumericType angleDeg) {
     return angleDeg * M_PI / 180.;
   }
 
 private:
   std::vector<GDS::Structure<NumericType>> structures;
-  std::unordered_map<std::string, StructureLayers> assembledStructures;
+  // elements of each structure per layer
+  std::vector<std::unordered_map<int16_t, std::vector<unsigned>>>
+      layerElements;
+  // meshes of the elements of referenced structures, built on demand
+  std::vector<std::vector<SmartPointer<viennals::Mesh<NumericType>>>>
+      elementMeshes;
+  std::unordered_map<std::string, std::size_t> structureIndices;
+  // layers of the structures including all referenced structures
+  std::vector<std::set<int16_t>> hierarchyLayers;
+  // maximum number of triangles of the meshes with stamped instances
+  static constexpr std::size_t instanceMeshSize = 1 << 18;
   std::array<NumericType, 2> boundaryPadding = {0., 0.};
   std::array<NumericType, 2> minBounds;
   std::array<NumericType, 2> maxBounds;
-  static bool pointOrderFlag;
-  unsigned triangulationTimeOut = 1000000;
-  static constexpr double eps = 1e-6;
+  bool clip_ = false;
+  GDS::BoundingBox<NumericType> clipWindow_;
 
   double bounds_[6];
   NumericType gridDelta_ = 1.;
@@ -586,7 +814,4 @@ private:
                                     BoundaryType::INFINITE_BOUNDARY};
 };
 
-template <class NumericType, int D>
-bool GDSGeometry<NumericType, D>::pointOrderFlag = true;
-
 } // namespace viennaps
\ No newline at end of file
@@ -1,8 +1,12 @@
 #pragma once
 
-#include <cstdio>
-#include <cstdlib>
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstring>
 #include <string>
+#include <unordered_set>
+#include <vector>
 
 #include "psGDSGeometry.hpp"
 #include "psGDSUtils.hpp"
@@ -16,9 +20,10 @@ using namespace viennacore;
 /// This class reads a GDS file and creates a GDSGeometry object. It is a
 /// very simple implementation and does not support all GDS features.
 template <typename NumericType, int D = 3> class GDSReader {
-  FILE *filePtr = nullptr;
   SmartPointer<GDSGeometry<NumericType, D>> geometry = nullptr;
   std::string fileName;
+  bool clip = false;
+  std::array<NumericType, 4> clipWindow{};
 
 public:
   GDSReader() {}
@@ -34,6 +39,14 @@ public:
     fileName = std::move(passedFileName);
   }
 
+  /// Only import the part of the layout inside the window, see
+  /// GDSGeometry::setClipWindow.
+  void setClipWindow(const NumericType xMin, const NumericType yMin,
+                     const NumericType xMax, const NumericType yMax) {
+    clipWindow = {xMin, yMin, xMax, yMax};
+    clip = true;
+  }
+
   void apply() {
     if constexpr (D == 2) {
       Logger::getInstance()
@@ -43,13 +56,21 @@ public:
     }
 
     parseFile();
+    if (clip)
+      geometry->setClipWindow(clipWindow[0], clipWindow[1], clipWindow[2],
+                              clipWindow[3]);
     geometry->finalize();
   }
 
+  // Parse throughput of the last file in MB/s.
+  double getThroughput() const { return throughput; }
+
 private:
   GDS::Structure<NumericType> currentStructure;
 
-  int16_t currentRecordLen = 0;
+  // payload of the current record
+  const unsigned char *recordPos = nullptr;
+  const unsigned char *recordEnd = nullptr;
   int16_t currentLayer;
   int16_t currentDataType;
   int16_t currentPlexNumber;
@@ -61,19 +82,25 @@ private:
   GDS::ElementType currentElement;
   double units; // units in micron
   double userUnits;
-
-  // unused
-  float currentWidth;
-  char *tempStr;
-
-  bool contains(int32_t X, int32_t Y,
-                const std::vector<std::array<int32_t, 2>> &uniPoints) {
-    for (const auto &p : uniPoints) {
-      if (p[0] == X && p[1] == Y)
-        return true;
+  double throughput = 0.; // MB/s
+
+  // vertices of the current element for the duplicate check
+  std::unordered_set<uint64_t> uniquePoints;
+  std::vector<uint64_t> smallUniquePoints;
+
+  // Returns true if the vertex was not seen before in the current element.
+  bool insertUniquePoint(int32_t X, int32_t Y, unsigned numPoints) {
+    const uint64_t key =
+        (uint64_t(uint32_t(X)) << 32) | uint64_t(uint32_t(Y));
+    // a linear scan is faster for the small polygons which are most common
+    if (numPoints <= 16) {
+      if (std::find(smallUniquePoints.begin(), smallUniquePoints.end(), key) !=
+          smallUniquePoints.end())
+        return false;
+      smallUniquePoints.push_back(key);
+      return true;
     }
-
-    return false;
+    return uniquePoints.insert(key).second;
   }
 
   void resetCurrentStructure() {
@@ -96,75 +123,38 @@ private:
         std::numeric_limits<NumericType>::lowest();
   }
 
-  char *readAsciiString() {
-    char *str = NULL;
-
-    if (currentRecordLen > 0) {
-      currentRecordLen += currentRecordLen % 2;
-      str = new char[currentRecordLen + 1];
-
-      (void)!fread(str, 1, currentRecordLen, filePtr);
-      str[currentRecordLen] = 0;
-      currentRecordLen = 0;
-    }
+  std::size_t remainingRecordBytes() const { return recordEnd - recordPos; }
 
-    return str;
+  std::string readAsciiString() {
+    const auto begin = reinterpret_cast<const char *>(recordPos);
+    const auto length = remainingRecordBytes();
+    recordPos = recordEnd;
+    // strings are padded with a null character to an even length
+    return std::string(begin, strnlen(begin, length));
   }
 
   int16_t readTwoByteSignedInt() {
-    int16_t value;
-    (void)!fread(&value, 2, 1, filePtr);
-
-    currentRecordLen -= 2;
-
-#if __BYTE_ORDER == __LITTLE_ENDIAN
-    return endian_swap_short(value);
-#else
+    if (remainingRecordBytes() < 2)
+      return 0;
+    const auto value = GDS::readInt16(recordPos);
+    recordPos += 2;
     return value;
-#endif
   }
 
   int32_t readFourByteSignedInt() {
-    int32_t value;
-    (void)!fread(&value, 4, 1, filePtr);
-
-    currentRecordLen -= 4;
-
-#if __BYTE_ORDER == __LITTLE_ENDIAN
-    return endian_swap_long(value);
-#else
+    if (remainingRecordBytes() < 4)
+      return 0;
+    const auto value = GDS::readInt32(recordPos);
+    recordPos += 4;
     return value;
-#endif
   }
 
   double readEightByteReal() {
-    unsigned char value;
-    std::array<unsigned char, 7> bytes;
-    double sign = 1.0;
-    double exponent;
-    double mant;
-
-    (void)!fread(&value, 1, 1, filePtr);
-    if (value & 128) {
-      value -= 128;
-      sign = -1.0;
-    }
-    exponent = static_cast<double>(value);
-    exponent -= 64.0;
-    mant = 0.0;
-
-    for (int i = 0; i < 7; i++) {
-      (void)!fread(&bytes[i], 1, 1, filePtr);
-    }
-
-    for (int i = 6; i >= 0; i--) {
-      mant += static_cast<double>(bytes[i]);
-      mant /= 256.0;
-    }
-
-    currentRecordLen -= 8;
-
-    return sign * (mant * std::pow(16.0, exponent));
+    if (remainingRecordBytes() < 8)
+      return 0.;
+    const auto value = GDS::readReal64(recordPos);
+    recordPos += 8;
+    return value;
   }
 
   void parseHeader() {
@@ -176,12 +166,9 @@ private:
   }
 
   void parseLibName() {
-    char *str;
-    str = readAsciiString();
     Logger::getInstance()
-        .addDebug("GDS Library name: " + std::string(str))
+        .addDebug("GDS Library name: " + readAsciiString())
         .print();
-    delete[] str;
   }
 
   void parseUnits() {
@@ -190,33 +177,29 @@ private:
     units = units * 1.0e6; /*in micron*/
   }
 
-  void parseStructureName() {
-    char *str = readAsciiString();
-
-    if (str) {
-      currentStructure.name = str;
-      delete[] str;
-    }
-  }
+  void parseStructureName() { currentStructure.name = readAsciiString(); }
 
   void parseSName() {
     // parse the structure reference
-    char *str = readAsciiString();
-    if (str) {
-      if (currentElement == GDS::ElementType::elSRef) {
-        currentStructure.sRefs.back().strName = str;
-      } else if (currentElement == GDS::ElementType::elARef) {
-        currentStructure.aRefs.back().strName = str;
-      }
-      delete[] str;
+    auto str = readAsciiString();
+    if (currentElement == GDS::ElementType::elSRef) {
+      currentStructure.sRefs.back().strName = std::move(str);
+    } else if (currentElement == GDS::ElementType::elARef) {
+      currentStructure.aRefs.back().strName = std::move(str);
     }
   }
 
   void parseXYBoundary() {
     float X, Y;
-    unsigned int numPoints = currentRecordLen / 8;
+    const unsigned numPoints = remainingRecordBytes() / 8;
+    if (numPoints == 0)
+      return;
     auto &currentElPointCloud = currentStructure.elements.back().pointCloud;
-    std::vector<std::array<int32_t, 2>> uniquePoints;
+    currentElPointCloud.reserve(numPoints - 1);
+    uniquePoints.clear();
+    smallUniquePoints.clear();
+    if (numPoints > 16)
+      uniquePoints.reserve(numPoints);
 
     // do not include the last point since it
     // is just a copy of the first
@@ -224,15 +207,14 @@ private:
       auto pX = readFourByteSignedInt();
       auto pY = readFourByteSignedInt();
 
-      if (!contains(pX, pY, uniquePoints)) {
-        uniquePoints.push_back({pX, pY});
-
+      if (insertUniquePoint(pX, pY, numPoints)) {
         X = units * (float)pX;
         Y = units * (float)pY;
 
         currentElPointCloud.push_back(std::array<NumericType, 3>{
             static_cast<NumericType>(X), static_cast<NumericType>(Y),
             NumericType(0)});
+        currentStructure.elements.back().addToBoundingBox(X, Y);
 
         if (X < currentStructure.elementBoundingBox[0][0]) {
           currentStructure.elementBoundingBox[0][0] = X;
@@ -248,15 +230,6 @@ private:
         }
       }
     }
-    readFourByteSignedInt(); // parse remaining points
-    readFourByteSignedInt();
-  }
-
-  void parseXYIgnore() {
-    unsigned int numPoints = currentRecordLen / 8;
-    for (unsigned int i = 0; i < numPoints * 2; i++) {
-      readFourByteSignedInt();
-    }
   }
 
   void parseXYRef() {
@@ -302,31 +275,55 @@ private:
   }
 
   void parseFile() {
-    filePtr = fopen(fileName.c_str(), "rb");
-    if (!filePtr) {
+    GDS::FileReader file(fileName);
+    if (!file.isOpen()) {
       Logger::getInstance().addError("Could not open GDS file.").print();
       return;
     }
 
-    unsigned char recordType, dataType;
+    Timer timer;
+    timer.start();
     resetCurrentStructure();
+    parseRecords(file);
+    timer.finish();
 
-    while (!feof(filePtr)) {
-      currentRecordLen = readTwoByteSignedInt();
-      (void)!fread(&recordType, 1, 1, filePtr);
-      (void)!fread(&dataType, 1, 1, filePtr);
-      currentRecordLen -= 4;
+    const double seconds = timer.currentDuration * 1e-9;
+    const double megaBytes = file.position() * 1e-6;
+    throughput = seconds > 0. ? megaBytes / seconds : 0.;
+    Logger::getInstance()
+        .addInfo("Parsed GDS file " + fileName + " (" +
+                 (file.isMapped() ? "mapped" : "buffered") + "): " +
+                 std::to_string(megaBytes) + " MB in " +
+                 std::to_string(seconds) + " s, " +
+                 std::to_string(throughput) + " MB/s")
+        .print();
+  }
+
+  void parseRecords(GDS::FileReader &file) {
+    while (const auto header = file.next(4)) {
+      const auto recordLength = static_cast<uint16_t>(GDS::readInt16(header));
+      const unsigned char recordType = header[2];
+      if (recordLength < 4) {
+        Logger::getInstance()
+            .addWarning("Invalid record length in GDS file.")
+            .print();
+        return;
+      }
+
+      // the whole record is decoded from memory
+      const std::size_t payloadLength = recordLength - 4u;
+      recordPos = file.next(payloadLength);
+      if (!recordPos) {
+        Logger::getInstance().addWarning("Truncated GDS file.").print();
+        return;
+      }
+      recordEnd = recordPos + payloadLength;
 
       switch (static_cast<GDS::RecordNumbers>(recordType)) {
       case GDS::RecordNumbers::Header:
         parseHeader();
         break;
 
-      case GDS::RecordNumbers::BgnLib:
-        while (currentRecordLen)
-          readTwoByteSignedInt(); // read modification date/time
-        break;
-
       case GDS::RecordNumbers::LibName:
         parseLibName();
         break;
@@ -336,7 +333,6 @@ private:
         break;
 
       case GDS::RecordNumbers::EndLib:
-        fseek(filePtr, 0, SEEK_END);
         return;
 
       case GDS::RecordNumbers::BgnStr: // begin structure
@@ -345,8 +341,6 @@ private:
                currentStructure.sRefs.empty() &&
                currentStructure.aRefs
                    .empty()); // assert current structure is reset
-        while (currentRecordLen)
-          readTwoByteSignedInt(); // read modification date/time
         break;
 
       case GDS::RecordNumbers::StrName:
@@ -354,7 +348,7 @@ private:
         break;
 
       case GDS::RecordNumbers::EndStr: // current structure finished
-        geometry->insertNextStructure(currentStructure);
+        geometry->insertNextStructure(std::move(currentStructure));
         resetCurrentStructure();
         break;
 
@@ -376,10 +370,6 @@ private:
         currentStructure.boxElements++;
         break;
 
-      case GDS::RecordNumbers::BoxType: // ignore
-        readTwoByteSignedInt();
-        break;
-
       case GDS::RecordNumbers::Layer:
         currentLayer = readTwoByteSignedInt();
         if (!ignore) {
@@ -404,8 +394,6 @@ private:
         } else if (currentElement == GDS::ElementType::elSRef ||
                    currentElement == GDS::ElementType::elARef) {
           parseXYRef();
-        } else {
-          parseXYIgnore();
         }
         break;
 
@@ -445,33 +433,14 @@ private:
         ignore = true;
         break;
 
-      case GDS::RecordNumbers::TextType: // ignore
-        readTwoByteSignedInt();
-        break;
-
-      case GDS::RecordNumbers::Presentation: // ignore
-        readTwoByteSignedInt();
-        break;
-
-      case GDS::RecordNumbers::String: // ignore
-        tempStr = readAsciiString();
-        delete[] tempStr;
-        break;
-
       case GDS::RecordNumbers::Path: // ignore
         currentElement = GDS::ElementType::elPath;
         ignore = true;
         break;
 
-      case GDS::RecordNumbers::PathType: // ignore
-        readTwoByteSignedInt();
-        break;
-
-      case GDS::RecordNumbers::Width: // ignore (only used in path and text)
-        currentWidth = (float)readFourByteSignedInt();
-        if (currentWidth > 0) {
-          currentWidth *= units;
-        }
+      case GDS::RecordNumbers::Node: // ignore
+        currentElement = GDS::ElementType::elNone;
+        ignore = true;
         break;
 
       case GDS::RecordNumbers::DataType: // unimportant and should be zero
@@ -482,171 +451,49 @@ private:
               .print();
         break;
 
-      case GDS::RecordNumbers::Node: // ignore
-        currentElement = GDS::ElementType::elNone;
-        while (currentRecordLen) {
-          readTwoByteSignedInt();
-        }
-        ignore = true;
-        break;
-
-      case GDS::RecordNumbers::ElFlags: // ignore
-        while (currentRecordLen)
-          readTwoByteSignedInt();
-        break;
-
-      case GDS::RecordNumbers::ElKey: // ignore
-        while (currentRecordLen)
-          readTwoByteSignedInt();
-        break;
-
-      case GDS::RecordNumbers::RefLibs: // ignore
-        tempStr = readAsciiString();
-        delete[] tempStr;
-        break;
-
-      case GDS::RecordNumbers::Fonts: // ignore
-        tempStr = readAsciiString();
-        delete[] tempStr;
-        break;
-
-      case GDS::RecordNumbers::Generations: // ignore
-        while (currentRecordLen)
-          readTwoByteSignedInt();
-        break;
-      case GDS::RecordNumbers::AttrTable: // ignore
-        tempStr = readAsciiString();
-        delete[] tempStr;
-        break;
-
-      case GDS::RecordNumbers::StypTable: // ignore
-        readTwoByteSignedInt();
-        break;
-
-      case GDS::RecordNumbers::StrType: // ignore
-        tempStr = readAsciiString();
-        delete[] tempStr;
-        break;
-
-      case GDS::RecordNumbers::LinkType: // ignore
-        while (currentRecordLen)
-          readTwoByteSignedInt();
-        break;
-
-      case GDS::RecordNumbers::LinkKeys: // ignore
-        while (currentRecordLen)
-          readFourByteSignedInt();
-        break;
-
-      case GDS::RecordNumbers::NodeType: // ignore
-        while (currentRecordLen)
-          readTwoByteSignedInt();
-        break;
-
-      case GDS::RecordNumbers::PropAttr: // ignore
-        while (currentRecordLen)
-          readTwoByteSignedInt();
-        break;
-
-      case GDS::RecordNumbers::PropValue: // ignore
-        tempStr = readAsciiString();
-        delete[] tempStr;
-        break;
-
-      case GDS::RecordNumbers::BgnExtn: // ignore
-        readFourByteSignedInt();
-        break;
-
-      case GDS::RecordNumbers::EndExtn: // ignore
-        readFourByteSignedInt();
-        break;
-
-      case GDS::RecordNumbers::TapeNum: // ignore
-        while (currentRecordLen)
-          readTwoByteSignedInt();
-        break;
-
-      case GDS::RecordNumbers::TapeCode: // ignore
-        while (currentRecordLen)
-          readTwoByteSignedInt();
-        break;
-
-      case GDS::RecordNumbers::StrClass: // ignore
-        while (currentRecordLen)
-          readTwoByteSignedInt();
-        break;
-
-      case GDS::RecordNumbers::Reserved: // ignore
-        /* Empty */
-        break;
-
-      case GDS::RecordNumbers::Format: // ignore
-        while (currentRecordLen)
-          readTwoByteSignedInt();
-        break;
-
-      case GDS::RecordNumbers::Mask: // ignore
-        tempStr = readAsciiString();
-        delete[] tempStr;
-        break;
-
-      case GDS::RecordNumbers::EndMasks: // ignore
-        /* Empty */
-        break;
-
-      case GDS::RecordNumbers::LibDirSize: // ignore
-        while (currentRecordLen)
-          readTwoByteSignedInt();
-        break;
-
-      case GDS::RecordNumbers::SrfName: // ignore
-        tempStr = readAsciiString();
-        delete[] tempStr;
-        break;
-
-      case GDS::RecordNumbers::LibSecur: // ignore
-        while (currentRecordLen)
-          readTwoByteSignedInt();
-        break;
-
-      case GDS::RecordNumbers::Border: // ignore
-        /* Empty */
-        break;
-
-      case GDS::RecordNumbers::SoftFence: // ignore
-        /* Empty */
-        break;
-
-      case GDS::RecordNumbers::HardFence: // ignore
-        /* Empty */
-        break;
-
-      case GDS::RecordNumbers::SoftWire: // ignore
-        /* Empty */
-        break;
-
-      case GDS::RecordNumbers::HardWire: // ignore
-        /* Empty */
-        break;
-
-      case GDS::RecordNumbers::PathPort: // ignore
-        /* Empty */
-        break;
-
-      case GDS::RecordNumbers::NodePort: // ignore
-        /* Empty */
-        break;
-
-      case GDS::RecordNumbers::UserConstraint: // ignore
-        /* Empty */
-        break;
-
-      case GDS::RecordNumbers::SpacerError: // ignore
-        /* Empty */
-        break;
-
-      case GDS::RecordNumbers::Contact: // ignore
-        /* Empty */
+      // ignored records, their payload is skipped
+      case GDS::RecordNumbers::BgnLib:
+      case GDS::RecordNumbers::BoxType:
+      case GDS::RecordNumbers::TextType:
+      case GDS::RecordNumbers::Presentation:
+      case GDS::RecordNumbers::String:
+      case GDS::RecordNumbers::PathType:
+      case GDS::RecordNumbers::Width:
+      case GDS::RecordNumbers::ElFlags:
+      case GDS::RecordNumbers::ElKey:
+      case GDS::RecordNumbers::RefLibs:
+      case GDS::RecordNumbers::Fonts:
+      case GDS::RecordNumbers::Generations:
+      case GDS::RecordNumbers::AttrTable:
+      case GDS::RecordNumbers::StypTable:
+      case GDS::RecordNumbers::StrType:
+      case GDS::RecordNumbers::LinkType:
+      case GDS::RecordNumbers::LinkKeys:
+      case GDS::RecordNumbers::NodeType:
+      case GDS::RecordNumbers::PropAttr:
+      case GDS::RecordNumbers::PropValue:
+      case GDS::RecordNumbers::BgnExtn:
+      case GDS::RecordNumbers::EndExtn:
+      case GDS::RecordNumbers::TapeNum:
+      case GDS::RecordNumbers::TapeCode:
+      case GDS::RecordNumbers::StrClass:
+      case GDS::RecordNumbers::Reserved:
+      case GDS::RecordNumbers::Format:
+      case GDS::RecordNumbers::Mask:
+      case GDS::RecordNumbers::EndMasks:
+      case GDS::RecordNumbers::LibDirSize:
+      case GDS::RecordNumbers::SrfName:
+      case GDS::RecordNumbers::LibSecur:
+      case GDS::RecordNumbers::Border:
+      case GDS::RecordNumbers::SoftFence:
+      case GDS::RecordNumbers::HardFence:
+      case GDS::RecordNumbers::SoftWire:
+      case GDS::RecordNumbers::HardWire:
+      case GDS::RecordNumbers::PathPort:
+      case GDS::RecordNumbers::NodePort:
+      case GDS::RecordNumbers::UserConstraint:
+      case GDS::RecordNumbers::SpacerError:
+      case GDS::RecordNumbers::Contact:
         break;
 
       default:
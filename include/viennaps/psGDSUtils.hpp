@@ -1,12 +1,26 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
+#include <cmath>
 #include <cstdint>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <limits>
 #include <set>
 #include <string>
 #include <vector>
 
+#if (defined(__unix__) || defined(__APPLE__)) &&                               \
+    !defined(VIENNAPS_GDS_NO_MMAP)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define VIENNAPS_GDS_MMAP
+#endif
+
 #ifndef endian_swap_long
 #define endian_swap_long(w)                                                    \
   (((w & 0xff) << 24) | ((w & 0xff00) << 8) | ((w & 0xff0000) >> 8) |          \
@@ -103,11 +117,150 @@ enum class RecordNumbers {
   Contact /* 69 */
 };
 
+template <class T> using BoundingBox = std::array<std::array<T, 2>, 2>;
+
+template <class T> BoundingBox<T> emptyBoundingBox() {
+  return {{{std::numeric_limits<T>::max(), std::numeric_limits<T>::max()},
+           {std::numeric_limits<T>::lowest(),
+            std::numeric_limits<T>::lowest()}}};
+}
+
+template <class T>
+bool intersects(const BoundingBox<T> &a, const BoundingBox<T> &b) {
+  return a[0][0] <= b[1][0] && b[0][0] <= a[1][0] && a[0][1] <= b[1][1] &&
+         b[0][1] <= a[1][1];
+}
+
 template <class T> struct Element {
   ElementType elementType;
   int16_t layer;
   int32_t plexNumber = -1;
   std::vector<std::array<T, 3>> pointCloud;
+  BoundingBox<T> boundingBox = emptyBoundingBox<T>();
+
+  void addToBoundingBox(const T x, const T y) {
+    boundingBox[0][0] = std::min(boundingBox[0][0], x);
+    boundingBox[0][1] = std::min(boundingBox[0][1], y);
+    boundingBox[1][0] = std::max(boundingBox[1][0], x);
+    boundingBox[1][1] = std::max(boundingBox[1][1], y);
+  }
+};
+
+/// Uniform grid over the bounding boxes of the elements of a structure. It
+/// finds the elements which intersect a window without testing every
+/// element. Structures with few elements are not binned.
+template <class T> class ElementIndex {
+  static constexpr std::size_t minElements = 32;
+
+  BoundingBox<T> extent_ = emptyBoundingBox<T>();
+  std::array<T, 2> cellSize_ = {1., 1.};
+  std::array<int, 2> numCells_ = {0, 0};
+  // elements of each cell in compressed row storage
+  std::vector<unsigned> cellStart_;
+  std::vector<unsigned> cellElements_;
+
+public:
+  void build(const std::vector<Element<T>> &elements) {
+    cellStart_.clear();
+    cellElements_.clear();
+    numCells_ = {0, 0};
+    if (elements.size() < minElements)
+      return;
+
+    extent_ = emptyBoundingBox<T>();
+    for (const auto &el : elements) {
+      for (int i = 0; i < 2; ++i) {
+        extent_[0][i] = std::min(extent_[0][i], el.boundingBox[0][i]);
+        extent_[1][i] = std::max(extent_[1][i], el.boundingBox[1][i]);
+      }
+    }
+    // about one element per cell
+    const int cellsPerSide = std::max(
+        1, static_cast<int>(std::sqrt(static_cast<double>(elements.size()))));
+    for (int i = 0; i < 2; ++i) {
+      numCells_[i] = cellsPerSide;
+      cellSize_[i] = (extent_[1][i] - extent_[0][i]) / cellsPerSide;
+      if (!(cellSize_[i] > 0.))
+        cellSize_[i] = 1.;
+    }
+
+    // count, then fill the cells
+    cellStart_.assign(numCells_[0] * numCells_[1] + 1, 0);
+    forEachElementCell(elements, [&](unsigned, int cell) {
+      ++cellStart_[cell + 1];
+    });
+    for (std::size_t i = 1; i < cellStart_.size(); ++i)
+      cellStart_[i] += cellStart_[i - 1];
+    cellElements_.resize(cellStart_.back());
+    auto fill = cellStart_;
+    forEachElementCell(elements, [&](unsigned idx, int cell) {
+      cellElements_[fill[cell]++] = idx;
+    });
+  }
+
+  // Call the function with the index of every element whose bounding box
+  // intersects the window, each element is reported once.
+  template <class Function>
+  void query(const std::vector<Element<T>> &elements,
+             const BoundingBox<T> &window, Function &&function) const {
+    if (numCells_[0] == 0) {
+      for (unsigned idx = 0; idx < elements.size(); ++idx) {
+        if (intersects(elements[idx].boundingBox, window))
+          function(idx);
+      }
+      return;
+    }
+    if (!intersects(extent_, window))
+      return;
+
+    const auto lo = cellOf(window[0][0], window[0][1]);
+    const auto hi = cellOf(window[1][0], window[1][1]);
+    for (int y = lo[1]; y <= hi[1]; ++y) {
+      for (int x = lo[0]; x <= hi[0]; ++x) {
+        const int cell = y * numCells_[0] + x;
+        for (auto i = cellStart_[cell]; i < cellStart_[cell + 1]; ++i) {
+          const auto idx = cellElements_[i];
+          const auto &box = elements[idx].boundingBox;
+          if (!intersects(box, window))
+            continue;
+          // only report the element in the cell of the lower left corner of
+          // the overlap
+          const auto first = cellOf(std::max(box[0][0], window[0][0]),
+                                    std::max(box[0][1], window[0][1]));
+          if (first[0] == x && first[1] == y)
+            function(idx);
+        }
+      }
+    }
+  }
+
+private:
+  std::array<int, 2> cellOf(const T x, const T y) const {
+    const std::array<T, 2> point = {x, y};
+    std::array<int, 2> cell;
+    for (int i = 0; i < 2; ++i) {
+      const T pos = (point[i] - extent_[0][i]) / cellSize_[i];
+      cell[i] = pos <= 0. ? 0
+                          : std::min(numCells_[i] - 1, static_cast<int>(pos));
+    }
+    return cell;
+  }
+
+  template <class Function>
+  void forEachElementCell(const std::vector<Element<T>> &elements,
+                          Function &&function) const {
+    for (unsigned idx = 0; idx < elements.size(); ++idx) {
+      const auto &box = elements[idx].boundingBox;
+      if (box[0][0] > box[1][0])
+        continue;
+      const auto lo = cellOf(box[0][0], box[0][1]);
+      const auto hi = cellOf(box[1][0], box[1][1]);
+      for (int y = lo[1]; y <= hi[1]; ++y) {
+        for (int x = lo[0]; x <= hi[0]; ++x)
+          function(idx, y * numCells_[0] + x);
+      }
+    }
+  }
 };
 
 template <class T> struct SRef {
@@ -138,6 +291,7 @@ template <class T> struct Structure {
   std::array<std::array<T, 2>, 2> boundingBox;
   bool isRef = false;
   std::set<int16_t> containsLayers;
+  ElementIndex<T> elementIndex;
 
   std::array<T, 2> getElementExtent() const {
     return {elementBoundingBox[1][0] - elementBoundingBox[0][0],
@@ -186,5 +340,129 @@ template <class T> struct Structure {
   }
 };
 
+/// Sequential read access to a file. The file is memory-mapped where this is
+/// supported, otherwise it is read in large blocks. The returned bytes stay
+/// valid until the next call of next().
+class FileReader {
+public:
+  explicit FileReader(const std::string &fileName) {
+#ifdef VIENNAPS_GDS_MMAP
+    fd_ = ::open(fileName.c_str(), O_RDONLY);
+    if (fd_ >= 0) {
+      struct stat fileStat;
+      if (::fstat(fd_, &fileStat) == 0) {
+        size_ = static_cast<std::size_t>(fileStat.st_size);
+        if (size_ == 0)
+          return;
+        void *map = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+        if (map != MAP_FAILED) {
+          ::madvise(map, size_, MADV_SEQUENTIAL);
+          data_ = static_cast<const unsigned char *>(map);
+          return;
+        }
+      }
+      ::close(fd_);
+      fd_ = -1;
+    }
+#endif
+    stream_.open(fileName, std::ios::binary | std::ios::ate);
+    if (stream_.is_open()) {
+      size_ = static_cast<std::size_t>(stream_.tellg());
+      stream_.seekg(0);
+      // a record is at most 64 kB long
+      buffer_.resize(
+          std::min(blockSize, std::max(size_, std::size_t(1) << 16)));
+    }
+  }
+
+  FileReader(const FileReader &) = delete;
+  FileReader &operator=(const FileReader &) = delete;
+
+  ~FileReader() {
+#ifdef VIENNAPS_GDS_MMAP
+    if (data_)
+      ::munmap(const_cast<unsigned char *>(data_), size_);
+    if (fd_ >= 0)
+      ::close(fd_);
+#endif
+  }
+
+  bool isOpen() const { return data_ || fd_ >= 0 || stream_.is_open(); }
+
+  bool isMapped() const { return data_ != nullptr; }
+
+  std::size_t size() const { return size_; }
+
+  // Returns the next n bytes, or nullptr if fewer than n bytes are left. In
+  // buffered mode n is limited to the block size.
+  const unsigned char *next(const std::size_t n) {
+    if (data_) {
+      if (n > size_ - position_)
+        return nullptr;
+      const auto bytes = data_ + position_;
+      position_ += n;
+      return bytes;
+    }
+
+    if (bufferEnd_ - bufferBegin_ < n) {
+      // keep the remaining bytes and fill up the block
+      std::memmove(buffer_.data(), buffer_.data() + bufferBegin_,
+                   bufferEnd_ - bufferBegin_);
+      bufferEnd_ -= bufferBegin_;
+      bufferBegin_ = 0;
+      if (stream_.is_open()) {
+        stream_.read(reinterpret_cast<char *>(buffer_.data() + bufferEnd_),
+                     buffer_.size() - bufferEnd_);
+        bufferEnd_ += static_cast<std::size_t>(stream_.gcount());
+      }
+      if (bufferEnd_ < n)
+        return nullptr;
+    }
+    const auto bytes = buffer_.data() + bufferBegin_;
+    bufferBegin_ += n;
+    position_ += n;
+    return bytes;
+  }
+
+  std::size_t position() const { return position_; }
+
+private:
+  static constexpr std::size_t blockSize = 1 << 22;
+
+  const unsigned char *data_ = nullptr;
+  int fd_ = -1;
+  std::size_t size_ = 0;
+  std::size_t position_ = 0;
+
+  // buffered fallback
+  std::ifstream stream_;
+  std::vector<unsigned char> buffer_;
+  std::size_t bufferBegin_ = 0;
+  std::size_t bufferEnd_ = 0;
+};
+
+// GDS stores integers in big-endian byte order.
+inline int16_t readInt16(const unsigned char *bytes) {
+  return static_cast<int16_t>((uint16_t(bytes[0]) << 8) | uint16_t(bytes[1]));
+}
+
+inline int32_t readInt32(const unsigned char *bytes) {
+  return static_cast<int32_t>((uint32_t(bytes[0]) << 24) |
+                              (uint32_t(bytes[1]) << 16) |
+                              (uint32_t(bytes[2]) << 8) | uint32_t(bytes[3]));
+}
+
+// Eight byte real in excess-64 format: sign bit, 7 bit base 16 exponent and
+// 56 bit mantissa.
+inline double readReal64(const unsigned char *bytes) {
+  uint64_t mantissa = 0;
+  for (int i = 1; i < 8; ++i)
+    mantissa = (mantissa << 8) | bytes[i];
+  const int exponent = (bytes[0] & 0x7f) - 64;
+  const double value =
+      std::ldexp(static_cast<double>(mantissa), 4 * exponent - 56);
+  return (bytes[0] & 0x80) ? -value : value;
+}
+
 } // namespace GDS
 } // namespace viennaps
@@ -0,0 +1,235 @@
+#pragma once
+
+#include "psPlaneSource.hpp"
+
+#include <vcLogger.hpp>
+#include <vcSmartPointer.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace viennaps {
+
+using namespace viennacore;
+
+/// Tabulated ion energy-angle distribution (IEAD), given as a histogram over
+/// energy and polar angle bins, e.g. from a plasma sheath simulation. The
+/// weight of a bin is the probability of an ion in this bin. Pairs of energy
+/// and angle are sampled in constant time with an alias table; within a bin
+/// the energy and angle are uniformly distributed. Only the random number
+/// generator passed to sample() is used, so the samples are reproducible for
+/// a given seed.
+template <class NumericType> class IonEnergyAngleDistribution {
+public:
+  struct Sample {
+    NumericType energy; // eV
+    NumericType angle;  // rad
+  };
+
+  // The bin edges are given in eV and degrees, the weights are stored row by
+  // row, one row of angle bins per energy bin.
+  IonEnergyAngleDistribution(std::vector<NumericType> energyEdges,
+                             std::vector<NumericType> angleEdges,
+                             std::vector<NumericType> weights)
+      : energyEdges_(std::move(energyEdges)),
+        angleEdges_(std::move(angleEdges)) {
+    initialize(std::move(weights));
+  }
+
+  // Read the histogram from a text file. The first line contains the energy
+  // bin edges, the second line the angle bin edges and the following lines
+  // the weights, one line per energy bin. Values are separated by commas or
+  // white space, lines starting with '#' are ignored.
+  explicit IonEnergyAngleDistribution(const std::string &fileName) {
+    std::ifstream file(fileName);
+    if (!file.is_open()) {
+      Logger::getInstance()
+          .addError("Could not open IEAD file " + fileName + ".")
+          .print();
+      return;
+    }
+
+    std::vector<std::vector<NumericType>> rows;
+    std::string line;
+    while (std::getline(file, line)) {
+      const auto first = line.find_first_not_of(" \t\r");
+      if (first == std::string::npos || line[first] == '#')
+        continue;
+      std::replace(line.begin(), line.end(), ',', ' ');
+      std::istringstream stream(line);
+      std::vector<NumericType> row;
+      NumericType value;
+      while (stream >> value)
+        row.push_back(value);
+      rows.push_back(std::move(row));
+    }
+
+    if (rows.size() < 3) {
+      Logger::getInstance()
+          .addError("IEAD file " + fileName + " contains no histogram.")
+          .print();
+      return;
+    }
+    energyEdges_ = std::move(rows[0]);
+    angleEdges_ = std::move(rows[1]);
+    std::vector<NumericType> weights;
+    for (std::size_t i = 2; i < rows.size(); ++i)
+      weights.insert(weights.end(), rows[i].begin(), rows[i].end());
+    initialize(std::move(weights));
+  }
+
+  template <class RNG> Sample sample(RNG &rngState) const {
+    std::uniform_real_distribution<NumericType> uniform(0., 1.);
+
+    // alias method
+    const NumericType u = uniform(rngState) * numBins_;
+    auto bin = std::min(static_cast<std::size_t>(u), numBins_ - 1);
+    if (u - bin >= probability_[bin])
+      bin = alias_[bin];
+
+    const auto energyBin = bin / numAngleBins_;
+    const auto angleBin = bin % numAngleBins_;
+    const NumericType s = uniform(rngState);
+    const NumericType t = uniform(rngState);
+    return {energyEdges_[energyBin] +
+                s * (energyEdges_[energyBin + 1] - energyEdges_[energyBin]),
+            angleEdges_[angleBin] +
+                t * (angleEdges_[angleBin + 1] - angleEdges_[angleBin])};
+  }
+
+  NumericType getMeanEnergy() const { return meanEnergy_; }
+
+  std::size_t getNumberOfEnergyBins() const { return numEnergyBins_; }
+
+  std::size_t getNumberOfAngleBins() const { return numAngleBins_; }
+
+private:
+  void initialize(std::vector<NumericType> &&weights) {
+    if (energyEdges_.size() < 2 || angleEdges_.size() < 2) {
+      Logger::getInstance()
+          .addError("IEAD needs at least one energy and one angle bin.")
+          .print();
+      return;
+    }
+    numEnergyBins_ = energyEdges_.size() - 1;
+    numAngleBins_ = angleEdges_.size() - 1;
+    numBins_ = numEnergyBins_ * numAngleBins_;
+    if (weights.size() != numBins_) {
+      Logger::getInstance()
+          .addError("IEAD weights do not match the number of bins.")
+          .print();
+      return;
+    }
+    for (auto &angle : angleEdges_)
+      angle *= M_PI / 180.;
+
+    const NumericType total =
+        std::accumulate(weights.begin(), weights.end(), NumericType(0.));
+    if (!(total > 0.)) {
+      Logger::getInstance().addError("IEAD weights sum to zero.").print();
+      return;
+    }
+
+    meanEnergy_ = 0.;
+    for (std::size_t i = 0; i < numEnergyBins_; ++i) {
+      const NumericType center =
+          NumericType(0.5) * (energyEdges_[i] + energyEdges_[i + 1]);
+      for (std::size_t j = 0; j < numAngleBins_; ++j)
+        meanEnergy_ += weights[i * numAngleBins_ + j] / total * center;
+    }
+
+    // Vose's alias method
+    probability_.resize(numBins_);
+    alias_.resize(numBins_);
+    std::vector<NumericType> scaled(numBins_);
+    std::vector<std::size_t> small, large;
+    for (std::size_t i = 0; i < numBins_; ++i) {
+      scaled[i] = std::max(weights[i], NumericType(0.)) * numBins_ / total;
+      (scaled[i] < 1. ? small : large).push_back(i);
+    }
+    while (!small.empty() && !large.empty()) {
+      const auto s = small.back();
+      small.pop_back();
+      const auto l = large.back();
+      probability_[s] = scaled[s];
+      alias_[s] = l;
+      scaled[l] -= 1. - scaled[s];
+      if (scaled[l] < 1.) {
+        large.pop_back();
+        small.push_back(l);
+      }
+    }
+    // the remaining bins are full up to round-off
+    for (const auto i : large) {
+      probability_[i] = 1.;
+      alias_[i] = i;
+    }
+    for (const auto i : small) {
+      probability_[i] = 1.;
+      alias_[i] = i;
+    }
+  }
+
+  std::vector<NumericType> energyEdges_;
+  std::vector<NumericType> angleEdges_;
+  std::size_t numEnergyBins_ = 0;
+  std::size_t numAngleBins_ = 0;
+  std::size_t numBins_ = 0;
+  std::vector<NumericType> probability_;
+  std::vector<std::size_t> alias_;
+  NumericType meanEnergy_ = 0.;
+};
+
+namespace impl {
+
+/// Hands the energy sampled by an IEAD source to the ion of the same ray. The
+/// source and the ion of a ray are always called on the same thread, the ion
+/// takes the energy at its first surface hit.
+template <class NumericType> class SourceEnergy {
+  static inline thread_local NumericType lastEnergy_ = 0.;
+  bool pending_ = false;
+
+public:
+  static void set(NumericType energy) { lastEnergy_ = energy; }
+
+  // Called when a new ray is started.
+  void reset() { pending_ = true; }
+
+  // Set the energy of the ion from the source, only once per ray.
+  void update(NumericType &energy) {
+    if (pending_) {
+      energy = lastEnergy_;
+      pending_ = false;
+    }
+  }
+};
+
+} // namespace impl
+
+/// Source which samples the polar angle of the ions from an IEAD. The energy
+/// of each ray is sampled together with the angle and is used by the ions of
+/// the models which support IEADs.
+template <class NumericType, int D>
+class IEADSource : public PlaneSource<NumericType, D> {
+  SmartPointer<IonEnergyAngleDistribution<NumericType>> distribution_;
+
+public:
+  explicit IEADSource(
+      SmartPointer<IonEnergyAngleDistribution<NumericType>> distribution)
+      : distribution_(distribution) {}
+
+protected:
+  NumericType samplePolarAngle(RNG &rngState) const override {
+    const auto sample = distribution_->sample(rngState);
+    impl::SourceEnergy<NumericType>::set(sample.energy);
+    return sample.angle;
+  }
+};
+
+} // namespace viennaps
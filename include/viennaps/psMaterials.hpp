@@ -5,6 +5,11 @@
 #include <vcLogger.hpp>
 #include <vcSmartPointer.hpp>
 
+#include <array>
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+
 namespace viennaps {
 
 using namespace viennacore;
@@ -29,7 +34,7 @@ enum class Material : int {
   Dielectric = 15,
   Metal = 16,
   Air = 17,
-  GAS = 18
+  GAS = 18 // last material, see MaterialMap::numMaterials
 };
 
 /// A class that wraps the viennals MaterialMap class and provides a more user
@@ -81,6 +86,98 @@ public:
   static inline bool isMaterial(const T matId, const Material material) {
     return mapToMaterial(matId) == material;
   }
+
+  // Number of materials in the Material enum, including Material::None.
+  // Material::GAS has to stay the last enumerator.
+  static constexpr int numMaterials = static_cast<int>(Material::GAS) + 2;
+
+  // Dense index of a material in [0, numMaterials) for MaterialTable and
+  // MaterialMask. Unknown IDs have the index of Material::None, as in
+  // mapToMaterial.
+  static inline int getIndex(const Material material) {
+    return static_cast<int>(material) + 1;
+  }
+
+  template <class T> static inline int getIndex(const T matId) {
+    const int id = static_cast<int>(matId);
+    return (id >= -1 && id < numMaterials - 1) ? id + 1 : 0;
+  }
+};
+
+/// Values of a quantity for all materials, e.g. a struct of material
+/// parameters. The values are looked up directly from the material IDs of the
+/// surface points, which makes the lookup a single indexed load.
+template <class T> class MaterialTable {
+  std::array<T, MaterialMap::numMaterials> values_{};
+
+public:
+  MaterialTable() = default;
+
+  explicit MaterialTable(const T &value) { values_.fill(value); }
+
+  void set(const Material material, const T &value) {
+    values_[MaterialMap::getIndex(material)] = value;
+  }
+
+  void fill(const T &value) { values_.fill(value); }
+
+  T &operator[](const Material material) {
+    return values_[MaterialMap::getIndex(material)];
+  }
+
+  const T &operator[](const Material material) const {
+    return values_[MaterialMap::getIndex(material)];
+  }
+
+  // Look up the value of a material ID.
+  template <class IdType> const T &lookup(const IdType matId) const {
+    return values_[MaterialMap::getIndex(matId)];
+  }
+
+  // Access by an index computed with MaterialMap::getIndex(), so that several
+  // tables can be read with a single conversion of the material ID.
+  const T &atIndex(const int idx) const { return values_[idx]; }
+};
+
+/// A set of materials, e.g. the masking materials of a process. Checking
+/// whether a material ID is in the set is a single bit test.
+class MaterialMask {
+  static_assert(MaterialMap::numMaterials <= 32);
+  std::uint32_t bits_ = 0;
+
+public:
+  MaterialMask() = default;
+
+  MaterialMask(std::initializer_list<Material> materials) {
+    for (const auto material : materials)
+      insert(material);
+  }
+
+  MaterialMask(const std::vector<Material> &materials) {
+    for (const auto material : materials)
+      insert(material);
+  }
+
+  void insert(const Material material) {
+    bits_ |= 1u << MaterialMap::getIndex(material);
+  }
+
+  void erase(const Material material) {
+    bits_ &= ~(1u << MaterialMap::getIndex(material));
+  }
+
+  bool empty() const { return bits_ == 0; }
+
+  bool contains(const Material material) const {
+    return testIndex(MaterialMap::getIndex(material));
+  }
+
+  // Check a material ID of the level sets or surface points.
+  template <class IdType> bool test(const IdType matId) const {
+    return testIndex(MaterialMap::getIndex(matId));
+  }
+
+  bool testIndex(const int idx) const { return (bits_ >> idx) & 1u; }
 };
 
 } // namespace viennaps
@@ -0,0 +1,178 @@
+#pragma once
+
+#include <raySource.hpp>
+#include <rayUtil.hpp>
+
+#include <vcVectorUtil.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <optional>
+#include <random>
+#include <vector>
+
+namespace viennaps {
+
+using namespace viennacore;
+
+/// Base class for ray sources which start the rays on a plane above the
+/// surface, in the same way as the default source of the ray tracer. The
+/// process places the plane from the surface points before every flux
+/// calculation. Derived sources sample the polar angle of the rays relative
+/// to the main direction of the source, the azimuth is uniform. In 2D the rays
+/// are projected onto the simulation plane.
+template <class NumericType, int D>
+class PlaneSource : public viennaray::Source<NumericType> {
+public:
+  // Place the source plane above the bounding box of the surface points. The
+  // rays travel along the primary direction if one is given, otherwise
+  // towards the surface along the source direction.
+  void setGeometry(
+      const std::vector<Vec3D<NumericType>> &points,
+      const NumericType gridDelta,
+      const viennaray::TraceDirection sourceDirection,
+      const std::optional<std::array<NumericType, 3>> &primaryDirection =
+          std::nullopt) {
+    numPoints_ = points.size();
+
+    int axis = D - 1;
+    bool positive = true;
+    switch (sourceDirection) {
+    case viennaray::TraceDirection::POS_X:
+      axis = 0;
+      break;
+    case viennaray::TraceDirection::NEG_X:
+      axis = 0;
+      positive = false;
+      break;
+    case viennaray::TraceDirection::POS_Y:
+      axis = 1;
+      break;
+    case viennaray::TraceDirection::NEG_Y:
+      axis = 1;
+      positive = false;
+      break;
+    case viennaray::TraceDirection::POS_Z:
+      axis = 2;
+      break;
+    case viennaray::TraceDirection::NEG_Z:
+      axis = 2;
+      positive = false;
+      break;
+    }
+
+    Vec3D<NumericType> minCorner{std::numeric_limits<NumericType>::max(),
+                                 std::numeric_limits<NumericType>::max(),
+                                 std::numeric_limits<NumericType>::max()};
+    Vec3D<NumericType> maxCorner{std::numeric_limits<NumericType>::lowest(),
+                                 std::numeric_limits<NumericType>::lowest(),
+                                 std::numeric_limits<NumericType>::lowest()};
+    for (const auto &p : points) {
+      for (int i = 0; i < 3; ++i) {
+        minCorner[i] = std::min(minCorner[i], p[i]);
+        maxCorner[i] = std::max(maxCorner[i], p[i]);
+      }
+    }
+    if (points.empty()) {
+      minCorner = Vec3D<NumericType>{0., 0., 0.};
+      maxCorner = Vec3D<NumericType>{0., 0., 0.};
+    }
+
+    // the ray tracer adds the disc radius on the side of the source
+    const NumericType discRadius =
+        gridDelta * NumericType(0.5) * std::sqrt(NumericType(D)) *
+        (1 + NumericType(1e-5));
+    planePosition_ = positive ? maxCorner[axis] + 2 * discRadius
+                              : minCorner[axis] - 2 * discRadius;
+    axis_ = axis;
+
+    // lateral directions of the plane
+    int numLateral = 0;
+    area_ = 1.;
+    for (int i = 0; i < D; ++i) {
+      if (i == axis)
+        continue;
+      lateralAxes_[numLateral] = i;
+      lateralMin_[numLateral] = minCorner[i];
+      lateralExtent_[numLateral] = maxCorner[i] - minCorner[i];
+      area_ *= lateralExtent_[numLateral];
+      ++numLateral;
+    }
+    numLateral_ = numLateral;
+
+    Vec3D<NumericType> main{0., 0., 0.};
+    if (primaryDirection) {
+      main = Normalize(primaryDirection.value());
+    } else {
+      main[axis] = positive ? -1. : 1.;
+    }
+    setBasis(main);
+  }
+
+  Vec2D<Vec3D<NumericType>>
+  getOriginAndDirection(const size_t, RNG &rngState) const override {
+    std::uniform_real_distribution<NumericType> uniform(0., 1.);
+
+    Vec3D<NumericType> origin{0., 0., 0.};
+    origin[axis_] = planePosition_;
+    for (int i = 0; i < numLateral_; ++i)
+      origin[lateralAxes_[i]] =
+          lateralMin_[i] + lateralExtent_[i] * uniform(rngState);
+
+    // the polar angle has to stay below 90 degrees
+    const NumericType theta =
+        std::min(samplePolarAngle(rngState), NumericType(M_PI_2 - 1e-6));
+    const NumericType phi = 2 * M_PI * uniform(rngState);
+    const NumericType sinTheta = std::sin(theta);
+    const NumericType cosTheta = std::cos(theta);
+    const NumericType cosPhi = std::cos(phi);
+    const NumericType sinPhi = std::sin(phi);
+
+    Vec3D<NumericType> direction;
+    for (int i = 0; i < 3; ++i)
+      direction[i] = cosTheta * basis_[0][i] +
+                     sinTheta * (cosPhi * basis_[1][i] + sinPhi * basis_[2][i]);
+    if constexpr (D == 2) {
+      direction[2] = 0.;
+      Normalize(direction);
+    }
+
+    return {origin, direction};
+  }
+
+  size_t getNumPoints() const override { return numPoints_; }
+
+  NumericType getSourceArea() const override { return area_; }
+
+protected:
+  // Sample the polar angle (in radians) between a ray and the main direction.
+  virtual NumericType samplePolarAngle(RNG &rngState) const = 0;
+
+private:
+  void setBasis(const Vec3D<NumericType> &main) {
+    basis_[0] = main;
+    // any vector which is not parallel to the main direction, in 2D the first
+    // vector of the basis is kept in the simulation plane
+    Vec3D<NumericType> helper{0., 0., 1.};
+    if constexpr (D == 3) {
+      if (std::abs(main[2]) > 0.9)
+        helper = Vec3D<NumericType>{1., 0., 0.};
+    }
+    basis_[1] = Normalize(CrossProduct(main, helper));
+    basis_[2] = CrossProduct(main, basis_[1]);
+  }
+
+  std::size_t numPoints_ = 0;
+  int axis_ = D - 1;
+  NumericType planePosition_ = 0.;
+  int numLateral_ = 0;
+  std::array<int, 2> lateralAxes_{};
+  std::array<NumericType, 2> lateralMin_{};
+  std::array<NumericType, 2> lateralExtent_{};
+  NumericType area_ = 1.;
+  std::array<Vec3D<NumericType>, 3> basis_{};
+};
+
+} // namespace viennaps
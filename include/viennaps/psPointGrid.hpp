@@ -0,0 +1,235 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <vector>
+
+#include <vcVectorUtil.hpp>
+
+namespace viennaps {
+
+using namespace viennacore;
+
+/// Nearest point index for surface points, which are distributed evenly with
+/// a spacing of about the grid delta. The points are sorted into cubic cells
+/// with the size of the grid delta, the occupied cells are stored in a hash
+/// table. Building the index is linear in the number of points. A nearest
+/// point query searches the cells in shells around the cell of the query
+/// point, which only takes the innermost shells for points close to the
+/// surface.
+template <class NumericType> class PointGrid {
+public:
+  static constexpr std::size_t invalidId =
+      std::numeric_limits<std::size_t>::max();
+
+  PointGrid() = default;
+
+  void build(const std::vector<Vec3D<NumericType>> &points,
+             const NumericType cellSize) {
+    numPoints_ = points.size();
+    invCellSize_ = NumericType(1) / cellSize;
+    cellSize_ = cellSize;
+    pointIds_.resize(numPoints_);
+    sortedPoints_.resize(numPoints_);
+
+    // hash table with at most 50% load, the number of occupied cells is at
+    // most the number of points
+    std::size_t capacity = 16;
+    while (capacity < 2 * numPoints_)
+      capacity <<= 1;
+    cells_.assign(capacity, Cell{});
+    mask_ = capacity - 1;
+
+    if (numPoints_ == 0)
+      return;
+
+    // count the points per cell
+    std::vector<std::size_t> pointCells(numPoints_);
+    Vec3D<std::int64_t> minCell = getCellCoordinate(points[0]);
+    Vec3D<std::int64_t> maxCell = minCell;
+    for (std::size_t i = 0; i < numPoints_; ++i) {
+      const auto cell = getCellCoordinate(points[i]);
+      for (int j = 0; j < 3; ++j) {
+        minCell[j] = std::min(minCell[j], cell[j]);
+        maxCell[j] = std::max(maxCell[j], cell[j]);
+      }
+      auto &entry = cells_[insertCell(getKey(cell))];
+      ++entry.count;
+      pointCells[i] = &entry - cells_.data();
+    }
+    minCell_ = minCell;
+    maxCell_ = maxCell;
+
+    // the points of a cell are stored contiguously
+    std::size_t offset = 0;
+    for (auto &cell : cells_) {
+      cell.begin = offset;
+      offset += cell.count;
+      cell.count = 0;
+    }
+    for (std::size_t i = 0; i < numPoints_; ++i) {
+      auto &cell = cells_[pointCells[i]];
+      const auto idx = cell.begin + cell.count++;
+      pointIds_[idx] = i;
+      sortedPoints_[idx] = points[i];
+    }
+  }
+
+  // Returns the ID of the point closest to the coordinate or invalidId if the
+  // index is empty.
+  std::size_t findNearest(const Vec3D<NumericType> &coordinate) const {
+    if (numPoints_ == 0)
+      return invalidId;
+
+    const auto center = getCellCoordinate(coordinate);
+    // no point is further away than the bounding box of the occupied cells
+    std::int64_t maxShell = 0;
+    for (int j = 0; j < 3; ++j) {
+      maxShell = std::max({maxShell, center[j] - minCell_[j],
+                           maxCell_[j] - center[j]});
+    }
+
+    std::size_t nearest = invalidId;
+    NumericType minDistance = std::numeric_limits<NumericType>::max();
+    for (std::int64_t shell = 0; shell <= maxShell; ++shell) {
+      searchShell(center, shell, coordinate, nearest, minDistance);
+      // all points in the following shells are at least this far away
+      const NumericType shellDistance = shell * cellSize_;
+      if (nearest != invalidId && minDistance <= shellDistance * shellDistance)
+        break;
+    }
+    return nearest;
+  }
+
+  std::size_t size() const { return numPoints_; }
+
+  bool empty() const { return numPoints_ == 0; }
+
+private:
+  struct Cell {
+    std::uint64_t key = emptyKey;
+    std::size_t begin = 0;
+    std::size_t count = 0;
+  };
+
+  static constexpr std::uint64_t emptyKey =
+      std::numeric_limits<std::uint64_t>::max();
+  // 21 bits per coordinate
+  static constexpr std::int64_t keyOffset = std::int64_t(1) << 20;
+  static constexpr std::uint64_t keyMask = (std::uint64_t(1) << 21) - 1;
+
+  Vec3D<std::int64_t>
+  getCellCoordinate(const Vec3D<NumericType> &point) const {
+    return {static_cast<std::int64_t>(std::floor(point[0] * invCellSize_)),
+            static_cast<std::int64_t>(std::floor(point[1] * invCellSize_)),
+            static_cast<std::int64_t>(std::floor(point[2] * invCellSize_))};
+  }
+
+  static std::uint64_t getKey(const Vec3D<std::int64_t> &cell) {
+    return (static_cast<std::uint64_t>(cell[0] + keyOffset) & keyMask) |
+           ((static_cast<std::uint64_t>(cell[1] + keyOffset) & keyMask)
+            << 21) |
+           ((static_cast<std::uint64_t>(cell[2] + keyOffset) & keyMask)
+            << 42);
+  }
+
+  static std::size_t hash(std::uint64_t key) {
+    // 64 bit finalizer of MurmurHash3
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+    return static_cast<std::size_t>(key);
+  }
+
+  std::size_t insertCell(const std::uint64_t key) {
+    std::size_t idx = hash(key) & mask_;
+    while (cells_[idx].key != emptyKey && cells_[idx].key != key)
+      idx = (idx + 1) & mask_;
+    cells_[idx].key = key;
+    return idx;
+  }
+
+  const Cell *findCell(const std::uint64_t key) const {
+    std::size_t idx = hash(key) & mask_;
+    while (cells_[idx].key != emptyKey) {
+      if (cells_[idx].key == key)
+        return &cells_[idx];
+      idx = (idx + 1) & mask_;
+    }
+    return nullptr;
+  }
+
+  void searchCell(const Vec3D<std::int64_t> &cellCoordinate,
+                  const Vec3D<NumericType> &coordinate, std::size_t &nearest,
+                  NumericType &minDistance) const {
+    for (int j = 0; j < 3; ++j) {
+      if (cellCoordinate[j] < minCell_[j] || cellCoordinate[j] > maxCell_[j])
+        return;
+    }
+    const auto cell = findCell(getKey(cellCoordinate));
+    if (!cell)
+      return;
+    for (std::size_t i = cell->begin; i < cell->begin + cell->count; ++i) {
+      const auto id = pointIds_[i];
+      const auto &p = sortedPoints_[i];
+      const NumericType dx = p[0] - coordinate[0];
+      const NumericType dy = p[1] - coordinate[1];
+      const NumericType dz = p[2] - coordinate[2];
+      const NumericType distance = dx * dx + dy * dy + dz * dz;
+      // ties are resolved by the lower point ID, independent of the order
+      // of the cells
+      if (distance < minDistance ||
+          (distance == minDistance && id < nearest)) {
+        minDistance = distance;
+        nearest = id;
+      }
+    }
+  }
+
+  // Search all cells with a Chebyshev distance of shell to the center cell.
+  void searchShell(const Vec3D<std::int64_t> &center, const std::int64_t shell,
+                   const Vec3D<NumericType> &coordinate, std::size_t &nearest,
+                   NumericType &minDistance) const {
+    Vec3D<std::int64_t> cell;
+    for (std::int64_t i = -shell; i <= shell; ++i) {
+      cell[0] = center[0] + i;
+      for (std::int64_t j = -shell; j <= shell; ++j) {
+        cell[1] = center[1] + j;
+        const bool onShell = std::abs(i) == shell || std::abs(j) == shell;
+        if (onShell) {
+          for (std::int64_t k = -shell; k <= shell; ++k) {
+            cell[2] = center[2] + k;
+            searchCell(cell, coordinate, nearest, minDistance);
+          }
+        } else {
+          // only the two cells on the boundary of the shell
+          cell[2] = center[2] - shell;
+          searchCell(cell, coordinate, nearest, minDistance);
+          if (shell > 0) {
+            cell[2] = center[2] + shell;
+            searchCell(cell, coordinate, nearest, minDistance);
+          }
+        }
+      }
+    }
+  }
+
+  // points sorted by cell and their original IDs
+  std::vector<Vec3D<NumericType>> sortedPoints_;
+  std::vector<std::size_t> pointIds_;
+  std::size_t numPoints_ = 0;
+  std::vector<Cell> cells_;
+  std::size_t mask_ = 0;
+  NumericType cellSize_ = 1.;
+  NumericType invCellSize_ = 1.;
+  Vec3D<std::int64_t> minCell_{0, 0, 0};
+  Vec3D<std::int64_t> maxCell_{0, 0, 0};
+};
+
+} // namespace viennaps
@@ -0,0 +1,424 @@
+#pragma once
+
+// The monotone partitioning and triangulation are derived from PolyPartition
+// (https://github.com/ivanfratric/polypartition), which is distributed under
+// the following license:
+//
+// Copyright (C) 2011 by Ivan Fratric
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <iterator>
+#include <numeric>
+#include <set>
+#include <vector>
+
+namespace viennaps {
+
+namespace impl {
+
+/// Triangulation of a simple polygon with holes in O(n log n). A sweep line
+/// partitions the polygon into y-monotone pieces, which are then triangulated
+/// in linear time (de Berg et al., Computational Geometry, chapter 3), based on
+/// the implementation of PolyPartition (see the notice above). The
+/// orientation of the boundary and the holes is detected from their signed
+/// area, so the points can be given in either order.
+template <class NumericType> class PolygonTriangulation {
+public:
+  using Point = std::array<NumericType, 2>;
+  using Triangle = std::array<unsigned, 3>;
+
+  explicit PolygonTriangulation(std::vector<Point> boundary) {
+    addRing(std::move(boundary), false);
+  }
+
+  // The holes must lie inside the boundary and must not touch each other.
+  void addHole(std::vector<Point> hole) { addRing(std::move(hole), true); }
+
+  // Returns false if the polygon could not be triangulated, e.g. because it
+  // intersects itself.
+  bool apply() {
+    triangles_.clear();
+    if (ringStarts_.empty() || ringSizes_[0] < 3)
+      return false;
+
+    if (!partition())
+      return false;
+
+    std::vector<char> used(vertices_.size(), 0);
+    std::vector<std::size_t> piece;
+    for (std::size_t i = 0; i < vertices_.size(); ++i) {
+      if (used[i])
+        continue;
+      piece.clear();
+      auto j = i;
+      do {
+        used[j] = 1;
+        piece.push_back(j);
+        j = vertices_[j].next;
+      } while (j != i && piece.size() <= vertices_.size());
+      if (j != i || !triangulateMonotone(piece)) {
+        triangles_.clear();
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Indices of the points of the boundary followed by the points of the
+  // holes, all triangles are counterclockwise.
+  const std::vector<Triangle> &getTriangles() const { return triangles_; }
+
+  // Orientation of the boundary as it was given.
+  bool isCounterClockwise() const { return boundaryCounterClockwise_; }
+
+private:
+  enum class VertexType { Start, End, Split, Merge, Regular };
+
+  struct Vertex {
+    Point p;
+    unsigned point; // index of the input point
+    std::size_t prev;
+    std::size_t next;
+  };
+
+  // Edge from a vertex to its successor, which crosses the sweep line. The
+  // edges are ordered from left to right.
+  struct Edge {
+    Point p1;
+    Point p2;
+    mutable std::size_t index;
+
+    bool operator<(const Edge &other) const {
+      if (other.p1[1] == other.p2[1]) {
+        if (p1[1] == p2[1])
+          return p1[1] < other.p1[1];
+        return isConvex(p1, p2, other.p1);
+      } else if (p1[1] == p2[1]) {
+        return !isConvex(other.p1, other.p2, p1);
+      } else if (p1[1] < other.p1[1]) {
+        return !isConvex(other.p1, other.p2, p1);
+      }
+      return isConvex(p1, p2, other.p1);
+    }
+  };
+
+  using EdgeTree = std::set<Edge>;
+
+  void addRing(std::vector<Point> &&ring, const bool hole) {
+    if (ring.size() < 3 && hole)
+      return;
+
+    NumericType area = 0.;
+    for (std::size_t i = 0; i < ring.size(); ++i) {
+      const auto &a = ring[i];
+      const auto &b = ring[(i + 1) % ring.size()];
+      area += a[0] * b[1] - b[0] * a[1];
+    }
+    const bool counterClockwise = area > 0.;
+    if (!hole)
+      boundaryCounterClockwise_ = counterClockwise;
+
+    // the interior has to be on the left of the edges: the boundary is
+    // counterclockwise, holes are clockwise
+    const bool reverse = counterClockwise == hole;
+    const auto start = vertices_.size();
+    const auto n = ring.size();
+    ringStarts_.push_back(start);
+    ringSizes_.push_back(n);
+    for (std::size_t i = 0; i < n; ++i) {
+      const auto prev = start + (i + n - 1) % n;
+      const auto next = start + (i + 1) % n;
+      vertices_.push_back(Vertex{ring[i], static_cast<unsigned>(start + i),
+                                 reverse ? next : prev,
+                                 reverse ? prev : next});
+    }
+  }
+
+  static bool below(const Point &a, const Point &b) {
+    return a[1] < b[1] || (a[1] == b[1] && a[0] < b[0]);
+  }
+
+  // p3 lies on the left of the line from p1 to p2
+  static bool isConvex(const Point &p1, const Point &p2, const Point &p3) {
+    return (p3[1] - p1[1]) * (p2[0] - p1[0]) -
+               (p3[0] - p1[0]) * (p2[1] - p1[1]) >
+           0.;
+  }
+
+  // Split the vertex cycles into y-monotone cycles by inserting diagonals.
+  bool partition() {
+    const auto numVertices = vertices_.size();
+    std::vector<std::size_t> order(numVertices);
+    std::iota(order.begin(), order.end(), 0);
+    // from top to bottom
+    std::sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+      return below(vertices_[b].p, vertices_[a].p);
+    });
+
+    types_.resize(numVertices);
+    for (std::size_t i = 0; i < numVertices; ++i) {
+      const auto &v = vertices_[i].p;
+      const auto &prev = vertices_[vertices_[i].prev].p;
+      const auto &next = vertices_[vertices_[i].next].p;
+      const bool convex = isConvex(next, prev, v);
+      if (below(prev, v) && below(next, v)) {
+        types_[i] = convex ? VertexType::Start : VertexType::Split;
+      } else if (below(v, prev) && below(v, next)) {
+        types_[i] = convex ? VertexType::End : VertexType::Merge;
+      } else {
+        types_[i] = VertexType::Regular;
+      }
+    }
+
+    EdgeTree edges;
+    edgeIterators_.assign(numVertices, edges.end());
+    helpers_.assign(numVertices, 0);
+
+    auto insertEdge = [&](std::size_t v, std::size_t helper) {
+      const Edge edge{vertices_[v].p, vertices_[vertices_[v].next].p, v};
+      edgeIterators_[v] = edges.insert(edge).first;
+      helpers_[v] = helper;
+    };
+    // edge directly left of the vertex
+    auto findLeftEdge = [&](std::size_t v) {
+      const Edge probe{vertices_[v].p, vertices_[v].p, 0};
+      auto it = edges.lower_bound(probe);
+      return it == edges.begin() ? edges.end() : std::prev(it);
+    };
+    auto isMerge = [&](std::size_t v) {
+      return types_[v] == VertexType::Merge;
+    };
+
+    for (const auto idx : order) {
+      auto v = idx;
+      const auto prev = vertices_[idx].prev;
+
+      switch (types_[idx]) {
+      case VertexType::Start:
+        insertEdge(v, v);
+        break;
+
+      case VertexType::End:
+        if (edgeIterators_[prev] == edges.end())
+          return false;
+        if (isMerge(helpers_[prev]))
+          addDiagonal(idx, helpers_[prev], edges);
+        edges.erase(edgeIterators_[prev]);
+        break;
+
+      case VertexType::Split: {
+        auto left = findLeftEdge(idx);
+        if (left == edges.end())
+          return false;
+        addDiagonal(idx, helpers_[left->index], edges);
+        // the copy of the vertex continues with the next edge
+        v = vertices_.size() - 2;
+        helpers_[left->index] = idx;
+        insertEdge(v, v);
+        break;
+      }
+
+      case VertexType::Merge: {
+        if (edgeIterators_[prev] == edges.end())
+          return false;
+        if (isMerge(helpers_[prev])) {
+          addDiagonal(idx, helpers_[prev], edges);
+          v = vertices_.size() - 2;
+        }
+        edges.erase(edgeIterators_[prev]);
+        auto left = findLeftEdge(idx);
+        if (left == edges.end())
+          return false;
+        if (isMerge(helpers_[left->index]))
+          addDiagonal(v, helpers_[left->index], edges);
+        helpers_[left->index] = v;
+        break;
+      }
+
+      case VertexType::Regular:
+        // the interior lies to the right of the vertex
+        if (below(vertices_[idx].p, vertices_[prev].p)) {
+          if (edgeIterators_[prev] == edges.end())
+            return false;
+          if (isMerge(helpers_[prev])) {
+            addDiagonal(idx, helpers_[prev], edges);
+            v = vertices_.size() - 2;
+          }
+          edges.erase(edgeIterators_[prev]);
+          insertEdge(v, v);
+        } else {
+          auto left = findLeftEdge(idx);
+          if (left == edges.end())
+            return false;
+          if (isMerge(helpers_[left->index]))
+            addDiagonal(idx, helpers_[left->index], edges);
+          helpers_[left->index] = idx;
+        }
+        break;
+      }
+    }
+    return true;
+  }
+
+  // Connect the two vertices by a diagonal. Both vertices are copied, the
+  // copies continue the original cycles.
+  void addDiagonal(const std::size_t a, const std::size_t b,
+                   const EdgeTree &edges) {
+    const auto newA = vertices_.size();
+    const auto newB = newA + 1;
+    vertices_.push_back(vertices_[a]);
+    vertices_.push_back(vertices_[b]);
+
+    vertices_[vertices_[a].next].prev = newA;
+    vertices_[vertices_[b].next].prev = newB;
+    vertices_[a].next = newB;
+    vertices_[newB].prev = a;
+    vertices_[b].next = newA;
+    vertices_[newA].prev = b;
+
+    // the copies own the outgoing edges of the originals
+    for (const auto [copy, original] :
+         {std::pair{newA, a}, std::pair{newB, b}}) {
+      types_.push_back(types_[original]);
+      helpers_.push_back(helpers_[original]);
+      edgeIterators_.push_back(edgeIterators_[original]);
+      if (edgeIterators_[copy] != edges.end())
+        edgeIterators_[copy]->index = copy;
+    }
+  }
+
+  bool triangulateMonotone(const std::vector<std::size_t> &piece) {
+    const auto n = piece.size();
+    auto point = [&](std::size_t i) -> const Point & {
+      return vertices_[piece[i]].p;
+    };
+    auto emit = [&](std::size_t a, std::size_t b, std::size_t c) {
+      triangles_.push_back(Triangle{vertices_[piece[a]].point,
+                                    vertices_[piece[b]].point,
+                                    vertices_[piece[c]].point});
+    };
+
+    if (n < 3)
+      return false;
+    if (n == 3) {
+      emit(0, 1, 2);
+      return true;
+    }
+
+    std::size_t top = 0;
+    std::size_t bottom = 0;
+    for (std::size_t i = 1; i < n; ++i) {
+      if (below(point(i), point(bottom)))
+        bottom = i;
+      if (below(point(top), point(i)))
+        top = i;
+    }
+
+    // both chains have to be monotone
+    for (auto i = top; i != bottom; i = (i + 1) % n) {
+      if (!below(point((i + 1) % n), point(i)))
+        return false;
+    }
+    for (auto i = bottom; i != top; i = (i + 1) % n) {
+      if (!below(point(i), point((i + 1) % n)))
+        return false;
+    }
+
+    // merge the chains from top to bottom, the left chain follows the
+    // counterclockwise order
+    std::vector<std::size_t> order(n);
+    std::vector<int> chain(n, 0); // 1 left, -1 right
+    order[0] = top;
+    auto left = (top + 1) % n;
+    auto right = (top + n - 1) % n;
+    std::size_t k = 1;
+    for (; k + 1 < n; ++k) {
+      if (left == bottom ||
+          (right != bottom && below(point(left), point(right)))) {
+        order[k] = right;
+        chain[right] = -1;
+        right = (right + n - 1) % n;
+      } else {
+        order[k] = left;
+        chain[left] = 1;
+        left = (left + 1) % n;
+      }
+    }
+    order[k] = bottom;
+
+    std::vector<std::size_t> stack = {order[0], order[1]};
+    for (k = 2; k + 1 < n; ++k) {
+      const auto v = order[k];
+      if (chain[v] != chain[stack.back()]) {
+        for (std::size_t j = 0; j + 1 < stack.size(); ++j) {
+          if (chain[v] == 1)
+            emit(stack[j + 1], stack[j], v);
+          else
+            emit(stack[j], stack[j + 1], v);
+        }
+        stack = {order[k - 1], v};
+      } else {
+        auto last = stack.back();
+        stack.pop_back();
+        while (!stack.empty()) {
+          const auto s = stack.back();
+          if (chain[v] == 1 && isConvex(point(v), point(s), point(last))) {
+            emit(v, s, last);
+          } else if (chain[v] != 1 &&
+                     isConvex(point(v), point(last), point(s))) {
+            emit(v, last, s);
+          } else {
+            break;
+          }
+          last = s;
+          stack.pop_back();
+        }
+        stack.push_back(last);
+        stack.push_back(v);
+      }
+    }
+
+    const auto v = order[k];
+    for (std::size_t j = 0; j + 1 < stack.size(); ++j) {
+      if (chain[stack[j + 1]] == 1)
+        emit(stack[j], stack[j + 1], v);
+      else
+        emit(stack[j + 1], stack[j], v);
+    }
+    return true;
+  }
+
+  std::vector<Vertex> vertices_;
+  std::vector<std::size_t> ringStarts_;
+  std::vector<std::size_t> ringSizes_;
+  bool boundaryCounterClockwise_ = true;
+
+  std::vector<VertexType> types_;
+  std::vector<std::size_t> helpers_;
+  std::vector<typename EdgeTree::const_iterator> edgeIterators_;
+
+  std::vector<Triangle> triangles_;
+};
+
+} // namespace impl
+} // namespace viennaps
@@ -1,6 +1,12 @@
 #pragma once
 
+#include "psCheckpoint.hpp"
+#include "psCoverageStore.hpp"
+#include "psPlaneSource.hpp"
 #include "psProcessModel.hpp"
+#include "psProcessTelemetry.hpp"
+#include "psRayTracing.hpp"
+#include "psToDiskMesh.hpp"
 #include "psTranslationField.hpp"
 #include "psUtils.hpp"
 
@@ -13,6 +19,8 @@
 #include <rayParticle.hpp>
 #include <rayTrace.hpp>
 
+#include <typeinfo>
+
 namespace viennaps {
 
 using namespace viennacore;
@@ -21,7 +29,7 @@ using namespace viennacore;
 /// process model to a domain. Depending on the user inputs surface advection, a
 /// single callback function or a geometric advection is applied.
 template <typename NumericType, int D> class Process {
-  using translatorType = std::unordered_map<unsigned long, unsigned long>;
+  using translatorType = Translator;
   using psDomainType = SmartPointer<Domain<NumericType, D>>;
 
 public:
@@ -65,9 +73,78 @@ public:
   // number of points in the process geometry.
   void setNumberOfRaysPerPoint(unsigned numRays) { raysPerPoint = numRays; }
 
+  /// Enable adaptive ray tracing. Each particle type is first traced with
+  /// initialRaysPerPoint rays per point. If the mean relative error of the
+  /// flux is above targetError, the missing rays are traced in a second batch.
+  /// The number of rays per point set with setNumberOfRaysPerPoint is the
+  /// upper limit.
+  void enableAdaptiveRayTracing(NumericType targetError = 0.05,
+                                unsigned initialRaysPerPoint = 100) {
+    adaptiveRayTracing.enabled = true;
+    adaptiveRayTracing.targetError = targetError;
+    adaptiveRayTracing.initialRaysPerPoint = initialRaysPerPoint;
+  }
+
+  // Trace the fixed number of rays per point for every particle type.
+  void disableAdaptiveRayTracing() { adaptiveRayTracing.enabled = false; }
+
+  /// Trace the particle types of the model concurrently, each with its own
+  /// ray tracer. The available threads are split between the particle types.
+  /// This pays off on small geometries, where tracing a single particle type
+  /// does not use all threads efficiently. Only use this mode if the particles
+  /// are independent, i.e. they do not share state apart from the global data.
+  /// ViennaRay does not share the ray tracing geometry between tracers, so
+  /// every tracer holds its own copy of the surface and its own BVH, which is
+  /// rebuilt whenever the surface changes. Memory and build time of the ray
+  /// tracing geometry therefore grow with the number of particle types.
+  void enableConcurrentParticleTracing() { concurrentParticleTracing = true; }
+
+  void disableConcurrentParticleTracing() {
+    concurrentParticleTracing = false;
+  }
+
+  /// Run work which does not influence the next velocity calculation in the
+  /// background: the deferred part of the advection callback, the VTK debug
+  /// output and the nearest point index for the velocity translation. The
+  /// results are identical to the serial schedule.
+  void enablePipelinedStepping() { pipelinedStepping = true; }
+
+  void disablePipelinedStepping() { pipelinedStepping = false; }
+
+  // Returns the performance data of every time step of the last process.
+  const ProcessTelemetry<NumericType> &getTelemetry() const {
+    return telemetry;
+  }
+
+  // Returns the number of rays traced in each time step of the last process.
+  const std::vector<std::size_t> &getTracedRaysPerStep() const {
+    return tracedRaysPerStep;
+  }
+
   // Set the number of iterations to initialize the coverages.
   void setMaxCoverageInitIterations(unsigned maxIt) { maxIterations = maxIt; }
 
+  // Stop the coverage initialization early if the largest change of any
+  // coverage between two iterations is below this tolerance. Defaults to 0,
+  // i.e. all iterations are performed.
+  void setCoverageConvergenceTolerance(NumericType tolerance) {
+    coverageTolerance = tolerance;
+  }
+
+  // Seed the coverage initialization with the coverages from a previous run.
+  // The seed mesh contains the surface points as nodes and the coverages as
+  // cell data (see getCoverageMesh()). The coverages are transferred to the
+  // new surface from the nearest seed point.
+  void setCoverageSeed(SmartPointer<viennals::Mesh<NumericType>> seedMesh) {
+    coverageSeed = seedMesh;
+  }
+
+  // Returns the surface points and the coverages at the end of the last
+  // process, which can be used to seed the coverages of a following process.
+  SmartPointer<viennals::Mesh<NumericType>> getCoverageMesh() const {
+    return coverageMesh;
+  }
+
   /// Enable flux smoothing. The flux at each surface point, calculated
   /// by the ray tracer, is averaged over the surface point neighbors.
   void enableFluxSmoothing() { smoothFlux = true; }
@@ -75,6 +152,15 @@ public:
   // Disable flux smoothing.
   void disableFluxSmoothing() { smoothFlux = false; }
 
+  /// Advect models which only depend on the level sets without extracting
+  /// the surface. These are models with the SurfaceModel base class, no
+  /// particles and translation field option 0, e.g. IsotropicProcess.
+  /// Enabled by default.
+  void enableAnalyticAdvection() { analyticAdvection = true; }
+
+  // Always run the full process loop.
+  void disableAnalyticAdvection() { analyticAdvection = false; }
+
   void enableFluxBoundaries() { ignoreFluxBoundaries = false; }
 
   // Ignore boundary conditions during the flux calculation.
@@ -106,6 +192,32 @@ public:
   // are printed.
   void setPrintTimeInterval(NumericType passedTime) { printTime = passedTime; }
 
+  // Periodically write a checkpoint of the domain and the process state to the
+  // given file during the process. The file is written in the background.
+  void setCheckpointFile(std::string fileName) {
+    checkpointFile = std::move(fileName);
+  }
+
+  // Set the process time between two checkpoints. If this is set to a
+  // non-positive value, the process time is not used to trigger checkpoints.
+  void setCheckpointInterval(NumericType processTimeInterval) {
+    checkpointInterval = processTimeInterval;
+  }
+
+  // Set the wall-clock time in seconds between two checkpoints. If this is set
+  // to a non-positive value, the wall-clock time is not used to trigger
+  // checkpoints. Defaults to 600 seconds.
+  void setCheckpointWallClockInterval(double seconds) {
+    checkpointWallClockInterval = seconds;
+  }
+
+  // Resume the process from a checkpoint file. The domain has to be set up
+  // with the same number of Level-Sets as the domain the checkpoint was
+  // written from. The file is only used for the next call to apply().
+  void setRestartFile(std::string fileName) {
+    restartFile = std::move(fileName);
+  }
+
   // A single flux calculation is performed on the domain surface. The result is
   // stored as point data on the nodes of the mesh.
   SmartPointer<viennals::Mesh<NumericType>> calculateFlux() const {
@@ -143,11 +255,8 @@ public:
     rayTracer.setBoundaryConditions(rayBoundaryCondition);
     rayTracer.setUseRandomSeeds(useRandomSeeds_);
     rayTracer.setCalculateFlux(false);
-    auto source = model->getSource();
-    if (source) {
-      rayTracer.setSource(source);
+    if (model->getSource())
       Logger::getInstance().addInfo("Using custom source.").print();
-    }
     auto primaryDirection = model->getPrimaryDirection();
     if (primaryDirection) {
       Logger::getInstance()
@@ -162,8 +271,11 @@ public:
     auto materialIds = *mesh->getCellData().getScalarData("MaterialIds");
     rayTracer.setGeometry(points, normals, domain->getGrid().getGridDelta());
     rayTracer.setMaterialIds(materialIds);
+    updatePlaneSources(points, domain->getGrid().getGridDelta());
 
+    std::size_t particleIdx = 0;
     for (auto &particle : model->getParticleTypes()) {
+      setTracerSource(rayTracer, model->getParticleSource(particleIdx++));
       rayTracer.setParticleType(particle);
       rayTracer.apply();
 
@@ -214,6 +326,7 @@ public:
       // apply only advection callback
       if (model->getAdvectionCallback()) {
         model->getAdvectionCallback()->setDomain(domain);
+        model->getAdvectionCallback()->setSurface(nullptr, nullptr);
         model->getAdvectionCallback()->applyPreAdvect(0);
       } else {
         Logger::getInstance()
@@ -237,21 +350,52 @@ public:
       return;
     }
 
+    if (isAnalyticModel()) {
+      applyAnalytic();
+      return;
+    }
+
     Timer processTimer;
     processTimer.start();
+    tracedRaysPerStep.clear();
+    telemetry.clear();
 
     double remainingTime = processDuration;
     assert(domain->getLevelSets().size() != 0 && "No level sets in domain.");
+
+    // restore the domain and the process state from a checkpoint, this has to
+    // happen before the material map is passed on
+    CheckpointState<NumericType> restartState;
+    bool resumed = false;
+    if (!restartFile.empty()) {
+      resumed = Checkpoint<NumericType, D>::read(restartFile, domain,
+                                                 restartState);
+      if (resumed) {
+        if (restartState.processDuration != processDuration) {
+          Logger::getInstance()
+              .addWarning("Process duration differs from the duration stored "
+                          "in the checkpoint.")
+              .print();
+        }
+        remainingTime = processDuration - restartState.elapsedTime;
+        coveragesInitialized_ = restartState.coveragesInitialized;
+        Logger::getInstance()
+            .addInfo("Resuming process from checkpoint at process time " +
+                     std::to_string(restartState.elapsedTime) + ".")
+            .print();
+      } else {
+        Logger::getInstance()
+            .addWarning("Could not resume from checkpoint " + restartFile +
+                        ". Starting from the beginning.")
+            .print();
+      }
+      restartFile.clear();
+    }
     const NumericType gridDelta = domain->getGrid().getGridDelta();
 
     auto diskMesh = SmartPointer<viennals::Mesh<NumericType>>::New();
     auto translator = SmartPointer<translatorType>::New();
-    viennals::ToDiskMesh<NumericType, D> meshConverter(diskMesh);
-    meshConverter.setTranslator(translator);
-    if (domain->getMaterialMap() &&
-        domain->getMaterialMap()->size() == domain->getLevelSets().size()) {
-      meshConverter.setMaterialMap(domain->getMaterialMap()->getMaterialMap());
-    }
+    ToDiskMesh<NumericType, D> meshConverter(domain, diskMesh, translator);
 
     auto transField = SmartPointer<TranslationField<NumericType>>::New(
         model->getVelocityField(), domain->getMaterialMap());
@@ -263,7 +407,6 @@ public:
     advectionKernel.setTimeStepRatio(timeStepRatio);
 
     for (auto dom : domain->getLevelSets()) {
-      meshConverter.insertNextLevelSet(dom);
       advectionKernel.insertNextLevelSet(dom);
     }
 
@@ -272,6 +415,14 @@ public:
 
     viennaray::BoundaryCondition rayBoundaryCondition[D];
     viennaray::Trace<NumericType, D> rayTracer;
+    // additional tracers for concurrent particle tracing, one per particle
+    // type except the first
+    std::vector<std::unique_ptr<viennaray::Trace<NumericType, D>>>
+        particleTracers;
+    std::vector<viennaray::Trace<NumericType, D> *> concurrentTracers;
+    const bool useConcurrentTracing =
+        useRayTracing && concurrentParticleTracing &&
+        model->getParticleTypes().size() > 1;
 
     if (useRayTracing) {
       // Map the domain boundary to the ray tracing boundaries
@@ -284,23 +435,40 @@ public:
               domain->getGrid().getBoundaryConditions(i));
       }
 
-      rayTracer.setSourceDirection(sourceDirection);
-      rayTracer.setNumberOfRaysPerPoint(raysPerPoint);
-      rayTracer.setBoundaryConditions(rayBoundaryCondition);
-      rayTracer.setUseRandomSeeds(useRandomSeeds_);
       auto primaryDirection = model->getPrimaryDirection();
       if (primaryDirection) {
         Logger::getInstance()
             .addInfo("Using primary direction: " +
                      utils::arrayToString(primaryDirection.value()))
             .print();
-        rayTracer.setPrimaryDirection(primaryDirection.value());
       }
-      rayTracer.setCalculateFlux(false);
-      auto source = model->getSource();
-      if (source) {
-        rayTracer.setSource(source);
+      if (model->getSource())
         Logger::getInstance().addInfo("Using custom source.").print();
+
+      auto setupTracer = [&](viennaray::Trace<NumericType, D> &tracer) {
+        tracer.setSourceDirection(sourceDirection);
+        tracer.setNumberOfRaysPerPoint(raysPerPoint);
+        tracer.setBoundaryConditions(rayBoundaryCondition);
+        tracer.setUseRandomSeeds(useRandomSeeds_);
+        if (primaryDirection)
+          tracer.setPrimaryDirection(primaryDirection.value());
+        tracer.setCalculateFlux(false);
+      };
+      setupTracer(rayTracer);
+
+      if (useConcurrentTracing) {
+        concurrentTracers.push_back(&rayTracer);
+        for (std::size_t i = 1; i < model->getParticleTypes().size(); ++i) {
+          particleTracers.push_back(
+              std::make_unique<viennaray::Trace<NumericType, D>>());
+          setupTracer(*particleTracers.back());
+          concurrentTracers.push_back(particleTracers.back().get());
+        }
+        Logger::getInstance()
+            .addInfo("Tracing " +
+                     std::to_string(model->getParticleTypes().size()) +
+                     " particle types concurrently.")
+            .print();
       }
 
       // initialize particle data logs
@@ -312,12 +480,32 @@ public:
           particleDataLogs[i].data[0].resize(logSize);
         }
       }
+      if (resumed &&
+          restartState.particleDataLogs.size() == particleDataLogs.size())
+        particleDataLogs = std::move(restartState.particleDataLogs);
     }
 
+    // The ray tracers read the geometry directly from the disk mesh, without a
+    // copy of the points, normals and material IDs.
+    auto setRayGeometry = [&]() {
+      const auto &points = diskMesh->getNodes();
+      const auto &normals = *diskMesh->getCellData().getVectorData("Normals");
+      const auto &materialIds =
+          *diskMesh->getCellData().getScalarData("MaterialIds");
+      rayTracer.setGeometry(points, normals, gridDelta);
+      rayTracer.setMaterialIds(materialIds);
+      for (auto &tracer : particleTracers) {
+        tracer->setGeometry(points, normals, gridDelta);
+        tracer->setMaterialIds(materialIds);
+      }
+      updatePlaneSources(points, gridDelta);
+    };
+
     // Determine whether advection callback is used
     const bool useAdvectionCallback = model->getAdvectionCallback() != nullptr;
     if (useAdvectionCallback) {
       model->getAdvectionCallback()->setDomain(domain);
+      model->getAdvectionCallback()->setSurface(diskMesh, translator);
     }
 
     // Determine whether there are process parameters used in ray tracing
@@ -335,22 +523,37 @@ public:
     // Initialize coverages
     meshConverter.apply();
     auto numPoints = diskMesh->getNodes().size();
-    if (!coveragesInitialized_)
+    if (!coveragesInitialized_ || resumed)
       model->getSurfaceModel()->initializeCoverages(numPoints);
+    if (resumed && restartState.coverages &&
+        model->getSurfaceModel()->getCoverages()) {
+      *model->getSurfaceModel()->getCoverages() = *restartState.coverages;
+    } else if (!coveragesInitialized_ && coverageSeed &&
+               model->getSurfaceModel()->getCoverages()) {
+      seedCoverages(diskMesh->getNodes(),
+                    model->getSurfaceModel()->getCoverages());
+    }
+    CoverageStore<NumericType> coverageStore;
     if (model->getSurfaceModel()->getCoverages() != nullptr) {
       Timer timer;
       useCoverages = true;
+      coverageStore.initialize(
+          model->getSurfaceModel()->getCoverages(),
+          useProcessParams ? model->getSurfaceModel()->getProcessParameters()
+                           : nullptr);
       Logger::getInstance().addInfo("Using coverages.").print();
       if (!coveragesInitialized_) {
         timer.start();
         Logger::getInstance().addInfo("Initializing coverages ... ").print();
-        auto points = diskMesh->getNodes();
-        auto normals = *diskMesh->getCellData().getVectorData("Normals");
-        auto materialIds =
+        const auto &points = diskMesh->getNodes();
+        // copy, the debug output below adds data to the disk mesh
+        const auto materialIds =
             *diskMesh->getCellData().getScalarData("MaterialIds");
-        rayTracer.setGeometry(points, normals, gridDelta);
-        rayTracer.setMaterialIds(materialIds);
+        setRayGeometry();
 
+        std::vector<impl::RateStore<NumericType>> cachedRates(
+            model->getParticleTypes().size());
+        std::vector<bool> isCached(model->getParticleTypes().size(), false);
         for (size_t iterations = 0; iterations < maxIterations; iterations++) {
           // We need additional signal handling when running the C++ code from
           // the
@@ -360,58 +563,41 @@ public:
             throw pybind11::error_already_set();
 #endif
           // move coverages to the ray tracer
-          viennaray::TracingData<NumericType> rayTraceCoverages =
-              movePointDataToRayData(model->getSurfaceModel()->getCoverages());
-          if (useProcessParams) {
-            // store scalars in addition to coverages
-            auto processParams =
-                model->getSurfaceModel()->getProcessParameters();
-            NumericType numParams = processParams->getScalarData().size();
-            rayTraceCoverages.setNumberOfScalarData(numParams);
-            for (size_t i = 0; i < numParams; ++i) {
-              rayTraceCoverages.setScalarData(
-                  i, processParams->getScalarData(i),
-                  processParams->getScalarDataLabel(i));
-            }
-          }
-          rayTracer.setGlobalData(rayTraceCoverages);
-
-          auto rates = SmartPointer<viennals::PointData<NumericType>>::New();
+          rayTracer.setGlobalData(coverageStore.moveToRayData());
 
+          impl::RateStore<NumericType> rateStore;
           std::size_t particleIdx = 0;
           for (auto &particle : model->getParticleTypes()) {
-            int dataLogSize = model->getParticleLogSize(particleIdx);
-            if (dataLogSize > 0) {
-              rayTracer.getDataLog().data.resize(1);
-              rayTracer.getDataLog().data[0].resize(dataLogSize, 0.);
-            }
-            rayTracer.setParticleType(particle);
-            rayTracer.apply();
-
-            // fill up rates vector with rates from this particle type
-            auto &localData = rayTracer.getLocalData();
-            int numRates = particle->getLocalDataLabels().size();
-            for (int i = 0; i < numRates; ++i) {
-              auto rate = std::move(localData.getVectorData(i));
-
-              // normalize fluxes
-              rayTracer.normalizeFlux(rate);
-              if (smoothFlux)
-                rayTracer.smoothFlux(rate);
-              rates->insertNextScalarData(std::move(rate),
-                                          localData.getVectorDataLabel(i));
-            }
-
-            if (dataLogSize > 0) {
-              particleDataLogs[particleIdx].merge(rayTracer.getDataLog());
+            const bool isIndependent =
+                model->isParticleCoverageIndependent(particleIdx);
+            if (isIndependent && isCached[particleIdx]) {
+              // rates of particles which do not depend on the coverages are
+              // only traced once
+              rateStore.append(cachedRates[particleIdx]);
+            } else {
+              // fill up rates vector with rates from this particle type
+              impl::RateStore<NumericType> particleRates;
+              setTracerSource(rayTracer, model->getParticleSource(particleIdx));
+              impl::traceParticle(rayTracer, particle, points.size(),
+                                  raysPerPoint, adaptiveRayTracing, smoothFlux,
+                                  particleRates, particleDataLogs[particleIdx],
+                                  model->getParticleLogSize(particleIdx));
+              if (isIndependent) {
+                cachedRates[particleIdx] = particleRates;
+                isCached[particleIdx] = true;
+              }
+              rateStore.append(std::move(particleRates));
             }
             ++particleIdx;
           }
+          auto rates = rateStore.toPointData();
 
           // move coverages back in the model
-          moveRayDataToPointData(model->getSurfaceModel()->getCoverages(),
-                                 rayTraceCoverages);
+          coverageStore.moveToPointData();
+          auto previousCoverages = *model->getSurfaceModel()->getCoverages();
           model->getSurfaceModel()->updateCoverages(rates, materialIds);
+          const auto residual = calculateCoverageResidual(
+              previousCoverages, *model->getSurfaceModel()->getCoverages());
 
           if (Logger::getLogLevel() >= 3) {
             auto coverages = model->getSurfaceModel()->getCoverages();
@@ -428,8 +614,17 @@ public:
             printDiskMesh(diskMesh, name + "_covIinit_" +
                                         std::to_string(iterations) + ".vtp");
             Logger::getInstance()
-                .addInfo("Iteration: " + std::to_string(iterations))
+                .addInfo("Iteration: " + std::to_string(iterations) +
+                         ", coverage residual: " + std::to_string(residual))
+                .print();
+          }
+
+          if (residual < coverageTolerance) {
+            Logger::getInstance()
+                .addInfo("Coverages converged after " +
+                         std::to_string(iterations + 1) + " iterations.")
                 .print();
+            break;
           }
         }
         coveragesInitialized_ = true;
@@ -441,11 +636,31 @@ public:
       }
     } // end coverage initialization
 
-    double previousTimeStep = 0.;
-    size_t counter = 0;
+    // The disk mesh extracted after advection is reused in the next time step,
+    // unless an advection callback might have changed the domain.
+    bool diskMeshIsCurrent = true;
+    double previousTimeStep = resumed ? restartState.previousTimeStep : 0.;
+    size_t counter = resumed ? restartState.counter : 0;
+
+    CheckpointWriter<NumericType, D> checkpointWriter;
+    const bool useCheckpoints = !checkpointFile.empty();
+    auto lastCheckpointClock = std::chrono::steady_clock::now();
+    NumericType lastCheckpointTime = processDuration - remainingTime;
     Timer rtTimer;
     Timer callbackTimer;
     Timer advTimer;
+    Timer extractionTimer;
+    Timer velocityTimer;
+
+    // background tasks of the pipelined schedule
+    std::future<void> deferredCallback;
+    std::future<void> pendingOutput;
+    std::future<void> pointIndexBuild;
+    auto waitFor = [](std::future<void> &task) {
+      if (task.valid())
+        task.get();
+    };
+
     while (remainingTime > 0.) {
       // We need additional signal handling when running the C++ code from the
       // Python bindings to allow interrupts in the Python scripts
@@ -454,84 +669,96 @@ public:
         throw pybind11::error_already_set();
 #endif
 
+      ProcessStepTelemetry<NumericType> stepTelemetry;
       auto rates = SmartPointer<viennals::PointData<NumericType>>::New();
-      meshConverter.apply();
-      auto materialIds = *diskMesh->getCellData().getScalarData("MaterialIds");
-      auto points = diskMesh->getNodes();
+      if (!diskMeshIsCurrent) {
+        extractionTimer.start();
+        meshConverter.apply();
+        extractionTimer.finish();
+        stepTelemetry.extractionTime += extractionTimer.currentDuration * 1e-9;
+      }
+      // references into the disk mesh, only valid until the debug output adds
+      // data to the mesh
+      const auto &materialIds =
+          *diskMesh->getCellData().getScalarData("MaterialIds");
+      const auto &points = diskMesh->getNodes();
+      stepTelemetry.numSurfacePoints = points.size();
+
+      const bool useNearestPointIndex = transField->usesNearestPointIndex();
+      if (useNearestPointIndex && pipelinedStepping) {
+        pointIndexBuild =
+            std::async(std::launch::async, [&transField, &points, gridDelta]() {
+              transField->buildNearestPointIndex(points, gridDelta);
+            });
+      }
 
       // rate calculation by top-down ray tracing
       if (useRayTracing) {
         rtTimer.start();
-        auto normals = *diskMesh->getCellData().getVectorData("Normals");
-        rayTracer.setGeometry(points, normals, gridDelta);
-        rayTracer.setMaterialIds(materialIds);
+        setRayGeometry();
 
         // move coverages to ray tracer
-        viennaray::TracingData<NumericType> rayTraceCoverages;
         if (useCoverages) {
-          rayTraceCoverages =
-              movePointDataToRayData(model->getSurfaceModel()->getCoverages());
-          if (useProcessParams) {
-            // store scalars in addition to coverages
-            auto processParams =
-                model->getSurfaceModel()->getProcessParameters();
-            NumericType numParams = processParams->getScalarData().size();
-            rayTraceCoverages.setNumberOfScalarData(numParams);
-            for (size_t i = 0; i < numParams; ++i) {
-              rayTraceCoverages.setScalarData(
-                  i, processParams->getScalarData(i),
-                  processParams->getScalarDataLabel(i));
-            }
-          }
+          auto &rayTraceCoverages = coverageStore.moveToRayData();
           rayTracer.setGlobalData(rayTraceCoverages);
+          for (auto &tracer : particleTracers)
+            tracer->setGlobalData(rayTraceCoverages);
         }
 
-        std::size_t particleIdx = 0;
-        for (auto &particle : model->getParticleTypes()) {
-          int dataLogSize = model->getParticleLogSize(particleIdx);
-          if (dataLogSize > 0) {
-            rayTracer.getDataLog().data.resize(1);
-            rayTracer.getDataLog().data[0].resize(dataLogSize, 0.);
-          }
-          rayTracer.setParticleType(particle);
-          rayTracer.apply();
-
-          // fill up rates vector with rates from this particle type
-          auto numRates = particle->getLocalDataLabels().size();
-          auto &localData = rayTracer.getLocalData();
-          for (int i = 0; i < numRates; ++i) {
-            auto rate = std::move(localData.getVectorData(i));
-
-            // normalize rates
-            rayTracer.normalizeFlux(rate);
-            if (smoothFlux)
-              rayTracer.smoothFlux(rate);
-            rates->insertNextScalarData(std::move(rate),
-                                        localData.getVectorDataLabel(i));
+        impl::RateStore<NumericType> rateStore;
+        if (useConcurrentTracing) {
+          std::vector<int> logSizes(model->getParticleTypes().size());
+          for (std::size_t i = 0; i < logSizes.size(); ++i) {
+            logSizes[i] = model->getParticleLogSize(i);
+            setTracerSource(*concurrentTracers[i], model->getParticleSource(i));
           }
-
-          if (dataLogSize > 0) {
-            particleDataLogs[particleIdx].merge(rayTracer.getDataLog());
+          stepTelemetry.raysPerParticle = impl::traceParticlesConcurrently(
+              concurrentTracers, model->getParticleTypes(), points.size(),
+              raysPerPoint, adaptiveRayTracing, smoothFlux, rateStore,
+              particleDataLogs, logSizes);
+        } else {
+          std::size_t particleIdx = 0;
+          for (auto &particle : model->getParticleTypes()) {
+            setTracerSource(rayTracer, model->getParticleSource(particleIdx));
+            // fill up rates vector with rates from this particle type
+            stepTelemetry.raysPerParticle.push_back(impl::traceParticle(
+                rayTracer, particle, points.size(), raysPerPoint,
+                adaptiveRayTracing, smoothFlux, rateStore,
+                particleDataLogs[particleIdx],
+                model->getParticleLogSize(particleIdx)));
+            ++particleIdx;
           }
-          ++particleIdx;
+        }
+        rates = rateStore.toPointData();
+        std::size_t tracedRays = 0;
+        for (const auto rays : stepTelemetry.raysPerParticle)
+          tracedRays += rays;
+        tracedRaysPerStep.push_back(tracedRays);
+        if (adaptiveRayTracing.enabled) {
+          Logger::getInstance()
+              .addInfo("Traced rays: " + std::to_string(tracedRays))
+              .print();
         }
 
         // move coverages back to model
         if (useCoverages)
-          moveRayDataToPointData(model->getSurfaceModel()->getCoverages(),
-                                 rayTraceCoverages);
+          coverageStore.moveToPointData();
         rtTimer.finish();
+        stepTelemetry.rayTracingTime = rtTimer.currentDuration * 1e-9;
         Logger::getInstance()
             .addTiming("Top-down flux calculation", rtTimer)
             .print();
       }
 
       // get velocities from rates
+      velocityTimer.start();
       auto velocities = model->getSurfaceModel()->calculateVelocities(
           rates, points, materialIds);
       model->getVelocityField()->setVelocities(velocities);
-      if (model->getVelocityField()->getTranslationFieldOptions() == 2)
-        transField->buildKdTree(points);
+      if (useNearestPointIndex && !pipelinedStepping)
+        transField->buildNearestPointIndex(points, gridDelta);
+      velocityTimer.finish();
+      stepTelemetry.velocityTime = velocityTimer.currentDuration * 1e-9;
 
       // print debug output
       if (Logger::getLogLevel() >= 4) {
@@ -553,9 +780,23 @@ public:
             diskMesh->getCellData().insertNextScalarData(
                 *rates->getScalarData(idx), label);
           }
-          printDiskMesh(diskMesh,
-                        name + "_" + std::to_string(counter) + ".vtp");
+          if (pipelinedStepping) {
+            // write a copy, the disk mesh is updated in the next step
+            waitFor(pendingOutput);
+            auto meshCopy =
+                SmartPointer<viennals::Mesh<NumericType>>::New(*diskMesh);
+            pendingOutput = std::async(
+                std::launch::async,
+                [this, meshCopy, fileName = name + "_" +
+                                            std::to_string(counter) + ".vtp"]() {
+                  printDiskMesh(meshCopy, fileName);
+                });
+          } else {
+            printDiskMesh(diskMesh,
+                          name + "_" + std::to_string(counter) + ".vtp");
+          }
           if (domain->getCellSet()) {
+            waitFor(deferredCallback);
             domain->getCellSet()->writeVTU(name + "_cellSet_" +
                                            std::to_string(counter) + ".vtu");
           }
@@ -566,9 +807,11 @@ public:
       // apply advection callback
       if (useAdvectionCallback) {
         callbackTimer.start();
+        waitFor(deferredCallback);
         bool continueProcess = model->getAdvectionCallback()->applyPreAdvect(
             processDuration - remainingTime);
         callbackTimer.finish();
+        stepTelemetry.callbackTime += callbackTimer.currentDuration * 1e-9;
         Logger::getInstance()
             .addTiming("Advection callback pre-advect", callbackTimer)
             .print();
@@ -591,13 +834,20 @@ public:
       if (useCoverages)
         moveCoveragesToTopLS(translator,
                              model->getSurfaceModel()->getCoverages());
+      waitFor(pointIndexBuild);
       advTimer.start();
       advectionKernel.apply();
       advTimer.finish();
+      stepTelemetry.advectionTime = advTimer.currentDuration * 1e-9;
       Logger::getInstance().addTiming("Surface advection", advTimer).print();
 
-      // update the translator to retrieve the correct coverages from the LS
+      // extract the new surface, the translator is used to retrieve the
+      // correct coverages from the LS
+      extractionTimer.start();
       meshConverter.apply();
+      extractionTimer.finish();
+      stepTelemetry.extractionTime += extractionTimer.currentDuration * 1e-9;
+      diskMeshIsCurrent = !useAdvectionCallback;
       if (useCoverages)
         updateCoveragesFromAdvectedSurface(
             translator, model->getSurfaceModel()->getCoverages());
@@ -605,9 +855,22 @@ public:
       // apply advection callback
       if (useAdvectionCallback) {
         callbackTimer.start();
-        bool continueProcess = model->getAdvectionCallback()->applyPostAdvect(
-            advectionKernel.getAdvectedTime());
+        const auto advectedTime = advectionKernel.getAdvectedTime();
+        bool continueProcess =
+            model->getAdvectionCallback()->applyPostAdvect(advectedTime);
+        if (continueProcess) {
+          auto callback = model->getAdvectionCallback();
+          if (pipelinedStepping) {
+            deferredCallback =
+                std::async(std::launch::async, [callback, advectedTime]() {
+                  callback->applyPostAdvectDeferred(advectedTime);
+                });
+          } else {
+            callback->applyPostAdvectDeferred(advectedTime);
+          }
+        }
         callbackTimer.finish();
+        stepTelemetry.callbackTime += callbackTimer.currentDuration * 1e-9;
         Logger::getInstance()
             .addTiming("Advection callback post-advect", callbackTimer)
             .print();
@@ -623,6 +886,12 @@ public:
       previousTimeStep = advectionKernel.getAdvectedTime();
       remainingTime -= previousTimeStep;
 
+      stepTelemetry.processTime = processDuration - remainingTime;
+      stepTelemetry.timeStep = previousTimeStep;
+      stepTelemetry.peakMemory =
+          ProcessTelemetry<NumericType>::getPeakMemoryUsage();
+      telemetry.addStep(std::move(stepTelemetry));
+
       if (Logger::getLogLevel() >= 2) {
         std::stringstream stream;
         stream << std::fixed << std::setprecision(4)
@@ -630,9 +899,47 @@ public:
                << processDuration;
         Logger::getInstance().addInfo(stream.str()).print();
       }
+
+      if (useCheckpoints) {
+        const NumericType elapsedTime = processDuration - remainingTime;
+        const auto now = std::chrono::steady_clock::now();
+        const double wallClockTime =
+            std::chrono::duration<double>(now - lastCheckpointClock).count();
+        if ((checkpointInterval > 0. &&
+             elapsedTime - lastCheckpointTime >= checkpointInterval) ||
+            (checkpointWallClockInterval > 0. &&
+             wallClockTime >= checkpointWallClockInterval)) {
+          waitFor(deferredCallback);
+          checkpointWriter.write(
+              checkpointFile, domain,
+              getCheckpointState(elapsedTime, previousTimeStep, counter));
+          lastCheckpointClock = now;
+          lastCheckpointTime = elapsedTime;
+        }
+      }
+    }
+
+    waitFor(pointIndexBuild);
+    waitFor(deferredCallback);
+    waitFor(pendingOutput);
+
+    if (useCheckpoints) {
+      checkpointWriter.write(checkpointFile, domain,
+                             getCheckpointState(processDuration - remainingTime,
+                                                previousTimeStep, counter));
+      checkpointWriter.wait();
     }
 
     processTime = processDuration - remainingTime;
+    if (useCoverages) {
+      coverageMesh = SmartPointer<viennals::Mesh<NumericType>>::New();
+      coverageMesh->nodes = diskMesh->getNodes();
+      auto coverages = model->getSurfaceModel()->getCoverages();
+      for (size_t i = 0; i < coverages->getScalarDataSize(); ++i) {
+        coverageMesh->getCellData().insertNextScalarData(
+            *coverages->getScalarData(i), coverages->getScalarDataLabel(i));
+      }
+    }
     processTimer.finish();
 
     Logger::getInstance()
@@ -674,33 +981,183 @@ public:
   }
 
 private:
-  void printDiskMesh(SmartPointer<viennals::Mesh<NumericType>> mesh,
-                     std::string name) const {
-    viennals::VTKWriter<NumericType>(mesh, std::move(name)).apply();
+  // Models whose surface model is the SurfaceModel base class, which neither
+  // calculates velocities nor uses coverages, and whose velocity field does
+  // not need the surface points (translation field option 0) only depend on
+  // the level sets. Advection callbacks, the intermediate disk mesh output
+  // and checkpoints need the full process loop.
+  bool isAnalyticModel() const {
+    const auto &surfaceModel = *model->getSurfaceModel();
+    return analyticAdvection && model->getParticleTypes().empty() &&
+           typeid(surfaceModel) == typeid(SurfaceModel<NumericType>) &&
+           !model->getAdvectionCallback() &&
+           model->getVelocityField()->getTranslationFieldOptions() == 0 &&
+           checkpointFile.empty() && restartFile.empty() &&
+           Logger::getLogLevel() < 4;
   }
 
-  viennaray::TracingData<NumericType> movePointDataToRayData(
-      SmartPointer<viennals::PointData<NumericType>> pointData) const {
-    viennaray::TracingData<NumericType> rayData;
-    const auto numData = pointData->getScalarDataSize();
-    rayData.setNumberOfVectorData(numData);
-    for (size_t i = 0; i < numData; ++i) {
-      auto label = pointData->getScalarDataLabel(i);
-      rayData.setVectorData(i, std::move(*pointData->getScalarData(label)),
-                            label);
+  // Advect the level sets directly with the velocity field of an analytic
+  // model, without extracting the surface.
+  void applyAnalytic() {
+    const auto name = model->getProcessName().value_or("default");
+    Timer processTimer;
+    Timer advTimer;
+    processTimer.start();
+    tracedRaysPerStep.clear();
+    telemetry.clear();
+    coverageMesh = nullptr;
+
+    auto transField = SmartPointer<TranslationField<NumericType>>::New(
+        model->getVelocityField(), domain->getMaterialMap());
+
+    viennals::Advect<NumericType, D> advectionKernel;
+    advectionKernel.setVelocityField(transField);
+    advectionKernel.setIntegrationScheme(integrationScheme);
+    advectionKernel.setTimeStepRatio(timeStepRatio);
+    for (auto dom : domain->getLevelSets()) {
+      advectionKernel.insertNextLevelSet(dom);
     }
+    Logger::getInstance()
+        .addInfo("Analytic process, advecting without surface extraction.")
+        .print();
 
-    return std::move(rayData);
+    double remainingTime = processDuration;
+    double previousTimeStep = 0.;
+    while (remainingTime > 0.) {
+#ifdef VIENNAPS_PYTHON_BUILD
+      if (PyErr_CheckSignals() != 0)
+        throw pybind11::error_already_set();
+#endif
+      // adjust time step near end
+      if (remainingTime - previousTimeStep < 0.) {
+        advectionKernel.setAdvectionTime(remainingTime);
+      }
+
+      // the base surface model returns no velocities, as in the full loop
+      model->getVelocityField()->setVelocities(nullptr);
+
+      advTimer.start();
+      advectionKernel.apply();
+      advTimer.finish();
+      Logger::getInstance().addTiming("Surface advection", advTimer).print();
+
+      previousTimeStep = advectionKernel.getAdvectedTime();
+      remainingTime -= previousTimeStep;
+
+      ProcessStepTelemetry<NumericType> stepTelemetry;
+      stepTelemetry.advectionTime = advTimer.currentDuration * 1e-9;
+      stepTelemetry.processTime = processDuration - remainingTime;
+      stepTelemetry.timeStep = previousTimeStep;
+      stepTelemetry.peakMemory =
+          ProcessTelemetry<NumericType>::getPeakMemoryUsage();
+      telemetry.addStep(std::move(stepTelemetry));
+
+      if (Logger::getLogLevel() >= 2) {
+        std::stringstream stream;
+        stream << std::fixed << std::setprecision(4)
+               << "Process time: " << processDuration - remainingTime << " / "
+               << processDuration;
+        Logger::getInstance().addInfo(stream.str()).print();
+      }
+    }
+
+    processTime = processDuration - remainingTime;
+    processTimer.finish();
+    Logger::getInstance()
+        .addTiming("\nProcess " + name, processTimer)
+        .addTiming("Surface advection total time",
+                   advTimer.totalDuration * 1e-9,
+                   processTimer.totalDuration * 1e-9)
+        .print();
+  }
+
+  // Transfer the coverages of the seed mesh to the surface points, using the
+  // value of the nearest seed point.
+  void seedCoverages(const std::vector<Vec3D<NumericType>> &points,
+                     SmartPointer<viennals::PointData<NumericType>> coverages) {
+    if (coverageSeed->nodes.empty())
+      return;
+
+    KDTree<NumericType, Vec3D<NumericType>> kdTree;
+    kdTree.setPoints(coverageSeed->nodes);
+    kdTree.build();
+
+    std::vector<std::size_t> nearestIds(points.size());
+#pragma omp parallel for
+    for (long i = 0; i < static_cast<long>(points.size()); ++i)
+      nearestIds[i] = kdTree.findNearest(points[i])->first;
+
+    for (size_t i = 0; i < coverages->getScalarDataSize(); ++i) {
+      auto label = coverages->getScalarDataLabel(i);
+      auto seedData = coverageSeed->getCellData().getScalarData(label, true);
+      if (!seedData || seedData->size() != coverageSeed->nodes.size())
+        continue;
+      auto &coverage = *coverages->getScalarData(i);
+      coverage.resize(points.size());
+      for (std::size_t j = 0; j < points.size(); ++j)
+        coverage[j] = (*seedData)[nearestIds[j]];
+    }
+    Logger::getInstance()
+        .addInfo("Seeded coverages from previous surface.")
+        .print();
+  }
+
+  static void setTracerSource(
+      viennaray::Trace<NumericType, D> &tracer,
+      SmartPointer<viennaray::Source<NumericType>> source) {
+    if (source)
+      tracer.setSource(source);
+    else
+      tracer.resetSource();
   }
 
-  void moveRayDataToPointData(
-      SmartPointer<viennals::PointData<NumericType>> pointData,
-      viennaray::TracingData<NumericType> &rayData) const {
-    pointData->clear();
-    const auto numData = rayData.getVectorData().size();
-    for (size_t i = 0; i < numData; ++i)
-      pointData->insertNextScalarData(std::move(rayData.getVectorData(i)),
-                                      rayData.getVectorDataLabel(i));
+  // Place the plane sources of the model above the current surface.
+  void updatePlaneSources(const std::vector<Vec3D<NumericType>> &points,
+                          const NumericType gridDelta) const {
+    auto update = [&](SmartPointer<viennaray::Source<NumericType>> source) {
+      if (auto planeSource =
+              std::dynamic_pointer_cast<PlaneSource<NumericType, D>>(source))
+        planeSource->setGeometry(points, gridDelta, sourceDirection,
+                                 model->getPrimaryDirection());
+    };
+    update(model->getSource());
+    for (std::size_t i = 0; i < model->getParticleTypes().size(); ++i)
+      update(model->getParticleSource(i));
+  }
+
+  // Largest absolute change of any coverage.
+  static NumericType
+  calculateCoverageResidual(const viennals::PointData<NumericType> &previous,
+                            const viennals::PointData<NumericType> &current) {
+    NumericType residual = 0.;
+    for (size_t i = 0; i < current.getScalarDataSize(); ++i) {
+      auto prev = previous.getScalarData(current.getScalarDataLabel(i), true);
+      auto curr = current.getScalarData(i);
+      if (!prev || prev->size() != curr->size())
+        return std::numeric_limits<NumericType>::max();
+      for (std::size_t j = 0; j < curr->size(); ++j)
+        residual = std::max(residual, std::abs((*curr)[j] - (*prev)[j]));
+    }
+    return residual;
+  }
+
+  CheckpointState<NumericType> getCheckpointState(NumericType elapsedTime,
+                                                  NumericType previousTimeStep,
+                                                  std::size_t counter) const {
+    CheckpointState<NumericType> state;
+    state.processDuration = processDuration;
+    state.elapsedTime = elapsedTime;
+    state.previousTimeStep = previousTimeStep;
+    state.counter = counter;
+    state.coveragesInitialized = coveragesInitialized_;
+    state.coverages = model->getSurfaceModel()->getCoverages();
+    state.particleDataLogs = particleDataLogs;
+    return state;
+  }
+
+  void printDiskMesh(SmartPointer<viennals::Mesh<NumericType>> mesh,
+                     std::string name) const {
+    viennals::VTKWriter<NumericType>(mesh, std::move(name)).apply();
   }
 
   void moveCoveragesToTopLS(
@@ -710,9 +1167,13 @@ private:
     for (size_t i = 0; i < coverages->getScalarDataSize(); i++) {
       auto covName = coverages->getScalarDataLabel(i);
       std::vector<NumericType> levelSetData(topLS->getNumberOfPoints(), 0);
-      auto cov = coverages->getScalarData(covName);
-      for (const auto iter : *translator.get()) {
-        levelSetData[iter.first] = cov->at(iter.second);
+      const auto &cov = *coverages->getScalarData(covName);
+      const auto &lsToMesh = translator->data();
+      const auto numPoints = std::min(lsToMesh.size(), levelSetData.size());
+#pragma omp parallel for
+      for (long lsId = 0; lsId < static_cast<long>(numPoints); ++lsId) {
+        if (auto meshId = lsToMesh[lsId]; meshId != Translator::invalidId)
+          levelSetData[lsId] = cov[meshId];
       }
       if (auto data = topLS->getPointData().getScalarData(covName, true);
           data != nullptr) {
@@ -733,8 +1194,11 @@ private:
       auto levelSetData = topLS->getPointData().getScalarData(covName);
       auto covData = coverages->getScalarData(covName);
       covData->resize(translator->size());
-      for (const auto it : *translator.get()) {
-        covData->at(it.second) = levelSetData->at(it.first);
+      const auto &lsToMesh = translator->data();
+#pragma omp parallel for
+      for (long lsId = 0; lsId < static_cast<long>(lsToMesh.size()); ++lsId) {
+        if (auto meshId = lsToMesh[lsId]; meshId != Translator::invalidId)
+          (*covData)[meshId] = (*levelSetData)[lsId];
       }
     }
   }
@@ -748,14 +1212,27 @@ private:
   viennals::IntegrationSchemeEnum integrationScheme =
       viennals::IntegrationSchemeEnum::ENGQUIST_OSHER_1ST_ORDER;
   unsigned raysPerPoint = 1000;
+  AdaptiveRayTracingParameters<NumericType> adaptiveRayTracing;
+  bool concurrentParticleTracing = false;
+  bool pipelinedStepping = false;
+  std::vector<std::size_t> tracedRaysPerStep;
+  ProcessTelemetry<NumericType> telemetry;
   std::vector<viennaray::DataLog<NumericType>> particleDataLogs;
   bool useRandomSeeds_ = true;
   bool smoothFlux = true;
   bool ignoreFluxBoundaries = false;
+  bool analyticAdvection = true;
   unsigned maxIterations = 20;
+  NumericType coverageTolerance = 0.;
+  SmartPointer<viennals::Mesh<NumericType>> coverageSeed = nullptr;
+  SmartPointer<viennals::Mesh<NumericType>> coverageMesh = nullptr;
   bool coveragesInitialized_ = false;
   NumericType printTime = 0.;
   NumericType processTime = 0.;
+  std::string checkpointFile;
+  std::string restartFile;
+  NumericType checkpointInterval = 0.;
+  double checkpointWallClockInterval = 600.;
   NumericType timeStepRatio = 0.4999;
 };
 
@@ -24,7 +24,9 @@ protected:
   std::vector<std::unique_ptr<viennaray::AbstractParticle<NumericType>>>
       particles;
   SmartPointer<viennaray::Source<NumericType>> source = nullptr;
+  std::vector<SmartPointer<viennaray::Source<NumericType>>> particleSources;
   std::vector<int> particleLogSize;
+  std::vector<bool> particleCoverageIndependent;
   SmartPointer<SurfaceModel<NumericType>> surfaceModel = nullptr;
   SmartPointer<AdvectionCallback<NumericType, D>> advectionCallback = nullptr;
   SmartPointer<GeometricModel<NumericType, D>> geometricModel = nullptr;
@@ -42,6 +44,14 @@ public:
   auto getVelocityField() const { return velocityField; }
   auto getSource() { return source; }
 
+  // Source of a particle type, falls back to the source of the model.
+  SmartPointer<viennaray::Source<NumericType>>
+  getParticleSource(std::size_t particleIdx) const {
+    if (particleIdx < particleSources.size() && particleSources[particleIdx])
+      return particleSources[particleIdx];
+    return source;
+  }
+
   /// Set a primary direction for the source distribution (tilted distribution).
   virtual std::optional<std::array<NumericType, 3>>
   getPrimaryDirection() const {
@@ -54,6 +64,20 @@ public:
     return particleLogSize[particleIdx];
   }
 
+  // Particles whose rates do not depend on the surface coverages are only
+  // traced once during the coverage initialization.
+  bool isParticleCoverageIndependent(std::size_t particleIdx) const {
+    return particleIdx < particleCoverageIndependent.size() &&
+           particleCoverageIndependent[particleIdx];
+  }
+
+  void setParticleCoverageIndependent(std::size_t particleIdx,
+                                      bool independent = true) {
+    if (particleCoverageIndependent.size() <= particleIdx)
+      particleCoverageIndependent.resize(particleIdx + 1, false);
+    particleCoverageIndependent[particleIdx] = independent;
+  }
+
   void setProcessName(std::string name) { processName = std::move(name); }
 
   virtual void
@@ -74,6 +98,15 @@ public:
     source = passedSource;
   }
 
+  // Set a source which is only used for one particle type.
+  void setParticleSource(
+      std::size_t particleIdx,
+      SmartPointer<viennaray::Source<NumericType>> passedSource) {
+    if (particleSources.size() <= particleIdx)
+      particleSources.resize(particleIdx + 1, nullptr);
+    particleSources[particleIdx] = passedSource;
+  }
+
   void
   setSurfaceModel(SmartPointer<SurfaceModel<NumericType>> passedSurfaceModel) {
     surfaceModel = passedSurfaceModel;
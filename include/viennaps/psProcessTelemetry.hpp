@@ -0,0 +1,156 @@
+#pragma once
+
+#include <vcLogger.hpp>
+
+#include <cstddef>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+// On Windows the peak memory query needs <windows.h>, which is only included
+// if VIENNAPS_WINDOWS_PEAK_MEMORY is defined. Otherwise peakMemory is 0.
+#if !defined(_WIN32)
+#include <sys/resource.h>
+#elif defined(VIENNAPS_WINDOWS_PEAK_MEMORY)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#endif
+
+namespace viennaps {
+
+using namespace viennacore;
+
+/// Performance data of a single time step of a process.
+template <class NumericType> struct ProcessStepTelemetry {
+  std::size_t step = 0;
+  // process time at the end of the step
+  NumericType processTime = 0.;
+  // time step according to the CFL condition
+  NumericType timeStep = 0.;
+  std::size_t numSurfacePoints = 0;
+  std::vector<std::size_t> raysPerParticle;
+  // wall times in seconds
+  double extractionTime = 0.;
+  double rayTracingTime = 0.;
+  double velocityTime = 0.;
+  double advectionTime = 0.;
+  double callbackTime = 0.;
+  // memory high-water mark of the program in bytes
+  std::size_t peakMemory = 0;
+};
+
+/// Collects the telemetry of all time steps of a process run and exports it
+/// as JSON or CSV.
+template <class NumericType> class ProcessTelemetry {
+  std::vector<ProcessStepTelemetry<NumericType>> steps_;
+
+public:
+  void clear() { steps_.clear(); }
+
+  void addStep(ProcessStepTelemetry<NumericType> step) {
+    step.step = steps_.size();
+    steps_.push_back(std::move(step));
+  }
+
+  const std::vector<ProcessStepTelemetry<NumericType>> &getSteps() const {
+    return steps_;
+  }
+
+  std::size_t size() const { return steps_.size(); }
+
+  bool empty() const { return steps_.empty(); }
+
+  void writeJSON(std::ostream &stream) const {
+    stream << std::setprecision(9) << "[";
+    for (std::size_t i = 0; i < steps_.size(); ++i) {
+      const auto &s = steps_[i];
+      stream << (i == 0 ? "\n" : ",\n") << "  {\"step\": " << s.step
+             << ", \"processTime\": " << s.processTime
+             << ", \"timeStep\": " << s.timeStep
+             << ", \"numSurfacePoints\": " << s.numSurfacePoints
+             << ", \"raysPerParticle\": [";
+      for (std::size_t j = 0; j < s.raysPerParticle.size(); ++j)
+        stream << (j == 0 ? "" : ", ") << s.raysPerParticle[j];
+      stream << "], \"extractionTime\": " << s.extractionTime
+             << ", \"rayTracingTime\": " << s.rayTracingTime
+             << ", \"velocityTime\": " << s.velocityTime
+             << ", \"advectionTime\": " << s.advectionTime
+             << ", \"callbackTime\": " << s.callbackTime
+             << ", \"peakMemory\": " << s.peakMemory << "}";
+    }
+    stream << (steps_.empty() ? "]\n" : "\n]\n");
+  }
+
+  // The rays of the individual particle types are separated by ';' in the
+  // raysPerParticle column.
+  void writeCSV(std::ostream &stream) const {
+    stream << std::setprecision(9)
+           << "step,processTime,timeStep,numSurfacePoints,raysPerParticle,"
+              "extractionTime,rayTracingTime,velocityTime,advectionTime,"
+              "callbackTime,peakMemory\n";
+    for (const auto &s : steps_) {
+      stream << s.step << "," << s.processTime << "," << s.timeStep << ","
+             << s.numSurfacePoints << ",";
+      for (std::size_t j = 0; j < s.raysPerParticle.size(); ++j)
+        stream << (j == 0 ? "" : ";") << s.raysPerParticle[j];
+      stream << "," << s.extractionTime << "," << s.rayTracingTime << ","
+             << s.velocityTime << "," << s.advectionTime << ","
+             << s.callbackTime << "," << s.peakMemory << "\n";
+    }
+  }
+
+  bool writeJSON(const std::string &fileName) const {
+    std::ofstream file(fileName);
+    if (!file.is_open()) {
+      Logger::getInstance()
+          .addWarning("Could not open file " + fileName + ".")
+          .print();
+      return false;
+    }
+    writeJSON(file);
+    return file.good();
+  }
+
+  bool writeCSV(const std::string &fileName) const {
+    std::ofstream file(fileName);
+    if (!file.is_open()) {
+      Logger::getInstance()
+          .addWarning("Could not open file " + fileName + ".")
+          .print();
+      return false;
+    }
+    writeCSV(file);
+    return file.good();
+  }
+
+  // Returns the peak resident memory of the program in bytes or 0 if it can
+  // not be determined.
+  static std::size_t getPeakMemoryUsage() {
+#if defined(_WIN32)
+#if defined(VIENNAPS_WINDOWS_PEAK_MEMORY)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters,
+                             sizeof(counters)))
+      return static_cast<std::size_t>(counters.PeakWorkingSetSize);
+#endif
+    return 0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+      return 0;
+#if defined(__APPLE__)
+    // bytes on macOS
+    return static_cast<std::size_t>(usage.ru_maxrss);
+#else
+    // kilobytes on Linux
+    return static_cast<std::size_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+  }
+};
+
+} // namespace viennaps
@@ -0,0 +1,259 @@
+#pragma once
+
+#include <lsPointData.hpp>
+#include <rayParticle.hpp>
+#include <rayTrace.hpp>
+
+#include <vcLogger.hpp>
+#include <vcSmartPointer.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace viennaps {
+
+using namespace viennacore;
+
+/// Parameters for adaptive ray tracing. Each particle type is first traced
+/// with initialRaysPerPoint rays. From the relative error of this first batch
+/// the number of rays needed to reach the target error is estimated (the error
+/// decreases with the square root of the number of rays) and the missing rays
+/// are traced in a second batch. The total is limited by the fixed number of
+/// rays per point of the process.
+template <class NumericType> struct AdaptiveRayTracingParameters {
+  bool enabled = false;
+  // Target for the mean relative error of the flux on the surface points.
+  NumericType targetError = 0.05;
+  unsigned initialRaysPerPoint = 100;
+};
+
+namespace impl {
+
+/// Rates of the traced particle types, in the order in which they were traced.
+/// The rates are moved into point data once all particle types are traced.
+template <class NumericType> class RateStore {
+public:
+  // Returns the index of the inserted rate.
+  std::size_t insert(std::vector<NumericType> &&rate, std::string label) {
+    labels_.push_back(std::move(label));
+    rates_.push_back(std::move(rate));
+    return labels_.size() - 1;
+  }
+
+  // rate += weight * (other - rate)
+  void blend(const std::size_t idx, const std::vector<NumericType> &other,
+             const NumericType weight) {
+    auto &rate = rates_[idx];
+    for (std::size_t j = 0; j < rate.size(); ++j)
+      rate[j] += weight * (other[j] - rate[j]);
+  }
+
+  template <class Function>
+  void modify(const std::size_t idx, Function &&function) {
+    function(rates_[idx]);
+  }
+
+  void append(const RateStore &other) {
+    labels_.insert(labels_.end(), other.labels_.begin(), other.labels_.end());
+    rates_.insert(rates_.end(), other.rates_.begin(), other.rates_.end());
+  }
+
+  void append(RateStore &&other) {
+    std::move(other.labels_.begin(), other.labels_.end(),
+              std::back_inserter(labels_));
+    std::move(other.rates_.begin(), other.rates_.end(),
+              std::back_inserter(rates_));
+    other.clear();
+  }
+
+  // Move the rates into point data, which leaves the store empty.
+  SmartPointer<viennals::PointData<NumericType>> toPointData() {
+    auto pointData = SmartPointer<viennals::PointData<NumericType>>::New();
+    for (std::size_t i = 0; i < labels_.size(); ++i)
+      pointData->insertNextScalarData(std::move(rates_[i]), labels_[i]);
+    clear();
+    return pointData;
+  }
+
+  void clear() {
+    labels_.clear();
+    rates_.clear();
+  }
+
+  std::size_t size() const { return labels_.size(); }
+
+private:
+  std::vector<std::string> labels_;
+  std::vector<std::vector<NumericType>> rates_;
+};
+
+// Trace a single particle type and insert the normalized rates into the rate
+// store. Returns the number of rays that were traced. If debugMessages is
+// given, the log messages are collected there instead of being printed, so
+// that they can be printed from the calling thread.
+template <class NumericType, int D>
+std::size_t
+traceParticle(viennaray::Trace<NumericType, D> &rayTracer,
+              std::unique_ptr<viennaray::AbstractParticle<NumericType>> &particle,
+              const std::size_t numPoints, const unsigned raysPerPoint,
+              const AdaptiveRayTracingParameters<NumericType> &adaptive,
+              const bool smoothFlux, RateStore<NumericType> &rates,
+              viennaray::DataLog<NumericType> &dataLog, const int dataLogSize,
+              std::vector<std::string> *debugMessages = nullptr) {
+  const auto numRates = particle->getLocalDataLabels().size();
+  std::vector<std::size_t> rateIds(numRates);
+  bool firstBatch = true;
+
+  const bool useAdaptive =
+      adaptive.enabled && adaptive.initialRaysPerPoint < raysPerPoint;
+
+  auto traceBatch = [&](unsigned batchRays, NumericType weight) {
+    if (dataLogSize > 0) {
+      rayTracer.getDataLog().data.resize(1);
+      rayTracer.getDataLog().data[0].resize(dataLogSize, 0.);
+    }
+    rayTracer.setNumberOfRaysPerPoint(batchRays);
+    rayTracer.setParticleType(particle);
+    rayTracer.apply();
+
+    auto &localData = rayTracer.getLocalData();
+    for (std::size_t i = 0; i < numRates; ++i) {
+      auto rate = std::move(localData.getVectorData(i));
+      rayTracer.normalizeFlux(rate);
+      if (firstBatch) {
+        rateIds[i] =
+            rates.insert(std::move(rate), localData.getVectorDataLabel(i));
+      } else {
+        // both batches are estimates of the same rate, weight them by the
+        // number of rays
+        rates.blend(rateIds[i], rate, weight);
+      }
+    }
+    firstBatch = false;
+
+    if (dataLogSize > 0)
+      dataLog.merge(rayTracer.getDataLog());
+  };
+
+  unsigned tracedRaysPerPoint = useAdaptive ? adaptive.initialRaysPerPoint
+                                            : raysPerPoint;
+  // the hit counter is needed for the error estimate
+  rayTracer.setCalculateFlux(useAdaptive);
+  traceBatch(tracedRaysPerPoint, 1.);
+  rayTracer.setCalculateFlux(false);
+
+  if (useAdaptive) {
+    const auto error = rayTracer.getRelativeError();
+    NumericType meanError = 0.;
+    std::size_t numHitPoints = 0;
+    for (const auto e : error) {
+      if (e > 0. && std::isfinite(e)) {
+        meanError += e;
+        ++numHitPoints;
+      }
+    }
+    if (numHitPoints > 0)
+      meanError /= numHitPoints;
+
+    if (meanError > adaptive.targetError) {
+      const NumericType ratio = meanError / adaptive.targetError;
+      const auto requiredRays = static_cast<unsigned>(std::min(
+          std::ceil(tracedRaysPerPoint * ratio * ratio),
+          static_cast<NumericType>(raysPerPoint)));
+      if (requiredRays > tracedRaysPerPoint) {
+        const unsigned additionalRays = requiredRays - tracedRaysPerPoint;
+        traceBatch(additionalRays,
+                   static_cast<NumericType>(additionalRays) / requiredRays);
+        tracedRaysPerPoint = requiredRays;
+      }
+    }
+
+    std::string message = "Adaptive ray tracing: initial error " +
+                          std::to_string(meanError) + ", " +
+                          std::to_string(tracedRaysPerPoint) +
+                          " rays per point.";
+    if (debugMessages)
+      debugMessages->push_back(std::move(message));
+    else
+      Logger::getInstance().addDebug(message).print();
+    rayTracer.setNumberOfRaysPerPoint(raysPerPoint);
+  }
+
+  if (smoothFlux) {
+    for (const auto idx : rateIds)
+      rates.modify(idx, [&](auto &rate) { rayTracer.smoothFlux(rate); });
+  }
+
+  return static_cast<std::size_t>(tracedRaysPerPoint) * numPoints;
+}
+
+// Trace all particle types concurrently, each particle type with its own
+// tracer. The tracers have to be set up with the same geometry, settings and
+// global data. The available threads are split between the tracers. The rates
+// are inserted in the order of the particle types. Returns the number of rays
+// that were traced for each particle type. The Logger is not thread-safe, so
+// the messages of the tracing threads are printed after they are joined.
+template <class NumericType, int D>
+std::vector<std::size_t> traceParticlesConcurrently(
+    std::vector<viennaray::Trace<NumericType, D> *> &rayTracers,
+    std::vector<std::unique_ptr<viennaray::AbstractParticle<NumericType>>>
+        &particles,
+    const std::size_t numPoints, const unsigned raysPerPoint,
+    const AdaptiveRayTracingParameters<NumericType> &adaptive,
+    const bool smoothFlux, RateStore<NumericType> &rates,
+    std::vector<viennaray::DataLog<NumericType>> &dataLogs,
+    const std::vector<int> &dataLogSizes) {
+  const auto numParticles = particles.size();
+  assert(rayTracers.size() >= numParticles);
+
+#ifdef _OPENMP
+  const int numThreads = omp_get_max_threads();
+#else
+  const int numThreads = 1;
+#endif
+  const int numTracers = static_cast<int>(numParticles);
+
+  std::vector<RateStore<NumericType>> particleRates(numParticles);
+  std::vector<std::size_t> tracedRays(numParticles, 0);
+  std::vector<std::vector<std::string>> debugMessages(numParticles);
+  std::vector<std::thread> threads;
+  threads.reserve(numParticles);
+  for (int i = 0; i < numTracers; ++i) {
+    // the first tracers get the remaining threads
+    const int threadBudget = std::max(
+        1, numThreads / numTracers + (i < numThreads % numTracers ? 1 : 0));
+    threads.emplace_back([&, i, threadBudget]() {
+#ifdef _OPENMP
+      omp_set_num_threads(threadBudget);
+#endif
+      tracedRays[i] = traceParticle(*rayTracers[i], particles[i], numPoints,
+                                    raysPerPoint, adaptive, smoothFlux,
+                                    particleRates[i], dataLogs[i],
+                                    dataLogSizes[i], &debugMessages[i]);
+    });
+  }
+  for (auto &thread : threads)
+    thread.join();
+
+  for (const auto &messages : debugMessages) {
+    for (const auto &message : messages)
+      Logger::getInstance().addDebug(message).print();
+  }
+
+  for (auto &particleRate : particleRates)
+    rates.append(std::move(particleRate));
+  return tracedRays;
+}
+
+} // namespace impl
+} // namespace viennaps
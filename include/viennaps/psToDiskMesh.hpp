@@ -1,18 +1,32 @@
 #pragma once
 
 #include "psDomain.hpp"
+#include "psTranslator.hpp"
 
-#include <lsToDiskMesh.hpp>
+#include <hrleSparseIterator.hpp>
+#include <hrleSparseStarIterator.hpp>
+#include <lsExpand.hpp>
+
+#include <vcLogger.hpp>
+
+#include <limits>
 
 namespace viennaps {
 
 using namespace viennacore;
 
+/// Converts the surface of all Level-Sets in the domain to a disk mesh (a point
+/// cloud with normals and material IDs). The mesh and the translator, which
+/// maps Level-Set point IDs to mesh point IDs, are built in a single pass over
+/// the top Level-Set.
 template <class NumericType, int D> class ToDiskMesh {
-  using translatorType =
-      SmartPointer<std::unordered_map<unsigned long, unsigned long>>;
+  using translatorType = SmartPointer<Translator>;
   using psDomainType = SmartPointer<Domain<NumericType, D>>;
   using meshType = SmartPointer<viennals::Mesh<NumericType>>;
+  using hrleDomainType = typename viennals::Domain<NumericType, D>::DomainType;
+
+  static constexpr NumericType maxValue = 0.5;
+  static constexpr NumericType wrappingLayerEpsilon = 1e-4;
 
   psDomainType domain;
   translatorType translator;
@@ -39,16 +53,130 @@ public:
   translatorType getTranslator() const { return translator; }
 
   void apply() {
-    viennals::ToDiskMesh<NumericType, D> meshConverter;
-    meshConverter.setMesh(mesh);
-    if (domain->getMaterialMap())
-      meshConverter.setMaterialMap(domain->getMaterialMap()->getMaterialMap());
-    if (translator.get())
-      meshConverter.setTranslator(translator);
-    for (const auto ls : domain->getLevelSets()) {
-      meshConverter.insertNextLevelSet(ls);
+    if (!domain || domain->getLevelSets().empty()) {
+      Logger::getInstance()
+          .addWarning("No level sets passed to ToDiskMesh.")
+          .print();
+      return;
+    }
+    if (!mesh) {
+      Logger::getInstance().addWarning("No mesh passed to ToDiskMesh.").print();
+      return;
+    }
+
+    const auto &levelSets = domain->getLevelSets();
+    auto topLevelSet = levelSets.back();
+    const NumericType gridDelta = topLevelSet->getGrid().getGridDelta();
+
+    SmartPointer<viennals::MaterialMap> materialMap = nullptr;
+    if (domain->getMaterialMap() &&
+        domain->getMaterialMap()->size() == levelSets.size())
+      materialMap = domain->getMaterialMap()->getMaterialMap();
+
+    // the normal vectors are calculated from the direct neighbors, so the top
+    // Level-Set needs a width of at least 3 around the surface
+    viennals::Expand<NumericType, D>(topLevelSet,
+                                     static_cast<int>(maxValue * 4) + 1)
+        .apply();
+
+    if (translator)
+      translator->reset(topLevelSet->getNumberOfPoints());
+
+    std::vector<Vec3D<NumericType>> nodes;
+    std::vector<Vec3D<NumericType>> normals;
+    std::vector<NumericType> values;
+    std::vector<NumericType> materialIds;
+    // the surface changes little between the calls of a process
+    const auto reserveSize = mesh->nodes.size();
+    nodes.reserve(reserveSize);
+    normals.reserve(reserveSize);
+    values.reserve(reserveSize);
+    materialIds.reserve(reserveSize);
+
+    Vec3D<NumericType> minExtent{std::numeric_limits<NumericType>::max(),
+                                 std::numeric_limits<NumericType>::max(),
+                                 std::numeric_limits<NumericType>::max()};
+    Vec3D<NumericType> maxExtent{std::numeric_limits<NumericType>::lowest(),
+                                 std::numeric_limits<NumericType>::lowest(),
+                                 std::numeric_limits<NumericType>::lowest()};
+    if constexpr (D == 2) {
+      minExtent[2] = 0.;
+      maxExtent[2] = 0.;
     }
-    meshConverter.apply();
+
+    // one iterator per Level-Set to determine the material of a point
+    std::vector<hrleConstSparseIterator<hrleDomainType>> iterators;
+    iterators.reserve(levelSets.size());
+    for (const auto &ls : levelSets)
+      iterators.emplace_back(ls->getDomain());
+
+    for (hrleConstSparseStarIterator<hrleDomainType, 1> neighborIt(
+             topLevelSet->getDomain());
+         !neighborIt.isFinished(); neighborIt.next()) {
+
+      const auto &center = neighborIt.getCenter();
+      if (!center.isDefined() || std::abs(center.getValue()) > maxValue)
+        continue;
+
+      const NumericType value = center.getValue();
+      const auto &index = center.getStartIndices();
+
+      // normal vector from central differences
+      Vec3D<NumericType> normal{0., 0., 0.};
+      NumericType denominator = 0.;
+      for (int i = 0; i < D; ++i) {
+        NumericType pos = neighborIt.getNeighbor(i).getValue() - value;
+        NumericType neg = value - neighborIt.getNeighbor(i + D).getValue();
+        normal[i] = (pos + neg) * 0.5;
+        denominator += normal[i] * normal[i];
+      }
+      denominator = std::sqrt(denominator);
+      if (denominator > 0.) {
+        for (int i = 0; i < D; ++i)
+          normal[i] /= denominator;
+      }
+
+      // the material is given by the lowest Level-Set which wraps the point
+      int lsId = 0;
+      for (auto &it : iterators) {
+        it.goToIndicesSequential(index);
+        if (it.getValue() <= value + wrappingLayerEpsilon)
+          break;
+        ++lsId;
+      }
+      lsId = std::min(lsId, static_cast<int>(levelSets.size()) - 1);
+      const NumericType materialId =
+          materialMap ? materialMap->getMaterialId(lsId) : lsId;
+
+      if (translator)
+        translator->insert(center.getPointId(), nodes.size());
+
+      // shift the grid point onto the surface along the normal
+      Vec3D<NumericType> node{0., 0., 0.};
+      for (int i = 0; i < D; ++i) {
+        node[i] = (static_cast<NumericType>(index[i]) - value * normal[i]) *
+                  gridDelta;
+        minExtent[i] = std::min(minExtent[i], node[i]);
+        maxExtent[i] = std::max(maxExtent[i], node[i]);
+      }
+
+      nodes.push_back(node);
+      normals.push_back(normal);
+      values.push_back(value);
+      materialIds.push_back(materialId);
+    }
+
+    mesh->clear();
+    mesh->vertices.resize(nodes.size());
+    for (unsigned i = 0; i < nodes.size(); ++i)
+      mesh->vertices[i] = {i};
+    mesh->nodes = std::move(nodes);
+    mesh->minimumExtent = minExtent;
+    mesh->maximumExtent = maxExtent;
+    mesh->getCellData().insertNextScalarData(std::move(values), "LSValues");
+    mesh->getCellData().insertNextVectorData(std::move(normals), "Normals");
+    mesh->getCellData().insertNextScalarData(std::move(materialIds),
+                                             "MaterialIds");
   }
 };
 
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "psMaterials.hpp"
+#include "psPointGrid.hpp"
+#include "psTranslator.hpp"
 #include "psVelocityField.hpp"
 
 #include <lsVelocityField.hpp>
@@ -16,8 +18,6 @@ using namespace viennacore;
 
 template <typename NumericType>
 class TranslationField : public viennals::VelocityField<NumericType> {
-  using TranslatorType = std::unordered_map<unsigned long, unsigned long>;
-
 public:
   TranslationField(
       SmartPointer<viennaps::VelocityField<NumericType>> velocityField,
@@ -47,6 +47,38 @@ public:
                                                   normalVector, pointId);
   }
 
+  // Batched velocity query for a whole set of Level-Set points. The point IDs
+  // and materials are translated once for the batch before the model's
+  // batched velocity function is called. The translated data is kept in
+  // per-thread buffers, which are reused for all batches.
+  void getScalarVelocities(const std::vector<Vec3D<NumericType>> &coordinates,
+                           const std::vector<int> &materials,
+                           const std::vector<Vec3D<NumericType>> &normalVectors,
+                           const std::vector<unsigned long> &pointIds,
+                           std::vector<NumericType> &velocities) {
+    thread_local std::vector<int> surfaceMaterials;
+    thread_local std::vector<unsigned long> surfaceIds;
+    const auto &ids = translateBatch(coordinates, materials, pointIds,
+                                     surfaceMaterials, surfaceIds);
+    modelVelocityField_->getScalarVelocities(
+        coordinates, materialMap_ ? surfaceMaterials : materials,
+        normalVectors, ids, velocities);
+  }
+
+  void getVectorVelocities(const std::vector<Vec3D<NumericType>> &coordinates,
+                           const std::vector<int> &materials,
+                           const std::vector<Vec3D<NumericType>> &normalVectors,
+                           const std::vector<unsigned long> &pointIds,
+                           std::vector<Vec3D<NumericType>> &velocities) {
+    thread_local std::vector<int> surfaceMaterials;
+    thread_local std::vector<unsigned long> surfaceIds;
+    const auto &ids = translateBatch(coordinates, materials, pointIds,
+                                     surfaceMaterials, surfaceIds);
+    modelVelocityField_->getVectorVelocities(
+        coordinates, materialMap_ ? surfaceMaterials : materials,
+        normalVectors, ids, velocities);
+  }
+
   NumericType
   getDissipationAlpha(int direction, int material,
                       const Vec3D<NumericType> &centralDifferences) {
@@ -56,7 +88,7 @@ public:
                                                     centralDifferences);
   }
 
-  void setTranslator(SmartPointer<TranslatorType> translator) {
+  void setTranslator(SmartPointer<Translator> translator) {
     translator_ = translator;
   }
 
@@ -65,13 +97,35 @@ public:
     kdTree_.build();
   }
 
+  void buildPointGrid(const std::vector<Vec3D<NumericType>> &points,
+                      const NumericType gridDelta) {
+    pointGrid_.build(points, gridDelta);
+  }
+
+  // Build the nearest point index of the translation method, if it uses one.
+  void buildNearestPointIndex(const std::vector<Vec3D<NumericType>> &points,
+                              const NumericType gridDelta) {
+    if (translationMethod_ == 2)
+      buildKdTree(points);
+    else if (translationMethod_ == 3)
+      buildPointGrid(points, gridDelta);
+  }
+
+  // Whether the translation method needs a nearest point index.
+  bool usesNearestPointIndex() const {
+    return translationMethod_ == 2 || translationMethod_ == 3;
+  }
+
   void translateLsId(unsigned long &lsId,
                      const Vec3D<NumericType> &coordinate) const {
     switch (translationMethod_) {
     case 1: {
-      if (auto it = translator_->find(lsId); it != translator_->end()) {
-        lsId = it->second;
+      if (auto meshId = translator_->find(lsId);
+          meshId != Translator::invalidId) {
+        lsId = meshId;
       } else {
+        // the velocity field does not move points without a surface point
+        lsId = Translator::invalidId;
         Logger::getInstance()
             .addWarning("Could not extend velocity from surface to LS point")
             .print();
@@ -83,14 +137,42 @@ public:
       lsId = nearest->first;
       break;
     }
+    case 3: {
+      lsId = pointGrid_.findNearest(coordinate);
+      break;
+    }
     default:
       break;
     }
   }
 
 private:
-  SmartPointer<TranslatorType> translator_;
+  // Returns the translated point IDs. The untranslated IDs are passed through
+  // without a copy if no translation is used.
+  const std::vector<unsigned long> &
+  translateBatch(const std::vector<Vec3D<NumericType>> &coordinates,
+                 const std::vector<int> &materials,
+                 const std::vector<unsigned long> &pointIds,
+                 std::vector<int> &surfaceMaterials,
+                 std::vector<unsigned long> &surfaceIds) const {
+    if (materialMap_) {
+      surfaceMaterials.resize(materials.size());
+      for (std::size_t i = 0; i < materials.size(); ++i)
+        surfaceMaterials[i] =
+            static_cast<int>(materialMap_->getMaterialAtIdx(materials[i]));
+    }
+    if (translationMethod_ == 0)
+      return pointIds;
+
+    surfaceIds.assign(pointIds.begin(), pointIds.end());
+    for (std::size_t i = 0; i < surfaceIds.size(); ++i)
+      translateLsId(surfaceIds[i], coordinates[i]);
+    return surfaceIds;
+  }
+
+  SmartPointer<Translator> translator_;
   KDTree<NumericType, Vec3D<NumericType>> kdTree_;
+  PointGrid<NumericType> pointGrid_;
   const SmartPointer<viennaps::VelocityField<NumericType>> modelVelocityField_;
   const SmartPointer<MaterialMap> materialMap_;
   const int translationMethod_ = 1;
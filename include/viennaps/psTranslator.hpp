@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+namespace viennaps {
+
+/// Maps Level-Set point IDs to the IDs of the corresponding disk mesh points.
+/// The map is stored as a dense array indexed by the Level-Set point ID, which
+/// makes lookups a single array access. Level-Set points that are not part of
+/// the surface are marked with invalidId.
+class Translator {
+public:
+  static constexpr unsigned long invalidId =
+      std::numeric_limits<unsigned long>::max();
+
+  Translator() = default;
+
+  explicit Translator(std::size_t numLevelSetPoints)
+      : lsToMesh_(numLevelSetPoints, invalidId) {}
+
+  // Remove all entries and set the number of Level-Set points.
+  void reset(std::size_t numLevelSetPoints) {
+    lsToMesh_.assign(numLevelSetPoints, invalidId);
+    numSurfacePoints_ = 0;
+  }
+
+  void clear() {
+    lsToMesh_.clear();
+    numSurfacePoints_ = 0;
+  }
+
+  void insert(unsigned long lsId, unsigned long meshId) {
+    if (lsId >= lsToMesh_.size())
+      lsToMesh_.resize(lsId + 1, invalidId);
+    if (lsToMesh_[lsId] == invalidId)
+      ++numSurfacePoints_;
+    lsToMesh_[lsId] = meshId;
+  }
+
+  // Returns the mesh point ID of a Level-Set point or invalidId if the point is
+  // not part of the surface.
+  unsigned long find(unsigned long lsId) const {
+    return lsId < lsToMesh_.size() ? lsToMesh_[lsId] : invalidId;
+  }
+
+  bool contains(unsigned long lsId) const { return find(lsId) != invalidId; }
+
+  // Number of surface (mesh) points in the map.
+  std::size_t size() const { return numSurfacePoints_; }
+
+  bool empty() const { return numSurfacePoints_ == 0; }
+
+  // Number of Level-Set points the map covers.
+  std::size_t getNumberOfLevelSetPoints() const { return lsToMesh_.size(); }
+
+  // Direct access to the underlying array, indexed by Level-Set point ID.
+  const std::vector<unsigned long> &data() const { return lsToMesh_; }
+
+private:
+  std::vector<unsigned long> lsToMesh_;
+  std::size_t numSurfacePoints_ = 0;
+};
+
+} // namespace viennaps
@@ -33,13 +33,45 @@ public:
     return 0;
   }
 
+  // Batched version of getScalarVelocity. All input vectors have the same
+  // length, the output vector is resized accordingly. The default
+  // implementation falls back to the per-point call.
+  virtual void
+  getScalarVelocities(const std::vector<Vec3D<NumericType>> &coordinates,
+                      const std::vector<int> &materials,
+                      const std::vector<Vec3D<NumericType>> &normalVectors,
+                      const std::vector<unsigned long> &pointIds,
+                      std::vector<NumericType> &velocities) {
+    velocities.resize(coordinates.size());
+    for (std::size_t i = 0; i < coordinates.size(); ++i) {
+      velocities[i] = getScalarVelocity(coordinates[i], materials[i],
+                                        normalVectors[i], pointIds[i]);
+    }
+  }
+
+  // Batched version of getVectorVelocity.
+  virtual void
+  getVectorVelocities(const std::vector<Vec3D<NumericType>> &coordinates,
+                      const std::vector<int> &materials,
+                      const std::vector<Vec3D<NumericType>> &normalVectors,
+                      const std::vector<unsigned long> &pointIds,
+                      std::vector<Vec3D<NumericType>> &velocities) {
+    velocities.resize(coordinates.size());
+    for (std::size_t i = 0; i < coordinates.size(); ++i) {
+      velocities[i] = getVectorVelocity(coordinates[i], materials[i],
+                                        normalVectors[i], pointIds[i]);
+    }
+  }
+
   virtual void
   setVelocities(SmartPointer<std::vector<NumericType>> velocities) {}
 
   // translation field options
   // 0: do not translate level set ID to surface ID
-  // 1: use unordered map to translate level set ID to surface ID
+  // 1: use the dense Translator array to translate level set ID to surface ID
   // 2: use kd-tree to translate level set ID to surface ID
+  // 3: use a hash grid of the surface points to translate level set ID to
+  //    surface ID, faster than the kd-tree with the same result
   virtual int getTranslationFieldOptions() const { return 1; }
 };
 
@@ -52,7 +84,18 @@ public:
   virtual NumericType getScalarVelocity(const Vec3D<NumericType> &, int,
                                         const Vec3D<NumericType> &,
                                         unsigned long pointId) override {
-    return velocities_->at(pointId);
+    return velocityAt(*velocities_, pointId);
+  }
+
+  void getScalarVelocities(const std::vector<Vec3D<NumericType>> &coordinates,
+                           const std::vector<int> &,
+                           const std::vector<Vec3D<NumericType>> &,
+                           const std::vector<unsigned long> &pointIds,
+                           std::vector<NumericType> &velocities) override {
+    const auto &surfaceVelocities = *velocities_;
+    velocities.resize(coordinates.size());
+    for (std::size_t i = 0; i < coordinates.size(); ++i)
+      velocities[i] = velocityAt(surfaceVelocities, pointIds[i]);
   }
 
   void
@@ -65,6 +108,13 @@ public:
   }
 
 private:
+  // Points without a surface point, e.g. a failed translation which gives
+  // Translator::invalidId, are not moved.
+  static NumericType velocityAt(const std::vector<NumericType> &velocities,
+                                const unsigned long pointId) {
+    return pointId < velocities.size() ? velocities[pointId] : 0.;
+  }
+
   SmartPointer<std::vector<NumericType>> velocities_;
   const int translationFieldOptions_ = 1; // default: use map translator
 };
@@ -5,6 +5,7 @@
 
 #define PYBIND11_DETAILED_ERROR_MESSAGES
 #define VIENNAPS_PYTHON_BUILD
+#define VIENNAPS_WINDOWS_PEAK_MEMORY
 
 // correct module name macro
 #define TOKENPASTE_INTERNAL(x, y, z) x##y##z
@@ -29,6 +30,7 @@
 #include <psExtrude.hpp>
 #include <psGDSGeometry.hpp>
 #include <psGDSReader.hpp>
+#include <psIonEnergyAngleDistribution.hpp>
 #include <psPlanarize.hpp>
 #include <psProcess.hpp>
 
@@ -52,6 +54,7 @@
 #include <models/psFluorocarbonEtching.hpp>
 #include <models/psGeometricDistributionModels.hpp>
 #include <models/psIsotropicProcess.hpp>
+#include <models/psMultiRateProcess.hpp>
 #include <models/psOxideRegrowth.hpp>
 #include <models/psSF6O2Etching.hpp>
 #include <models/psSingleParticleALD.hpp>
@@ -588,6 +591,23 @@ PYBIND11_MODULE(VIENNAPS_MODULE_NAME, module) {
            pybind11::arg("stickingProbabilityP2") = 0.,
            pybind11::arg("rateP2") = 0., pybind11::arg("orderP2") = 0.);
 
+  // Ion Energy Angle Distribution
+  pybind11::class_<IonEnergyAngleDistribution<T>,
+                   SmartPointer<IonEnergyAngleDistribution<T>>>(
+      module, "IonEnergyAngleDistribution")
+      .def(pybind11::init(&SmartPointer<IonEnergyAngleDistribution<T>>::New<
+                          std::vector<T>, std::vector<T>, std::vector<T>>),
+           pybind11::arg("energyEdges"), pybind11::arg("angleEdges"),
+           pybind11::arg("weights"))
+      .def(pybind11::init(&SmartPointer<IonEnergyAngleDistribution<T>>::New<
+                          const std::string &>),
+           pybind11::arg("fileName"))
+      .def("getMeanEnergy", &IonEnergyAngleDistribution<T>::getMeanEnergy)
+      .def("getNumberOfEnergyBins",
+           &IonEnergyAngleDistribution<T>::getNumberOfEnergyBins)
+      .def("getNumberOfAngleBins",
+           &IonEnergyAngleDistribution<T>::getNumberOfAngleBins);
+
   // SF6O2 Parameters
   pybind11::class_<SF6O2Parameters<T>::MaskType>(module, "SF6O2ParametersMask")
       .def(pybind11::init<>())
@@ -658,7 +678,10 @@ PYBIND11_MODULE(VIENNAPS_MODULE_NAME, module) {
            pybind11::arg("parameters"))
       .def("setParameters", &SF6O2Etching<T, D>::setParameters)
       .def("getParameters", &SF6O2Etching<T, D>::getParameters,
-           pybind11::return_value_policy::reference);
+           pybind11::return_value_policy::reference)
+      .def("setIonEnergyAngleDistribution",
+           &SF6O2Etching<T, D>::setIonEnergyAngleDistribution,
+           pybind11::arg("distribution"));
 
   // Fluorocarbon Parameters
   pybind11::class_<FluorocarbonParameters<T>::MaskType>(
@@ -762,7 +785,10 @@ PYBIND11_MODULE(VIENNAPS_MODULE_NAME, module) {
            pybind11::arg("parameters"))
       .def("setParameters", &FluorocarbonEtching<T, D>::setParameters)
       .def("getParameters", &FluorocarbonEtching<T, D>::getParameters,
-           pybind11::return_value_policy::reference);
+           pybind11::return_value_policy::reference)
+      .def("setIonEnergyAngleDistribution",
+           &FluorocarbonEtching<T, D>::setIonEnergyAngleDistribution,
+           pybind11::arg("distribution"));
 
   // Isotropic Process
   pybind11::class_<IsotropicProcess<T, D>,
@@ -778,6 +804,35 @@ PYBIND11_MODULE(VIENNAPS_MODULE_NAME, module) {
            }),
            pybind11::arg("rate"), pybind11::arg("maskMaterial"));
 
+  // Multi Rate Process
+  pybind11::class_<MultiRateProcess<T, D>,
+                   SmartPointer<MultiRateProcess<T, D>>>(
+      module, "MultiRateProcess", processModel)
+      .def(pybind11::init(&SmartPointer<MultiRateProcess<T, D>>::New<>))
+      .def("setIsotropicRate",
+           pybind11::overload_cast<const Material, const T>(
+               &MultiRateProcess<T, D>::setIsotropicRate),
+           pybind11::arg("material"), pybind11::arg("rate"),
+           "Set the isotropic rate of a material.")
+      .def("setIsotropicRate",
+           pybind11::overload_cast<const std::vector<Material> &, const T>(
+               &MultiRateProcess<T, D>::setIsotropicRate),
+           pybind11::arg("materials"), pybind11::arg("rate"),
+           "Set the isotropic rate of several materials.")
+      .def("addDirectionalRate",
+           pybind11::overload_cast<const Material, const std::array<T, 3> &,
+                                   const T>(
+               &MultiRateProcess<T, D>::addDirectionalRate),
+           pybind11::arg("material"), pybind11::arg("direction"),
+           pybind11::arg("rate"), "Add a directional rate to a material.")
+      .def("addDirectionalRate",
+           pybind11::overload_cast<const std::vector<Material> &,
+                                   const std::array<T, 3> &, const T>(
+               &MultiRateProcess<T, D>::addDirectionalRate),
+           pybind11::arg("materials"), pybind11::arg("direction"),
+           pybind11::arg("rate"),
+           "Add a directional rate to several materials.");
+
   // Directional Etching
   pybind11::class_<DirectionalEtching<T, D>,
                    SmartPointer<DirectionalEtching<T, D>>>(
@@ -842,7 +897,9 @@ PYBIND11_MODULE(VIENNAPS_MODULE_NAME, module) {
           pybind11::arg("diffusionCoefficient"), pybind11::arg("sinkStrength"),
           pybind11::arg("scallopVelocity"), pybind11::arg("centerVelocity"),
           pybind11::arg("topHeight"), pybind11::arg("centerWidth"),
-          pybind11::arg("stabilityFactor"));
+          pybind11::arg("stabilityFactor"))
+      .def("setImplicitTimeStep", &OxideRegrowth<T, D>::setImplicitTimeStep,
+           pybind11::arg("timeStep"));
 
   // Anisotropic Process
   pybind11::class_<AnisotropicProcess<T, D>,
@@ -1050,6 +1107,29 @@ PYBIND11_MODULE(VIENNAPS_MODULE_NAME, module) {
            "lsIntegrationSchemeEnum.")
       .def("setNumCycles", &AtomicLayerProcess<T, D>::setNumCycles,
            "Set the number of cycles for the process.")
+      .def("enableAdaptiveRayTracing",
+           &AtomicLayerProcess<T, D>::enableAdaptiveRayTracing,
+           pybind11::arg("targetError") = 0.05,
+           pybind11::arg("initialRaysPerPoint") = 100,
+           "Trace each particle with a small number of rays first and only "
+           "trace more rays if the relative flux error is above the target.")
+      .def("disableAdaptiveRayTracing",
+           &AtomicLayerProcess<T, D>::disableAdaptiveRayTracing,
+           "Trace the fixed number of rays per point for every particle.")
+      .def("getTracedRaysPerStep", &AtomicLayerProcess<T, D>::getTracedRaysPerStep,
+           "Returns the number of rays traced in each step of the last "
+           "process.")
+      .def("setCheckpointFile", &AtomicLayerProcess<T, D>::setCheckpointFile,
+           "Write checkpoints of the domain and the process state to this "
+           "file.")
+      .def("setCheckpointInterval",
+           &AtomicLayerProcess<T, D>::setCheckpointInterval,
+           "Set the number of cycles between two checkpoints.")
+      .def("setCheckpointWallClockInterval",
+           &AtomicLayerProcess<T, D>::setCheckpointWallClockInterval,
+           "Set the wall-clock time in seconds between two checkpoints.")
+      .def("setRestartFile", &AtomicLayerProcess<T, D>::setRestartFile,
+           "Resume the process from a checkpoint file.")
       .def("enableRandomSeeds", &AtomicLayerProcess<T, D>::enableRandomSeeds,
            "Enable random seeds for the ray tracer. This will make the process "
            "results non-deterministic.")
@@ -1058,6 +1138,38 @@ PYBIND11_MODULE(VIENNAPS_MODULE_NAME, module) {
           "Disable random seeds for the ray tracer. This will make the process "
           "results deterministic.");
 
+  // ProcessTelemetry
+  pybind11::class_<ProcessStepTelemetry<T>>(module, "ProcessStepTelemetry")
+      .def(pybind11::init<>())
+      .def_readonly("step", &ProcessStepTelemetry<T>::step)
+      .def_readonly("processTime", &ProcessStepTelemetry<T>::processTime)
+      .def_readonly("timeStep", &ProcessStepTelemetry<T>::timeStep)
+      .def_readonly("numSurfacePoints",
+                    &ProcessStepTelemetry<T>::numSurfacePoints)
+      .def_readonly("raysPerParticle",
+                    &ProcessStepTelemetry<T>::raysPerParticle)
+      .def_readonly("extractionTime", &ProcessStepTelemetry<T>::extractionTime)
+      .def_readonly("rayTracingTime", &ProcessStepTelemetry<T>::rayTracingTime)
+      .def_readonly("velocityTime", &ProcessStepTelemetry<T>::velocityTime)
+      .def_readonly("advectionTime", &ProcessStepTelemetry<T>::advectionTime)
+      .def_readonly("callbackTime", &ProcessStepTelemetry<T>::callbackTime)
+      .def_readonly("peakMemory", &ProcessStepTelemetry<T>::peakMemory);
+
+  pybind11::class_<ProcessTelemetry<T>>(module, "ProcessTelemetry")
+      .def(pybind11::init<>())
+      .def("getSteps", &ProcessTelemetry<T>::getSteps,
+           pybind11::return_value_policy::reference_internal,
+           "Returns the telemetry of all time steps.")
+      .def("writeJSON",
+           pybind11::overload_cast<const std::string &>(
+               &ProcessTelemetry<T>::writeJSON, pybind11::const_),
+           "Write the telemetry to a JSON file.")
+      .def("writeCSV",
+           pybind11::overload_cast<const std::string &>(
+               &ProcessTelemetry<T>::writeCSV, pybind11::const_),
+           "Write the telemetry to a CSV file.")
+      .def("__len__", &ProcessTelemetry<T>::size);
+
   // Process
   pybind11::class_<Process<T, D>>(module, "Process")
       // constructors
@@ -1081,9 +1193,50 @@ PYBIND11_MODULE(VIENNAPS_MODULE_NAME, module) {
       .def("setNumberOfRaysPerPoint", &Process<T, D>::setNumberOfRaysPerPoint,
            "Set the number of rays to traced for each particle in the process. "
            "The number is per point in the process geometry.")
+      .def("enableAdaptiveRayTracing",
+           &Process<T, D>::enableAdaptiveRayTracing,
+           pybind11::arg("targetError") = 0.05,
+           pybind11::arg("initialRaysPerPoint") = 100,
+           "Trace each particle with a small number of rays first and only "
+           "trace more rays if the relative flux error is above the target.")
+      .def("disableAdaptiveRayTracing",
+           &Process<T, D>::disableAdaptiveRayTracing,
+           "Trace the fixed number of rays per point for every particle.")
+      .def("enableConcurrentParticleTracing",
+           &Process<T, D>::enableConcurrentParticleTracing,
+           "Trace the particle types concurrently, each with its own ray "
+           "tracer. Every tracer builds its own copy of the ray tracing "
+           "geometry, which multiplies its memory by the number of particle "
+           "types.")
+      .def("disableConcurrentParticleTracing",
+           &Process<T, D>::disableConcurrentParticleTracing,
+           "Trace the particle types one after another.")
+      .def("enablePipelinedStepping", &Process<T, D>::enablePipelinedStepping,
+           "Run debug output, the deferred advection callback work and the "
+           "KD-tree build in the background.")
+      .def("disablePipelinedStepping",
+           &Process<T, D>::disablePipelinedStepping,
+           "Run all work of a time step one after another.")
+      .def("getTelemetry", &Process<T, D>::getTelemetry,
+           pybind11::return_value_policy::reference_internal,
+           "Returns the performance data of every time step of the last "
+           "process.")
+      .def("getTracedRaysPerStep", &Process<T, D>::getTracedRaysPerStep,
+           "Returns the number of rays traced in each step of the last "
+           "process.")
       .def("setMaxCoverageInitIterations",
            &Process<T, D>::setMaxCoverageInitIterations,
            "Set the number of iterations to initialize the coverages.")
+      .def("setCoverageConvergenceTolerance",
+           &Process<T, D>::setCoverageConvergenceTolerance,
+           "Stop the coverage initialization once the largest change of any "
+           "coverage between two iterations is below this tolerance.")
+      .def("setCoverageSeed", &Process<T, D>::setCoverageSeed,
+           "Seed the coverage initialization with the coverages of a previous "
+           "process (see getCoverageMesh).")
+      .def("getCoverageMesh", &Process<T, D>::getCoverageMesh,
+           "Returns the surface points and coverages at the end of the last "
+           "process.")
       .def("setPrintTimeInterval", &Process<T, D>::setPrintTimeInterval,
            "Sets the minimum time between printing intermediate results during "
            "the process. If this is set to a non-positive value, no "
@@ -1102,6 +1255,22 @@ PYBIND11_MODULE(VIENNAPS_MODULE_NAME, module) {
            "by the ray tracer, is averaged over the surface point neighbors.")
       .def("disableFluxSmoothing", &Process<T, D>::disableFluxSmoothing,
            "Disable flux smoothing")
+      .def("enableAnalyticAdvection", &Process<T, D>::enableAnalyticAdvection,
+           "Advect models which only depend on the level sets without "
+           "extracting the surface (default).")
+      .def("disableAnalyticAdvection",
+           &Process<T, D>::disableAnalyticAdvection,
+           "Always run the full process loop.")
+      .def("setCheckpointFile", &Process<T, D>::setCheckpointFile,
+           "Write checkpoints of the domain and the process state to this "
+           "file.")
+      .def("setCheckpointInterval", &Process<T, D>::setCheckpointInterval,
+           "Set the process time between two checkpoints.")
+      .def("setCheckpointWallClockInterval",
+           &Process<T, D>::setCheckpointWallClockInterval,
+           "Set the wall-clock time in seconds between two checkpoints.")
+      .def("setRestartFile", &Process<T, D>::setRestartFile,
+           "Resume the process from a checkpoint file.")
       .def("enableRandomSeeds", &Process<T, D>::enableRandomSeeds,
            "Enable random seeds for the ray tracer. This will make the process "
            "results non-deterministic.")
@@ -1221,6 +1390,21 @@ PYBIND11_MODULE(VIENNAPS_MODULE_NAME, module) {
 
 #if VIENNAPS_PYTHON_DIMENSION > 2
   // GDS file parsing
+  pybind11::class_<GDSGeometry<T, D>::LayerExtrusion>(module,
+                                                      "GDSLayerExtrusion")
+      .def(pybind11::init<>())
+      .def(pybind11::init([](int16_t layer, T baseHeight, T height, bool mask) {
+             return GDSGeometry<T, D>::LayerExtrusion{layer, baseHeight, height,
+                                                      mask};
+           }),
+           pybind11::arg("layer"), pybind11::arg("baseHeight"),
+           pybind11::arg("height"), pybind11::arg("mask") = false)
+      .def_readwrite("layer", &GDSGeometry<T, D>::LayerExtrusion::layer)
+      .def_readwrite("baseHeight",
+                     &GDSGeometry<T, D>::LayerExtrusion::baseHeight)
+      .def_readwrite("height", &GDSGeometry<T, D>::LayerExtrusion::height)
+      .def_readwrite("mask", &GDSGeometry<T, D>::LayerExtrusion::mask);
+
   pybind11::class_<GDSGeometry<T, D>, SmartPointer<GDSGeometry<T, D>>>(
       module, "GDSGeometry")
       // constructors
@@ -1241,9 +1425,17 @@ PYBIND11_MODULE(VIENNAPS_MODULE_NAME, module) {
       .def("setBoundaryPadding", &GDSGeometry<T, D>::setBoundaryPadding,
            "Set padding between the largest point of the geometry and the "
            "boundary of the domain.")
+      .def("setClipWindow", &GDSGeometry<T, D>::setClipWindow,
+           "Only import the part of the layout inside the window (xMin, yMin, "
+           "xMax, yMax). The domain bounds follow the window.")
+      .def("clearClipWindow", &GDSGeometry<T, D>::clearClipWindow,
+           "Import the whole layout.")
       .def("print", &GDSGeometry<T, D>::print, "Print the geometry contents.")
       .def("layerToLevelSet", &GDSGeometry<T, D>::layerToLevelSet,
            "Convert a layer of the GDS geometry to a level set domain.")
+      .def("layersToLevelSets", &GDSGeometry<T, D>::layersToLevelSets,
+           "Convert several layers of the GDS geometry to level set domains "
+           "in parallel.")
       .def(
           "getBounds",
           [](GDSGeometry<T, D> &gds) -> std::array<double, 6> {
@@ -1267,7 +1459,12 @@ PYBIND11_MODULE(VIENNAPS_MODULE_NAME, module) {
            "Set the domain to be parsed in.")
       .def("setFileName", &GDSReader<T, D>::setFileName,
            "Set name of the GDS file.")
-      .def("apply", &GDSReader<T, D>::apply, "Parse the GDS file.");
+      .def("setClipWindow", &GDSReader<T, D>::setClipWindow,
+           "Only import the part of the layout inside the window (xMin, yMin, "
+           "xMax, yMax).")
+      .def("apply", &GDSReader<T, D>::apply, "Parse the GDS file.")
+      .def("getThroughput", &GDSReader<T, D>::getThroughput,
+           "Parse throughput of the last file in MB/s.");
 #else
   // wrap a 3D domain in 2D mode to be used with psExtrude
   // Domain
@@ -57,8 +57,14 @@ class AtomicLayerProcess:
     @overload
     def __init__(self, domain: Domain, processModel: ProcessModel) -> None: ...
     def apply(self) -> None: ...
+    def disableAdaptiveRayTracing(self) -> None: ...
+    def enableAdaptiveRayTracing(self, targetError: float = ..., initialRaysPerPoint: int = ...) -> None: ...
+    def getTracedRaysPerStep(self) -> List[int]: ...
     def disableRandomSeeds(self) -> None: ...
     def enableRandomSeeds(self) -> None: ...
+    def setCheckpointFile(self, arg0: str) -> None: ...
+    def setCheckpointInterval(self, arg0: int) -> None: ...
+    def setCheckpointWallClockInterval(self, arg0: float) -> None: ...
     def setCoverageTimeStep(self, arg0: float) -> None: ...
     def setDesorptionRates(self, arg0: List[float]) -> None: ...
     def setDomain(self, arg0: Domain): ...
@@ -67,6 +73,7 @@ class AtomicLayerProcess:
     def setNumCycles(self, arg0: int) -> None: ...
     def setPulseTime(self, arg0: float) -> None: ...
     def setProcessModel(self, arg0: ProcessModel) -> None: ...
+    def setRestartFile(self, arg0: str) -> None: ...
     def setSourceDirection(self, arg0: rayTraceDirection) -> None: ...
 
 class BoxDistribution(ProcessModel):
@@ -148,6 +155,7 @@ class FluorocarbonEtching(ProcessModel):
     @overload
     def __init__(self, parameters: FluorocarbonParameters) -> None: ...
     def getParameters(self) -> FluorocarbonParameters: ...
+    def setIonEnergyAngleDistribution(self, distribution: IonEnergyAngleDistribution) -> None: ...
     def setParameters(self, arg0: FluorocarbonParameters) -> None: ...
 
 class FluorocarbonParameters:
@@ -226,22 +234,46 @@ class GDSGeometry:
     def __init__(self) -> None: ...
     @overload
     def __init__(self, gridDelta: float) -> None: ...
+    def clearClipWindow(self) -> None: ...
     def getBounds(self, *args, **kwargs): ...
     def layerToLevelSet(self, *args, **kwargs): ...
+    def layersToLevelSets(self, arg0: List[GDSLayerExtrusion]) -> list: ...
     def print(self) -> None: ...
     def setBoundaryConditions(self, arg0) -> None: ...
     def setBoundaryPadding(self, arg0: float, arg1: float) -> None: ...
+    def setClipWindow(self, arg0: float, arg1: float, arg2: float, arg3: float) -> None: ...
     def setGridDelta(self, arg0: float) -> None: ...
 
+class GDSLayerExtrusion:
+    baseHeight: float
+    height: float
+    layer: int
+    mask: bool
+    @overload
+    def __init__(self) -> None: ...
+    @overload
+    def __init__(self, layer: int, baseHeight: float, height: float, mask: bool = ...) -> None: ...
+
 class GDSReader:
     @overload
     def __init__(self) -> None: ...
     @overload
     def __init__(self, arg0: GDSGeometry, arg1: str) -> None: ...
     def apply(self) -> None: ...
+    def getThroughput(self) -> float: ...
+    def setClipWindow(self, arg0: float, arg1: float, arg2: float, arg3: float) -> None: ...
     def setFileName(self, arg0: str) -> None: ...
     def setGeometry(self, arg0: GDSGeometry) -> None: ...
 
+class IonEnergyAngleDistribution:
+    @overload
+    def __init__(self, energyEdges: List[float], angleEdges: List[float], weights: List[float]) -> None: ...
+    @overload
+    def __init__(self, fileName: str) -> None: ...
+    def getMeanEnergy(self) -> float: ...
+    def getNumberOfAngleBins(self) -> int: ...
+    def getNumberOfEnergyBins(self) -> int: ...
+
 class IsotropicProcess(ProcessModel):
     @overload
     def __init__(self, rate: float = ..., maskMaterial: Material = ...) -> None: ...
@@ -368,8 +400,20 @@ class MaterialMap:
 #     def setReflectionLimit(self, arg0: int) -> None: ...
 #     def setRngSeed(self, arg0: int) -> None: ...
 
+class MultiRateProcess(ProcessModel):
+    def __init__(self) -> None: ...
+    @overload
+    def addDirectionalRate(self, material: Material, direction, rate: float) -> None: ...
+    @overload
+    def addDirectionalRate(self, materials: List[Material], direction, rate: float) -> None: ...
+    @overload
+    def setIsotropicRate(self, material: Material, rate: float) -> None: ...
+    @overload
+    def setIsotropicRate(self, materials: List[Material], rate: float) -> None: ...
+
 class OxideRegrowth(ProcessModel):
     def __init__(self, nitrideEtchRate: float, oxideEtchRate: float, redepositionRate: float, redepositionThreshold: float, redepositionTimeInt: float, diffusionCoefficient: float, sinkStrength: float, scallopVelocity: float, centerVelocity: float, topHeight: float, centerWidth: float, stabilityFactor: float) -> None: ...
+    def setImplicitTimeStep(self, timeStep: float) -> None: ...
 
 class Particle:
     def __init__(self, *args, **kwargs) -> None: ...
@@ -400,6 +444,38 @@ class Planarize:
 #     name: str
 #     def __init__(self) -> None: ...
 
+class ProcessStepTelemetry:
+    def __init__(self) -> None: ...
+    @property
+    def advectionTime(self) -> float: ...
+    @property
+    def callbackTime(self) -> float: ...
+    @property
+    def extractionTime(self) -> float: ...
+    @property
+    def numSurfacePoints(self) -> int: ...
+    @property
+    def peakMemory(self) -> int: ...
+    @property
+    def processTime(self) -> float: ...
+    @property
+    def rayTracingTime(self) -> float: ...
+    @property
+    def raysPerParticle(self) -> List[int]: ...
+    @property
+    def step(self) -> int: ...
+    @property
+    def timeStep(self) -> float: ...
+    @property
+    def velocityTime(self) -> float: ...
+
+class ProcessTelemetry:
+    def __init__(self) -> None: ...
+    def getSteps(self) -> List[ProcessStepTelemetry]: ...
+    def writeCSV(self, arg0: str) -> bool: ...
+    def writeJSON(self, arg0: str) -> bool: ...
+    def __len__(self) -> int: ...
+
 class Process:
     @overload
     def __init__(self) -> None: ...
@@ -410,17 +486,34 @@ class Process:
     def setPrintTimeInterval(self, arg0: float): ...
     def apply(self) -> None: ...
     def calculateFlux(self): ...
+    def disableAdaptiveRayTracing(self) -> None: ...
+    def enableAdaptiveRayTracing(self, targetError: float = ..., initialRaysPerPoint: int = ...) -> None: ...
+    def getTelemetry(self) -> ProcessTelemetry: ...
+    def getTracedRaysPerStep(self) -> List[int]: ...
+    def disableConcurrentParticleTracing(self) -> None: ...
+    def enableConcurrentParticleTracing(self) -> None: ...
     def disableFluxSmoothing(self) -> None: ...
     def enableFluxSmoothing(self) -> None: ...
+    def disablePipelinedStepping(self) -> None: ...
+    def enablePipelinedStepping(self) -> None: ...
+    def disableAnalyticAdvection(self) -> None: ...
+    def enableAnalyticAdvection(self) -> None: ...
     def disableRandomSeeds(self) -> None: ...
     def enableRandomSeeds(self) -> None: ...
     def getProcessDuration(self) -> float: ...
+    def setCheckpointFile(self, arg0: str) -> None: ...
+    def setCheckpointInterval(self, arg0: float) -> None: ...
+    def setCheckpointWallClockInterval(self, arg0: float) -> None: ...
     def setDomain(self, arg0: Domain): ...
     def setIntegrationScheme(self, arg0: lsIntegrationSchemeEnum) -> None: ...
     def setMaxCoverageInitIterations(self, arg0: int) -> None: ...
+    def setCoverageConvergenceTolerance(self, arg0: float) -> None: ...
+    def setCoverageSeed(self, arg0) -> None: ...
+    def getCoverageMesh(self): ...
     def setNumberOfRaysPerPoint(self, arg0: int) -> None: ...
     def setProcessDuration(self, arg0: float) -> None: ...
     def setProcessModel(self, arg0: ProcessModel) -> None: ...
+    def setRestartFile(self, arg0: str) -> None: ...
     def setSourceDirection(self, arg0: rayTraceDirection) -> None: ...
     def setTimeStepRatio(self, arg0: float) -> None: ...
 
@@ -466,6 +559,7 @@ class SF6O2Etching(ProcessModel):
     @overload
     def __init__(self, parameters: SF6O2Parameters) -> None: ...
     def getParameters(self) -> SF6O2Parameters: ...
+    def setIonEnergyAngleDistribution(self, distribution: IonEnergyAngleDistribution) -> None: ...
     def setParameters(self, arg0: SF6O2Parameters) -> None: ...
 
 class SF6O2Parameters:
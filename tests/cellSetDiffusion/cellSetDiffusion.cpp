@@ -0,0 +1,59 @@
+#include <geometries/psMakePlane.hpp>
+#include <psCellSetDiffusion.hpp>
+#include <psDomain.hpp>
+
+#include <vcTestAsserts.hpp>
+
+#include <numeric>
+
+namespace viennacore {
+
+using namespace viennaps;
+
+template <class NumericType, int D> void RunTest() {
+  auto domain = SmartPointer<Domain<NumericType, D>>::New();
+  MakePlane<NumericType, D>(domain, 1., 10., 10., 0., false, Material::Si)
+      .apply();
+  domain->generateCellSet(4., Material::GAS, true);
+  auto cellSet = domain->getCellSet();
+  cellSet->buildNeighborhood();
+
+  CellSetDiffusion<NumericType, D> diffusion;
+  diffusion.update(cellSet, Material::GAS);
+  VC_TEST_ASSERT(diffusion.size() > 0);
+  for (std::size_t i = 0; i < diffusion.size(); ++i) {
+    VC_TEST_ASSERT(MaterialMap::isMaterial(
+        cellSet->getScalarData("Material")->at(diffusion.getCellIndex(i)),
+        Material::GAS));
+    for (const auto n : diffusion.getNeighbors(i))
+      VC_TEST_ASSERT(n < static_cast<int>(diffusion.size()));
+  }
+
+  // all byproducts start in one cell
+  std::vector<NumericType> data(cellSet->getNumberOfCells(), 0.);
+  data[diffusion.getCellIndex(diffusion.size() / 2)] = 1.;
+  diffusion.gather(data);
+  diffusion.setDiffusion(1.);
+
+  // diffusion conserves the mass for both time integrations
+  for (int i = 0; i < 10; ++i)
+    diffusion.explicitStep(0.1);
+  auto &solution = diffusion.getSolution();
+  NumericType mass =
+      std::accumulate(solution.begin(), solution.end(), NumericType(0.));
+  VC_TEST_ASSERT_ISCLOSE(mass, 1., 1e-5);
+  for (const auto value : solution)
+    VC_TEST_ASSERT(value >= 0.);
+
+  VC_TEST_ASSERT(diffusion.implicitStep(5.));
+  mass = std::accumulate(solution.begin(), solution.end(), NumericType(0.));
+  VC_TEST_ASSERT_ISCLOSE(mass, 1., 1e-4);
+
+  diffusion.scatter(data);
+  mass = std::accumulate(data.begin(), data.end(), NumericType(0.));
+  VC_TEST_ASSERT_ISCLOSE(mass, 1., 1e-4);
+}
+
+} // namespace viennacore
+
+int main() { VC_RUN_ALL_TESTS }
@@ -0,0 +1,255 @@
+#include <geometries/psMakePlane.hpp>
+#include <geometries/psMakeTrench.hpp>
+#include <models/psIsotropicProcess.hpp>
+#include <models/psSingleParticleALD.hpp>
+#include <psAtomicLayerProcess.hpp>
+#include <psCheckpoint.hpp>
+#include <psProcess.hpp>
+#include <psToDiskMesh.hpp>
+#include <vcTestAsserts.hpp>
+
+#include <cstdint>
+#include <limits>
+#include <sstream>
+
+namespace viennacore {
+
+using namespace viennaps;
+
+// Interrupts the process before the first step at or after the stop time.
+template <class NumericType, int D>
+class StopCallback : public AdvectionCallback<NumericType, D> {
+  const NumericType stopTime_;
+
+public:
+  explicit StopCallback(const NumericType stopTime) : stopTime_(stopTime) {}
+
+  bool applyPreAdvect(const NumericType processTime) override {
+    return processTime < stopTime_;
+  }
+};
+
+template <class NumericType, int D>
+std::vector<Vec3D<NumericType>>
+surfaceNodes(SmartPointer<Domain<NumericType, D>> domain) {
+  auto mesh = SmartPointer<viennals::Mesh<NumericType>>::New();
+  ToDiskMesh<NumericType, D>(domain, mesh).apply();
+  return mesh->getNodes();
+}
+
+template <class NumericType, int D>
+void compareSurfaces(SmartPointer<Domain<NumericType, D>> domain,
+                     SmartPointer<Domain<NumericType, D>> reference,
+                     const NumericType tolerance) {
+  const auto nodes = surfaceNodes(domain);
+  const auto refNodes = surfaceNodes(reference);
+  VC_TEST_ASSERT(!nodes.empty());
+  VC_TEST_ASSERT(nodes.size() == refNodes.size());
+  for (std::size_t i = 0; i < nodes.size(); ++i) {
+    for (int j = 0; j < D; ++j)
+      VC_TEST_ASSERT_ISCLOSE(nodes[i][j], refNodes[i][j], tolerance);
+  }
+}
+
+// An interrupted and resumed process ends with the same geometry as an
+// uninterrupted one.
+template <class NumericType, int D> void RunProcessRestartTest() {
+  const NumericType duration = 4.;
+  auto makeDomain = []() {
+    auto domain = SmartPointer<Domain<NumericType, D>>::New();
+    MakeTrench<NumericType, D>(domain, 1., 10., 10., 4., 2., 0., 0., false,
+                               true, Material::Si)
+        .apply();
+    return domain;
+  };
+  auto makeModel = [](const NumericType stopTime) {
+    auto model =
+        SmartPointer<IsotropicProcess<NumericType, D>>::New(-1., Material::Mask);
+    model->setAdvectionCallback(
+        SmartPointer<StopCallback<NumericType, D>>::New(stopTime));
+    return model;
+  };
+  const auto never = std::numeric_limits<NumericType>::max();
+
+  auto reference = makeDomain();
+  Process<NumericType, D>(reference, makeModel(never), duration).apply();
+
+  auto domain = makeDomain();
+  Process<NumericType, D> interrupted(domain, makeModel(1.5), duration);
+  interrupted.setCheckpointFile("processCheckpoint.ckpt");
+  interrupted.apply();
+  const auto stopTime = interrupted.getProcessDuration();
+  VC_TEST_ASSERT(stopTime >= 1.5 && stopTime < duration);
+
+  // resume in a new domain with the same Level-Sets
+  auto resumedDomain = makeDomain();
+  Process<NumericType, D> resumed(resumedDomain, makeModel(never), duration);
+  resumed.setRestartFile("processCheckpoint.ckpt");
+  resumed.setCheckpointFile("processFinal.ckpt");
+  resumed.apply();
+  VC_TEST_ASSERT_ISCLOSE(resumed.getProcessDuration(), duration, 1e-5);
+
+  auto scratch = makeDomain();
+  CheckpointState<NumericType> state;
+  VC_TEST_ASSERT(
+      (Checkpoint<NumericType, D>::read("processFinal.ckpt", scratch, state)));
+  VC_TEST_ASSERT_ISCLOSE(state.elapsedTime, duration, 1e-5);
+
+  compareSurfaces(resumedDomain, reference, NumericType(1e-4));
+}
+
+// An atomic layer process resumed after the first cycle ends with the same
+// layer as a process which runs all cycles at once.
+template <class NumericType, int D> void RunAtomicLayerRestartTest() {
+  const unsigned numCycles = 3;
+  auto makeDomain = []() {
+    auto domain = SmartPointer<Domain<NumericType, D>>::New();
+    MakePlane<NumericType, D>(domain, 0.5, 5., 5., 0., false, Material::Si)
+        .apply();
+    return domain;
+  };
+  auto runCycles = [](SmartPointer<Domain<NumericType, D>> domain,
+                      const unsigned cycles, const std::string &checkpoint,
+                      const std::string &restart) {
+    // the coverage saturates in the first coverage step, every cycle grows
+    // the same layer
+    auto model = SmartPointer<SingleParticleALD<NumericType, D>>::New(
+        0.1, 1, 0.2, 1, 0.01, 0., 1e6, 1., -1.);
+    AtomicLayerProcess<NumericType, D> process(domain, model);
+    process.setCoverageTimeStep(0.01);
+    process.setPulseTime(0.01);
+    process.setNumCycles(cycles);
+    process.setNumberOfRaysPerPoint(100);
+    process.disableRandomSeeds();
+    if (!checkpoint.empty())
+      process.setCheckpointFile(checkpoint);
+    if (!restart.empty())
+      process.setRestartFile(restart);
+    process.apply();
+  };
+
+  auto reference = makeDomain();
+  runCycles(reference, numCycles, "", "");
+
+  auto domain = makeDomain();
+  runCycles(domain, 1, "aldCheckpoint.ckpt", "");
+
+  auto resumedDomain = makeDomain();
+  runCycles(resumedDomain, numCycles, "aldFinal.ckpt", "aldCheckpoint.ckpt");
+
+  auto scratch = makeDomain();
+  CheckpointState<NumericType> state;
+  VC_TEST_ASSERT(
+      (Checkpoint<NumericType, D>::read("aldCheckpoint.ckpt", scratch, state)));
+  VC_TEST_ASSERT(state.counter == 1);
+  VC_TEST_ASSERT(
+      (Checkpoint<NumericType, D>::read("aldFinal.ckpt", scratch, state)));
+  VC_TEST_ASSERT(state.counter == numCycles);
+
+  compareSurfaces(resumedDomain, reference, NumericType(0.05 * 0.5));
+}
+
+template <class NumericType, int D> void RunTest() {
+  Logger::setLogLevel(LogLevel::WARNING);
+  auto domain = SmartPointer<Domain<NumericType, D>>::New();
+  MakePlane<NumericType, D>(domain, 0.5, 10., 10., 0., false, Material::Si)
+      .apply();
+  domain->duplicateTopLevelSet(Material::SiO2);
+
+  CheckpointState<NumericType> state;
+  state.processDuration = 10.;
+  state.elapsedTime = 4.;
+  state.previousTimeStep = 0.25;
+  state.counter = 3;
+  state.coveragesInitialized = true;
+  state.coverages = SmartPointer<viennals::PointData<NumericType>>::New();
+  state.coverages->insertNextScalarData(std::vector<NumericType>(2, 0.5),
+                                        "eCoverage");
+  state.particleDataLogs.resize(1);
+  state.particleDataLogs[0].data.push_back(std::vector<NumericType>(3, 1.));
+
+  std::stringstream stream;
+  Checkpoint<NumericType, D>::serialize(stream, domain, state);
+
+  // restore into a domain with the same number of Level-Sets
+  auto restored = SmartPointer<Domain<NumericType, D>>::New();
+  MakePlane<NumericType, D>(restored, 0.5, 10., 10., 0., false).apply();
+  restored->duplicateTopLevelSet();
+
+  using CheckpointType = Checkpoint<NumericType, D>;
+  CheckpointState<NumericType> restoredState;
+  VC_TEST_ASSERT(CheckpointType::deserialize(stream, restored, restoredState));
+
+  VC_TEST_ASSERT(restored->getLevelSets().size() == 2);
+  VC_TEST_ASSERT(restored->getLevelSets().back()->getNumberOfPoints() ==
+                 domain->getLevelSets().back()->getNumberOfPoints());
+  VC_TEST_ASSERT(restored->getMaterialMap());
+  VC_TEST_ASSERT(restored->getMaterialMap()->getMaterialAtIdx(0) ==
+                 Material::Si);
+  VC_TEST_ASSERT(restored->getMaterialMap()->getMaterialAtIdx(1) ==
+                 Material::SiO2);
+
+  VC_TEST_ASSERT(restoredState.processDuration == state.processDuration);
+  VC_TEST_ASSERT(restoredState.elapsedTime == state.elapsedTime);
+  VC_TEST_ASSERT(restoredState.previousTimeStep == state.previousTimeStep);
+  VC_TEST_ASSERT(restoredState.counter == state.counter);
+  VC_TEST_ASSERT(restoredState.coveragesInitialized);
+  VC_TEST_ASSERT(restoredState.coverages);
+  VC_TEST_ASSERT(restoredState.coverages->getScalarDataLabel(0) ==
+                 "eCoverage");
+  VC_TEST_ASSERT(restoredState.coverages->getScalarData(0)->size() == 2);
+  VC_TEST_ASSERT(restoredState.particleDataLogs.size() == 1);
+  VC_TEST_ASSERT(restoredState.particleDataLogs[0].data[0].size() == 3);
+
+  // a domain with a different number of Level-Sets is rejected
+  std::stringstream stream2;
+  CheckpointType::serialize(stream2, domain, state);
+  auto mismatch = SmartPointer<Domain<NumericType, D>>::New();
+  MakePlane<NumericType, D>(mismatch, 0.5, 10., 10., 0., false).apply();
+  VC_TEST_ASSERT(!CheckpointType::deserialize(stream2, mismatch, state));
+
+  // invalid checkpoints leave the domain and the state unchanged
+  std::stringstream stream3;
+  CheckpointType::serialize(stream3, domain, state);
+  const auto buffer = stream3.str();
+  auto checkRejected = [&](const std::string &data) {
+    auto target = SmartPointer<Domain<NumericType, D>>::New();
+    MakePlane<NumericType, D>(target, 0.5, 10., 10., 0., false,
+                              Material::Mask)
+        .apply();
+    target->duplicateTopLevelSet(Material::Polymer);
+    CheckpointState<NumericType> targetState;
+    targetState.counter = 42;
+    std::stringstream input(data);
+    VC_TEST_ASSERT(!CheckpointType::deserialize(input, target, targetState));
+    VC_TEST_ASSERT(target->getMaterialMap()->getMaterialAtIdx(0) ==
+                   Material::Mask);
+    VC_TEST_ASSERT(target->getMaterialMap()->getMaterialAtIdx(1) ==
+                   Material::Polymer);
+    VC_TEST_ASSERT(targetState.counter == 42);
+    VC_TEST_ASSERT(!targetState.coverages);
+  };
+
+  // wrong identifier
+  auto corrupt = buffer;
+  corrupt[0] = 'x';
+  checkRejected(corrupt);
+
+  // truncated file
+  checkRejected(buffer.substr(0, buffer.size() - 1));
+
+  // the size of the last data log vector exceeds the file
+  corrupt = buffer;
+  const auto sizeOffset =
+      buffer.size() - 3 * sizeof(NumericType) - sizeof(std::uint64_t);
+  for (std::size_t i = 0; i < sizeof(std::uint64_t); ++i)
+    corrupt[sizeOffset + i] = static_cast<char>(0xff);
+  checkRejected(corrupt);
+
+  RunProcessRestartTest<NumericType, D>();
+  RunAtomicLayerRestartTest<NumericType, D>();
+}
+
+} // namespace viennacore
+
+int main() { VC_RUN_ALL_TESTS }
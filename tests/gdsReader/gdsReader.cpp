@@ -1,10 +1,148 @@
 #include <psGDSReader.hpp>
 #include <vcTestAsserts.hpp>
 
+#include <cmath>
+#include <fstream>
+#include <limits>
+
 namespace viennacore {
 
 using namespace viennaps;
 
+void writeRecord(std::ofstream &file, unsigned char recordType,
+                 unsigned char dataType,
+                 const std::vector<unsigned char> &payload = {}) {
+  const auto length = static_cast<uint16_t>(payload.size() + 4);
+  const unsigned char header[4] = {static_cast<unsigned char>(length >> 8),
+                                   static_cast<unsigned char>(length & 0xff),
+                                   recordType, dataType};
+  file.write(reinterpret_cast<const char *>(header), 4);
+  file.write(reinterpret_cast<const char *>(payload.data()), payload.size());
+}
+
+void appendInt32(std::vector<unsigned char> &bytes, int32_t value) {
+  for (int shift = 24; shift >= 0; shift -= 8)
+    bytes.push_back(static_cast<unsigned char>((value >> shift) & 0xff));
+}
+
+// One structure with a square of 1 um side length. The first vertex is
+// repeated in the middle of the polygon.
+void writeTestFile(const std::string &fileName) {
+  std::ofstream file(fileName, std::ios::binary);
+  writeRecord(file, 0x00, 0x02, {0x02, 0x58}); // HEADER
+  writeRecord(file, 0x01, 0x02, std::vector<unsigned char>(24, 0));
+  writeRecord(file, 0x02, 0x06, {'L', 'I', 'B', 0});
+  // UNITS: 1e-3 user units, 1e-9 m database units
+  writeRecord(file, 0x03, 0x05,
+              {0x3e, 0x41, 0x89, 0x37, 0x4b, 0xc6, 0xa7, 0xf0, 0x39, 0x44,
+               0xb8, 0x2f, 0xa0, 0x9b, 0x5a, 0x54});
+  writeRecord(file, 0x05, 0x02, std::vector<unsigned char>(24, 0));
+  writeRecord(file, 0x06, 0x06, {'T', 'O', 'P', 0});
+  writeRecord(file, 0x08, 0x00);             // BOUNDARY
+  writeRecord(file, 0x0D, 0x02, {0x00, 0x01}); // LAYER
+  writeRecord(file, 0x0E, 0x02, {0x00, 0x00}); // DATATYPE
+  std::vector<unsigned char> xy;
+  for (const auto &p : std::vector<std::array<int32_t, 2>>{
+           {0, 0}, {1000, 0}, {0, 0}, {1000, 1000}, {0, 1000}, {0, 0}}) {
+    appendInt32(xy, p[0]);
+    appendInt32(xy, p[1]);
+  }
+  writeRecord(file, 0x10, 0x03, xy); // XY
+  writeRecord(file, 0x11, 0x00);     // ENDEL
+  writeRecord(file, 0x07, 0x00);     // ENDSTR
+  writeRecord(file, 0x04, 0x00);     // ENDLIB
+}
+
+void writeReference(std::ofstream &file, bool array, const std::string &name,
+                    const std::vector<std::array<int32_t, 2>> &points,
+                    int16_t cols = 1, int16_t rows = 1) {
+  writeRecord(file, array ? 0x0B : 0x0A, 0x00); // AREF or SREF
+  std::vector<unsigned char> sname(name.begin(), name.end());
+  if (sname.size() % 2)
+    sname.push_back(0);
+  writeRecord(file, 0x12, 0x06, sname); // SNAME
+  if (array) {
+    writeRecord(file, 0x13, 0x02,
+                {0x00, static_cast<unsigned char>(cols), 0x00,
+                 static_cast<unsigned char>(rows)}); // COLROW
+  }
+  std::vector<unsigned char> xy;
+  for (const auto &p : points) {
+    appendInt32(xy, p[0]);
+    appendInt32(xy, p[1]);
+  }
+  writeRecord(file, 0x10, 0x03, xy); // XY
+  writeRecord(file, 0x11, 0x00);     // ENDEL
+}
+
+// A 2x3 array of rows, each row references the square cell twice.
+void writeHierarchyTestFile(const std::string &fileName) {
+  std::ofstream file(fileName, std::ios::binary);
+  writeRecord(file, 0x00, 0x02, {0x02, 0x58}); // HEADER
+  writeRecord(file, 0x01, 0x02, std::vector<unsigned char>(24, 0));
+  writeRecord(file, 0x02, 0x06, {'L', 'I', 'B', 0});
+  writeRecord(file, 0x03, 0x05,
+              {0x3e, 0x41, 0x89, 0x37, 0x4b, 0xc6, 0xa7, 0xf0, 0x39, 0x44,
+               0xb8, 0x2f, 0xa0, 0x9b, 0x5a, 0x54});
+
+  writeRecord(file, 0x05, 0x02, std::vector<unsigned char>(24, 0));
+  writeRecord(file, 0x06, 0x06, {'T', 'O', 'P', 0});
+  writeReference(file, true, "ROW", {{0, 0}, {8000, 0}, {0, 6000}}, 2, 3);
+  writeRecord(file, 0x07, 0x00); // ENDSTR
+
+  writeRecord(file, 0x05, 0x02, std::vector<unsigned char>(24, 0));
+  writeRecord(file, 0x06, 0x06, {'R', 'O', 'W', 0});
+  writeReference(file, false, "CELL", {{0, 0}});
+  writeReference(file, false, "CELL", {{2000, 0}});
+  writeRecord(file, 0x07, 0x00); // ENDSTR
+
+  writeRecord(file, 0x05, 0x02, std::vector<unsigned char>(24, 0));
+  writeRecord(file, 0x06, 0x06, {'C', 'E', 'L', 'L'});
+  writeRecord(file, 0x08, 0x00);               // BOUNDARY
+  writeRecord(file, 0x0D, 0x02, {0x00, 0x01}); // LAYER
+  writeRecord(file, 0x0E, 0x02, {0x00, 0x00}); // DATATYPE
+  std::vector<unsigned char> xy;
+  for (const auto &p : std::vector<std::array<int32_t, 2>>{
+           {0, 0}, {1000, 0}, {1000, 1000}, {0, 1000}, {0, 0}}) {
+    appendInt32(xy, p[0]);
+    appendInt32(xy, p[1]);
+  }
+  writeRecord(file, 0x10, 0x03, xy); // XY
+  writeRecord(file, 0x11, 0x00);     // ENDEL
+  writeRecord(file, 0x07, 0x00);     // ENDSTR
+  writeRecord(file, 0x04, 0x00);     // ENDLIB
+}
+
+template <class NumericType, int D>
+std::array<NumericType, 4>
+surfaceExtent(SmartPointer<viennals::Domain<NumericType, D>> levelSet) {
+  auto mesh = SmartPointer<viennals::Mesh<NumericType>>::New();
+  viennals::ToSurfaceMesh<NumericType, D>(levelSet, mesh).apply();
+  const auto max = std::numeric_limits<NumericType>::max();
+  std::array<NumericType, 4> extent = {max, max, -max, -max};
+  for (const auto &node : mesh->getNodes()) {
+    extent[0] = std::min(extent[0], node[0]);
+    extent[1] = std::min(extent[1], node[1]);
+    extent[2] = std::max(extent[2], node[0]);
+    extent[3] = std::max(extent[3], node[1]);
+  }
+  return extent;
+}
+
+// Negative level set values are inside the material.
+template <class NumericType, int D>
+bool isInside(SmartPointer<viennals::Domain<NumericType, D>> levelSet,
+              const std::array<NumericType, 3> &point) {
+  const auto gridDelta = levelSet->getGrid().getGridDelta();
+  hrleVectorType<hrleIndexType, D> index;
+  for (int i = 0; i < D; ++i)
+    index[i] = static_cast<hrleIndexType>(std::round(point[i] / gridDelta));
+  hrleConstSparseIterator<typename viennals::Domain<NumericType, D>::DomainType>
+      it(levelSet->getDomain());
+  it.goToIndices(index);
+  return it.getValue() < 0.;
+}
+
 template <class NumericType, int D> void RunTest() {
   const NumericType gridDelta = 0.01;
   viennals::BoundaryConditionEnum<D> boundaryConditions[D] = {
@@ -14,6 +152,69 @@ template <class NumericType, int D> void RunTest() {
   auto mask = SmartPointer<GDSGeometry<NumericType, D>>::New(gridDelta);
   mask->setBoundaryConditions(boundaryConditions);
   GDSReader<NumericType, D> reader(mask, "mask.gds");
+
+  writeTestFile("gdsReaderTest.gds");
+  auto geometry = SmartPointer<GDSGeometry<NumericType, D>>::New(gridDelta);
+  GDSReader<NumericType, D>(geometry, "gdsReaderTest.gds").apply();
+  const auto boundingBox = geometry->getBoundingBox();
+  VC_TEST_ASSERT_ISCLOSE(boundingBox[0][0], 0., 1e-6);
+  VC_TEST_ASSERT_ISCLOSE(boundingBox[0][1], 0., 1e-6);
+  VC_TEST_ASSERT_ISCLOSE(boundingBox[1][0], 1., 1e-6);
+  VC_TEST_ASSERT_ISCLOSE(boundingBox[1][1], 1., 1e-6);
+
+  // the batch extraction gives the same level sets as single layers
+  auto single = geometry->layerToLevelSet(1, 0., 0.1);
+  auto batch = geometry->layersToLevelSets({{1, 0., 0.1}, {2, 0., 0.1}});
+  VC_TEST_ASSERT(batch.size() == 2);
+  VC_TEST_ASSERT(single->getNumberOfPoints() > 0);
+  VC_TEST_ASSERT(batch[0]->getNumberOfPoints() ==
+                 single->getNumberOfPoints());
+  VC_TEST_ASSERT(batch[1]->getNumberOfPoints() == 0);
+
+  // array and nested references are instanced
+  writeHierarchyTestFile("gdsHierarchyTest.gds");
+  auto hierarchy = SmartPointer<GDSGeometry<NumericType, D>>::New(gridDelta);
+  GDSReader<NumericType, D>(hierarchy, "gdsHierarchyTest.gds").apply();
+  const auto hierarchyBox = hierarchy->getBoundingBox();
+  VC_TEST_ASSERT_ISCLOSE(hierarchyBox[0][0], 0., 1e-6);
+  VC_TEST_ASSERT_ISCLOSE(hierarchyBox[0][1], 0., 1e-6);
+  VC_TEST_ASSERT_ISCLOSE(hierarchyBox[1][0], 7., 1e-6);
+  VC_TEST_ASSERT_ISCLOSE(hierarchyBox[1][1], 5., 1e-6);
+  auto hierarchyLayer = hierarchy->layerToLevelSet(1, 0., 0.1);
+  const auto hierarchyExtent = surfaceExtent(hierarchyLayer);
+  VC_TEST_ASSERT_ISCLOSE(hierarchyExtent[0], 0., 2 * gridDelta);
+  VC_TEST_ASSERT_ISCLOSE(hierarchyExtent[1], 0., 2 * gridDelta);
+  VC_TEST_ASSERT_ISCLOSE(hierarchyExtent[2], 7., 2 * gridDelta);
+  VC_TEST_ASSERT_ISCLOSE(hierarchyExtent[3], 5., 2 * gridDelta);
+  // first and last instance, and the gap between the cells of a row
+  VC_TEST_ASSERT(isInside(hierarchyLayer, {0.5, 0.5, 0.05}));
+  VC_TEST_ASSERT(isInside(hierarchyLayer, {6.5, 4.5, 0.05}));
+  VC_TEST_ASSERT(!isInside(hierarchyLayer, {1.5, 0.5, 0.05}));
+
+  // only the cells inside the clip window are imported and the domain
+  // follows the window
+  auto clipped = SmartPointer<GDSGeometry<NumericType, D>>::New(gridDelta);
+  clipped->setBoundaryPadding(0.5, 0.5);
+  GDSReader<NumericType, D> clipReader(clipped, "gdsHierarchyTest.gds");
+  clipReader.setClipWindow(1.5, -1., 4., 1.5);
+  clipReader.apply();
+  const auto clippedBox = clipped->getBoundingBox();
+  VC_TEST_ASSERT_ISCLOSE(clippedBox[0][0], 1.5, 1e-6);
+  VC_TEST_ASSERT_ISCLOSE(clippedBox[0][1], 0., 1e-6);
+  VC_TEST_ASSERT_ISCLOSE(clippedBox[1][0], 4., 1e-6);
+  VC_TEST_ASSERT_ISCLOSE(clippedBox[1][1], 1.5, 1e-6);
+  const auto clippedBounds = clipped->getBounds();
+  VC_TEST_ASSERT_ISCLOSE(clippedBounds[0], 1., 1e-6);
+  VC_TEST_ASSERT_ISCLOSE(clippedBounds[1], 4.5, 1e-6);
+  VC_TEST_ASSERT_ISCLOSE(clippedBounds[2], -1.5, 1e-6);
+  VC_TEST_ASSERT_ISCLOSE(clippedBounds[3], 2., 1e-6);
+  auto clippedLayer = clipped->layerToLevelSet(1, 0., 0.1);
+  const auto clippedExtent = surfaceExtent(clippedLayer);
+  VC_TEST_ASSERT_ISCLOSE(clippedExtent[0], 2., 2 * gridDelta);
+  VC_TEST_ASSERT_ISCLOSE(clippedExtent[1], 0., 2 * gridDelta);
+  VC_TEST_ASSERT_ISCLOSE(clippedExtent[3], 1., 2 * gridDelta);
+  VC_TEST_ASSERT(isInside(clippedLayer, {2.5, 0.5, 0.05}));
+  VC_TEST_ASSERT(!isInside(clippedLayer, {2.5, 1.8, 0.05}));
 }
 
 } // namespace viennacore
@@ -0,0 +1,156 @@
+#include <geometries/psMakePlane.hpp>
+#include <models/psIonBeamEtching.hpp>
+#include <psIonEnergyAngleDistribution.hpp>
+#include <psProcess.hpp>
+#include <psToDiskMesh.hpp>
+
+#include <vcTestAsserts.hpp>
+
+#include <numeric>
+
+namespace viennacore {
+
+using namespace viennaps;
+
+// Mean ion flux on a plane for ions which all have the given energy and hit
+// the plane perpendicularly.
+template <class NumericType, int D>
+NumericType meanIonFlux(const NumericType energy) {
+  auto domain = SmartPointer<Domain<NumericType, D>>::New();
+  MakePlane<NumericType, D>(domain, 1., 10., 10., 0., false, Material::Si)
+      .apply();
+
+  // a single bin IEAD
+  auto distribution =
+      SmartPointer<IonEnergyAngleDistribution<NumericType>>::New(
+          std::vector<NumericType>{energy, energy},
+          std::vector<NumericType>{0., 0.}, std::vector<NumericType>{1.});
+  auto model = SmartPointer<IonBeamEtching<NumericType, D>>::New();
+  model->setIonEnergyAngleDistribution(distribution);
+
+  Process<NumericType, D> process(domain, model, 0.);
+  process.setNumberOfRaysPerPoint(1000);
+  process.disableFluxSmoothing();
+  process.disableRandomSeeds();
+  auto mesh = process.calculateFlux();
+  const auto &flux = *mesh->getCellData().getScalarData("ionFlux");
+  VC_TEST_ASSERT(!flux.empty());
+  return std::accumulate(flux.begin(), flux.end(), NumericType(0.)) /
+         flux.size();
+}
+
+// The energy sampled by the source reaches the ions when they hit the
+// surface. Every ion hits the plane exactly once and contributes
+// sqrt(E) - sqrt(E_threshold) to the flux, while reflected ions leave the
+// domain. The rays are traced on all threads.
+template <class NumericType, int D> void RunTracingTest() {
+  const NumericType sqrtThreshold =
+      std::sqrt(IBEParameters<NumericType>().thresholdEnergy);
+  const auto fluxLow = meanIonFlux<NumericType, D>(100.);
+  const auto fluxHigh = meanIonFlux<NumericType, D>(200.);
+  VC_TEST_ASSERT(fluxLow > 0.);
+  VC_TEST_ASSERT_ISCLOSE(fluxHigh / fluxLow,
+                         (std::sqrt(NumericType(200.)) - sqrtThreshold) /
+                             (std::sqrt(NumericType(100.)) - sqrtThreshold),
+                         0.01);
+
+  // ions below the threshold energy do not etch, while the default Gaussian
+  // energy distribution would
+  const auto fluxBelowThreshold = meanIonFlux<NumericType, D>(10.);
+  VC_TEST_ASSERT(fluxBelowThreshold == 0.);
+}
+
+// The etch rate of a flat wafer is the plane wafer rate also with an IEAD
+// whose mean energy differs from the energy in the parameters.
+template <class NumericType, int D> void RunPlaneWaferRateTest() {
+  const NumericType gridDelta = 0.5;
+  auto domain = SmartPointer<Domain<NumericType, D>>::New();
+  MakePlane<NumericType, D>(domain, gridDelta, 10., 10., 0., false,
+                            Material::Si)
+      .apply();
+
+  auto distribution =
+      SmartPointer<IonEnergyAngleDistribution<NumericType>>::New(
+          std::vector<NumericType>{100., 100.},
+          std::vector<NumericType>{0., 0.}, std::vector<NumericType>{1.});
+  auto model = SmartPointer<IonBeamEtching<NumericType, D>>::New();
+  VC_TEST_ASSERT(model->getParameters().meanEnergy != 100.);
+  model->setIonEnergyAngleDistribution(distribution);
+
+  const NumericType duration = 2.;
+  Process<NumericType, D> process(domain, model, duration);
+  process.setNumberOfRaysPerPoint(1000);
+  process.disableRandomSeeds();
+  process.apply();
+
+  auto mesh = SmartPointer<viennals::Mesh<NumericType>>::New();
+  ToDiskMesh<NumericType, D>(domain, mesh).apply();
+  const auto &nodes = mesh->getNodes();
+  VC_TEST_ASSERT(!nodes.empty());
+  NumericType height = 0.;
+  for (const auto &node : nodes)
+    height += node[D - 1];
+  height /= nodes.size();
+  const auto rate = IBEParameters<NumericType>().planeWaferRate;
+  VC_TEST_ASSERT_ISCLOSE(height, -rate * duration, 0.05 * rate * duration);
+}
+
+template <class NumericType, int D> void RunTest() {
+  // two energy bins (eV) and two angle bins (degree)
+  auto distribution =
+      SmartPointer<IonEnergyAngleDistribution<NumericType>>::New(
+          std::vector<NumericType>{50., 100., 150.},
+          std::vector<NumericType>{0., 10., 30.},
+          std::vector<NumericType>{1., 0., 0., 3.});
+  VC_TEST_ASSERT(distribution->getNumberOfEnergyBins() == 2);
+  VC_TEST_ASSERT(distribution->getNumberOfAngleBins() == 2);
+  VC_TEST_ASSERT_ISCLOSE(distribution->getMeanEnergy(), 112.5, 1e-4);
+
+  // only the bins with a weight are sampled, with the frequency of the weight
+  RNG rngState(42);
+  const int numSamples = 100000;
+  int numLow = 0;
+  for (int i = 0; i < numSamples; ++i) {
+    const auto sample = distribution->sample(rngState);
+    if (sample.energy < 100.) {
+      VC_TEST_ASSERT(sample.energy >= 50.);
+      VC_TEST_ASSERT(sample.angle <= 10. * M_PI / 180. + 1e-6);
+      ++numLow;
+    } else {
+      VC_TEST_ASSERT(sample.energy <= 150.);
+      VC_TEST_ASSERT(sample.angle >= 10. * M_PI / 180. - 1e-6);
+      VC_TEST_ASSERT(sample.angle <= 30. * M_PI / 180. + 1e-6);
+    }
+  }
+  VC_TEST_ASSERT_ISCLOSE(NumericType(numLow) / numSamples, 0.25, 0.01);
+
+  // the samples only depend on the seed
+  RNG rngA(1), rngB(1);
+  for (int i = 0; i < 10; ++i) {
+    const auto a = distribution->sample(rngA);
+    const auto b = distribution->sample(rngB);
+    VC_TEST_ASSERT(a.energy == b.energy && a.angle == b.angle);
+  }
+
+  // the rays start above the surface and point towards it
+  IEADSource<NumericType, D> source(distribution);
+  std::vector<Vec3D<NumericType>> points = {{0., 0., 0.}, {4., 4., 1.}};
+  source.setGeometry(points, 1.,
+                     D == 2 ? viennaray::TraceDirection::POS_Y
+                            : viennaray::TraceDirection::POS_Z);
+  for (int i = 0; i < 100; ++i) {
+    const auto ray = source.getOriginAndDirection(i, rngState);
+    VC_TEST_ASSERT(ray[0][D - 1] > points[1][D - 1]);
+    VC_TEST_ASSERT(ray[1][D - 1] < 0.);
+    VC_TEST_ASSERT_ISCLOSE(Norm(ray[1]), 1., 1e-5);
+  }
+  VC_TEST_ASSERT_ISCLOSE(source.getSourceArea(), D == 2 ? 4. : 16., 1e-5);
+
+  Logger::setLogLevel(LogLevel::WARNING);
+  RunTracingTest<NumericType, D>();
+  RunPlaneWaferRateTest<NumericType, D>();
+}
+
+} // namespace viennacore
+
+int main() { VC_RUN_ALL_TESTS }
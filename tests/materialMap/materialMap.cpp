@@ -32,5 +32,25 @@ int main() {
   assert(MaterialMap::isMaterial(1, Material::Si));
   assert(!MaterialMap::isMaterial(1, Material::SiO2));
 
+  // MaterialTable test
+  MaterialTable<double> table(1.);
+  table.set(Material::Si, 2.);
+  assert(table[Material::Si] == 2.);
+  assert(table.lookup(1.) == 2.);
+  assert(table.lookup(2) == 1.);
+  assert(table.atIndex(MaterialMap::getIndex(1.)) == 2.);
+
+  // MaterialMask test
+  MaterialMask mask{Material::Mask, Material::SiO2};
+  assert(mask.contains(Material::Mask));
+  assert(mask.test(2.));
+  assert(!mask.test(1));
+  // unknown IDs are treated as Material::None
+  assert(!mask.test(42));
+  mask.insert(Material::None);
+  assert(mask.test(42));
+  mask.erase(Material::Mask);
+  assert(!mask.test(0));
+
   return 0;
 }
\ No newline at end of file
@@ -0,0 +1,111 @@
+#include <geometries/psMakeTrench.hpp>
+#include <models/psMultiRateProcess.hpp>
+
+#include <psDomain.hpp>
+#include <psProcess.hpp>
+#include <psToDiskMesh.hpp>
+
+#include <lsTestAsserts.hpp>
+#include <vcTestAsserts.hpp>
+
+namespace viennacore {
+
+using namespace viennaps;
+
+// A surface model derived from the base class, which has to be called in
+// every time step.
+template <class NumericType>
+class CountingSurfaceModel : public SurfaceModel<NumericType> {
+public:
+  unsigned calls = 0;
+
+  SmartPointer<std::vector<NumericType>>
+  calculateVelocities(SmartPointer<viennals::PointData<NumericType>>,
+                      const std::vector<Vec3D<NumericType>> &,
+                      const std::vector<NumericType> &) override {
+    ++calls;
+    return nullptr;
+  }
+};
+
+template <class NumericType, int D>
+SmartPointer<Domain<NumericType, D>> makeDomain() {
+  auto domain = SmartPointer<Domain<NumericType, D>>::New();
+  MakeTrench<NumericType, D>(domain, 1., 10., 10., 2.5, 5., 10., 1., false,
+                             true, Material::Si)
+      .apply();
+  return domain;
+}
+
+template <class NumericType, int D>
+std::vector<Vec3D<NumericType>>
+surfaceNodes(SmartPointer<Domain<NumericType, D>> domain) {
+  auto mesh = SmartPointer<viennals::Mesh<NumericType>>::New();
+  ToDiskMesh<NumericType, D>(domain, mesh).apply();
+  return mesh->getNodes();
+}
+
+template <class NumericType, int D> void RunTest() {
+  Logger::setLogLevel(LogLevel::WARNING);
+
+  auto domain = makeDomain<NumericType, D>();
+
+  auto model = SmartPointer<MultiRateProcess<NumericType, D>>::New();
+  model->setIsotropicRate(Material::Si, -0.5);
+  Vec3D<NumericType> direction{0., 0., 0.};
+  direction[D - 1] = -1.;
+  model->addDirectionalRate(Material::Si, direction, 1.);
+
+  VC_TEST_ASSERT(model->getSurfaceModel());
+  VC_TEST_ASSERT(model->getVelocityField());
+  VC_TEST_ASSERT(model->getVelocityField()->getTranslationFieldOptions() == 0);
+  VC_TEST_ASSERT(model->getVelocityField()->getScalarVelocity(
+                     {}, static_cast<int>(Material::Si), {}, 0) == -0.5);
+  VC_TEST_ASSERT(model->getVelocityField()->getScalarVelocity(
+                     {}, static_cast<int>(Material::Mask), {}, 0) == 0.);
+  VC_TEST_ASSERT(model->getVelocityField()->getVectorVelocity(
+                     {}, static_cast<int>(Material::Si), {}, 0)[D - 1] == -1.);
+
+  Process<NumericType, D> process(domain, model, 2.);
+  process.apply();
+
+  // analytic models are advected without extracting the surface
+  VC_TEST_ASSERT(!process.getTelemetry().empty());
+  for (const auto &step : process.getTelemetry().getSteps())
+    VC_TEST_ASSERT(step.numSurfacePoints == 0);
+  VC_TEST_ASSERT(std::abs(process.getProcessDuration() - 2.) < 1e-6);
+
+  VC_TEST_ASSERT(domain->getLevelSets().size() == 2);
+  LSTEST_ASSERT_VALID_LS(domain->getLevelSets().back(), NumericType, D);
+
+  // the full process loop results in the same geometry
+  auto reference = makeDomain<NumericType, D>();
+  Process<NumericType, D> fullProcess(reference, model, 2.);
+  fullProcess.disableAnalyticAdvection();
+  fullProcess.apply();
+  VC_TEST_ASSERT(!fullProcess.getTelemetry().empty());
+  for (const auto &step : fullProcess.getTelemetry().getSteps())
+    VC_TEST_ASSERT(step.numSurfacePoints > 0);
+
+  const auto nodes = surfaceNodes(domain);
+  const auto refNodes = surfaceNodes(reference);
+  VC_TEST_ASSERT(!nodes.empty());
+  VC_TEST_ASSERT(nodes.size() == refNodes.size());
+  for (std::size_t i = 0; i < nodes.size(); ++i) {
+    for (int j = 0; j < D; ++j)
+      VC_TEST_ASSERT_ISCLOSE(nodes[i][j], refNodes[i][j], 1e-6);
+  }
+
+  // derived surface models are never skipped
+  auto surfaceModel = SmartPointer<CountingSurfaceModel<NumericType>>::New();
+  model->setSurfaceModel(surfaceModel);
+  auto derived = makeDomain<NumericType, D>();
+  Process<NumericType, D> derivedProcess(derived, model, 2.);
+  derivedProcess.apply();
+  VC_TEST_ASSERT(surfaceModel->calls > 0);
+  VC_TEST_ASSERT(surfaceModel->calls == derivedProcess.getTelemetry().size());
+}
+
+} // namespace viennacore
+
+int main() { VC_RUN_ALL_TESTS }
@@ -0,0 +1,56 @@
+#include <psPointGrid.hpp>
+
+#include <vcTestAsserts.hpp>
+
+#include <random>
+
+namespace viennacore {
+
+using namespace viennaps;
+
+template <class NumericType, int D> void RunTest() {
+  std::mt19937 rng(42);
+  std::uniform_real_distribution<NumericType> uniform(-1., 1.);
+  auto randomPoint = [&]() {
+    Vec3D<NumericType> point{0., 0., 0.};
+    for (int i = 0; i < D; ++i)
+      point[i] = uniform(rng);
+    return point;
+  };
+
+  PointGrid<NumericType> grid;
+  grid.build({}, 0.1);
+  VC_TEST_ASSERT(grid.empty());
+  VC_TEST_ASSERT(grid.findNearest({0., 0., 0.}) ==
+                 PointGrid<NumericType>::invalidId);
+
+  std::vector<Vec3D<NumericType>> points(1000);
+  for (auto &point : points)
+    point = randomPoint();
+  grid.build(points, 0.1);
+  VC_TEST_ASSERT(grid.size() == points.size());
+
+  // compare with a brute force search, also for points outside of the grid
+  for (int q = 0; q < 200; ++q) {
+    auto query = randomPoint();
+    if (q % 10 == 0)
+      query[0] *= 3.;
+
+    std::size_t nearest = 0;
+    NumericType minDistance = std::numeric_limits<NumericType>::max();
+    for (std::size_t i = 0; i < points.size(); ++i) {
+      NumericType distance = 0.;
+      for (int j = 0; j < 3; ++j)
+        distance += (points[i][j] - query[j]) * (points[i][j] - query[j]);
+      if (distance < minDistance) {
+        minDistance = distance;
+        nearest = i;
+      }
+    }
+    VC_TEST_ASSERT(grid.findNearest(query) == nearest);
+  }
+}
+
+} // namespace viennacore
+
+int main() { VC_RUN_ALL_TESTS }
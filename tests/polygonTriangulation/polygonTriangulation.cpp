@@ -0,0 +1,98 @@
+#include <psPolygonTriangulation.hpp>
+
+#include <vcTestAsserts.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace viennacore {
+
+using namespace viennaps;
+
+template <class NumericType>
+NumericType
+signedArea(const std::vector<std::array<NumericType, 2>> &points) {
+  NumericType area = 0.;
+  for (std::size_t i = 0; i < points.size(); ++i) {
+    const auto &a = points[i];
+    const auto &b = points[(i + 1) % points.size()];
+    area += a[0] * b[1] - b[0] * a[1];
+  }
+  return area / 2;
+}
+
+// All triangles have to be counterclockwise and cover the area of the
+// polygon, a polygon with n points and h holes has n + 2h - 2 triangles.
+template <class NumericType>
+void checkTriangulation(
+    std::vector<std::array<NumericType, 2>> boundary,
+    const std::vector<std::vector<std::array<NumericType, 2>>> &holes = {}) {
+  impl::PolygonTriangulation<NumericType> triangulation(boundary);
+  auto points = boundary;
+  NumericType area = std::abs(signedArea(boundary));
+  for (const auto &hole : holes) {
+    triangulation.addHole(hole);
+    points.insert(points.end(), hole.begin(), hole.end());
+    area -= std::abs(signedArea(hole));
+  }
+  VC_TEST_ASSERT(triangulation.apply());
+
+  const auto &triangles = triangulation.getTriangles();
+  VC_TEST_ASSERT(triangles.size() == points.size() + 2 * holes.size() - 2);
+  NumericType triangleArea = 0.;
+  for (const auto &t : triangles) {
+    const auto a = signedArea<NumericType>({points[t[0]], points[t[1]],
+                                            points[t[2]]});
+    VC_TEST_ASSERT(a >= 0.);
+    triangleArea += a;
+  }
+  VC_TEST_ASSERT_ISCLOSE(triangleArea, area, 1e-4 * area);
+}
+
+template <class NumericType, int D> void RunTest() {
+  using Point = std::array<NumericType, 2>;
+
+  // L-shape in both orientations
+  std::vector<Point> lShape = {{0., 0.}, {2., 0.}, {2., 1.},
+                               {1., 1.}, {1., 2.}, {0., 2.}};
+  checkTriangulation(lShape);
+  std::reverse(lShape.begin(), lShape.end());
+  checkTriangulation(lShape);
+  VC_TEST_ASSERT(!impl::PolygonTriangulation<NumericType>(lShape)
+                      .isCounterClockwise());
+
+  // comb with split and merge vertices and collinear points
+  std::vector<Point> comb;
+  for (int i = 0; i < 20; ++i) {
+    comb.push_back({NumericType(2 * i), 0.});
+    comb.push_back({NumericType(2 * i + 1), 0.});
+    comb.push_back({NumericType(2 * i + 1), -5.});
+    comb.push_back({NumericType(2 * i + 2), -5.});
+  }
+  comb.push_back({40., 0.});
+  comb.push_back({40., 3.});
+  comb.push_back({20., 3.});
+  comb.push_back({0., 3.});
+  checkTriangulation(comb);
+
+  // curvilinear polygon with many vertices and holes in both orientations
+  std::vector<Point> curve;
+  const int numPoints = 5000;
+  for (int i = 0; i < numPoints; ++i) {
+    const NumericType phi = 2. * M_PI * i / numPoints;
+    const NumericType r = 10. + 3. * std::sin(37. * phi);
+    curve.push_back({r * std::cos(phi), r * std::sin(phi)});
+  }
+  std::vector<Point> hole = {{-2., -2.}, {2., -2.}, {2., 0.}, {-2., 0.}};
+  std::vector<Point> reversedHole = {{-1., 1.}, {-1., 2.}, {1., 2.}, {1., 1.}};
+  checkTriangulation(curve, {hole, reversedHole});
+
+  // self-intersecting polygons are rejected
+  impl::PolygonTriangulation<NumericType> bowTie(
+      {{0., 0.}, {1., 1.}, {1., 0.}, {0., 1.}});
+  VC_TEST_ASSERT(!bowTie.apply());
+}
+
+} // namespace viennacore
+
+int main() { VC_RUN_2D_TESTS }
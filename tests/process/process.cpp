@@ -1,10 +1,101 @@
+#include <geometries/psMakeTrench.hpp>
+#include <models/psSingleParticleProcess.hpp>
 #include <psProcess.hpp>
+#include <psToDiskMesh.hpp>
 #include <vcTestAsserts.hpp>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 namespace viennacore {
 
 using namespace viennaps;
 
+// Records the calls of the process and checks that deferred work is finished
+// before the next step starts.
+template <class NumericType, int D>
+class CountingCallback : public AdvectionCallback<NumericType, D> {
+public:
+  int preAdvectCalls = 0;
+  int postAdvectCalls = 0;
+  int deferredCalls = 0;
+  NumericType deferredTime = 0.;
+  bool deferredFinishedBeforePreAdvect = true;
+
+  bool applyPreAdvect(const NumericType) override {
+    if (deferredCalls != postAdvectCalls)
+      deferredFinishedBeforePreAdvect = false;
+    ++preAdvectCalls;
+    return true;
+  }
+
+  bool applyPostAdvect(const NumericType) override {
+    ++postAdvectCalls;
+    return true;
+  }
+
+  void applyPostAdvectDeferred(const NumericType advectionTime) override {
+    deferredTime += advectionTime;
+    ++deferredCalls;
+  }
+};
+
+// The pipelined schedule has to produce the same geometry and callback
+// sequence as the sequential one.
+template <class NumericType, int D> void RunPipelinedSteppingTest() {
+  const NumericType duration = 3.;
+  auto runProcess = [&](const bool pipelined) {
+    auto domain = SmartPointer<Domain<NumericType, D>>::New();
+    MakeTrench<NumericType, D>(domain, 1., 10., 10., 2.5, 5., 10., 1., false,
+                               true, Material::Si)
+        .apply();
+    auto model = SmartPointer<SingleParticleProcess<NumericType, D>>::New(
+        -1., 0.5, 1., Material::Mask);
+    auto callback = SmartPointer<CountingCallback<NumericType, D>>::New();
+    model->setAdvectionCallback(callback);
+
+    Process<NumericType, D> process(domain, model, duration);
+    process.setNumberOfRaysPerPoint(50);
+    process.disableRandomSeeds();
+    if (pipelined)
+      process.enablePipelinedStepping();
+    else
+      process.disablePipelinedStepping();
+    process.apply();
+    return std::make_pair(domain, callback);
+  };
+
+  auto [sequential, sequentialCallback] = runProcess(false);
+  auto [pipelined, pipelinedCallback] = runProcess(true);
+
+  VC_TEST_ASSERT(pipelinedCallback->preAdvectCalls > 1);
+  VC_TEST_ASSERT(pipelinedCallback->preAdvectCalls ==
+                 sequentialCallback->preAdvectCalls);
+  VC_TEST_ASSERT(pipelinedCallback->postAdvectCalls ==
+                 sequentialCallback->postAdvectCalls);
+  VC_TEST_ASSERT(pipelinedCallback->deferredCalls ==
+                 pipelinedCallback->postAdvectCalls);
+  VC_TEST_ASSERT(pipelinedCallback->deferredFinishedBeforePreAdvect);
+  VC_TEST_ASSERT(sequentialCallback->deferredFinishedBeforePreAdvect);
+  VC_TEST_ASSERT_ISCLOSE(pipelinedCallback->deferredTime, duration, 1e-4);
+  VC_TEST_ASSERT_ISCLOSE(sequentialCallback->deferredTime, duration, 1e-4);
+
+  // compare the final level sets by their surface points
+  auto mesh = SmartPointer<viennals::Mesh<NumericType>>::New();
+  auto refMesh = SmartPointer<viennals::Mesh<NumericType>>::New();
+  ToDiskMesh<NumericType, D>(pipelined, mesh).apply();
+  ToDiskMesh<NumericType, D>(sequential, refMesh).apply();
+  const auto &nodes = mesh->getNodes();
+  const auto &refNodes = refMesh->getNodes();
+  VC_TEST_ASSERT(!nodes.empty());
+  VC_TEST_ASSERT(nodes.size() == refNodes.size());
+  for (std::size_t i = 0; i < nodes.size(); ++i) {
+    for (int j = 0; j < D; ++j)
+      VC_TEST_ASSERT_ISCLOSE(nodes[i][j], refNodes[i][j], 1e-4);
+  }
+}
+
 template <class NumericType, int D> void RunTest() {
 
   auto domain = SmartPointer<Domain<NumericType, D>>::New();
@@ -14,8 +105,14 @@ template <class NumericType, int D> void RunTest() {
   { Process<NumericType, D> process; }
   { Process<NumericType, D> process(domain); }
   { Process<NumericType, D> process(domain, model, 0.); }
+
+  Logger::setLogLevel(LogLevel::WARNING);
+#ifdef _OPENMP
+  omp_set_num_threads(1);
+#endif
+  RunPipelinedSteppingTest<NumericType, D>();
 }
 
 } // namespace viennacore
 
-int main() { VC_RUN_ALL_TESTS }
\ No newline at end of file
+int main() { VC_RUN_ALL_TESTS }
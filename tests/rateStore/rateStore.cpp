@@ -0,0 +1,60 @@
+#include <psRayTracing.hpp>
+
+#include <vcTestAsserts.hpp>
+
+namespace viennacore {
+
+using namespace viennaps;
+
+// The rate store keeps the rates in the order in which the particle types are
+// traced and moves them into point data without a copy.
+template <class NumericType, int D> void RunTest() {
+  const std::size_t numPoints = 100;
+  auto constantRate = [&](const NumericType value) {
+    return std::vector<NumericType>(numPoints, value);
+  };
+
+  impl::RateStore<NumericType> store;
+  VC_TEST_ASSERT(store.insert(constantRate(1.), "rate0") == 0);
+  VC_TEST_ASSERT(store.insert(constantRate(2.), "rate1") == 1);
+
+  // the second batch of adaptive ray tracing
+  store.blend(0, constantRate(3.), 0.25);
+
+  // flux smoothing and similar post-processing
+  store.modify(1, [](std::vector<NumericType> &rate) {
+    for (auto &r : rate)
+      r *= NumericType(2.5);
+  });
+
+  // rates cached in the coverage initialization are copied, rates traced
+  // concurrently are moved
+  impl::RateStore<NumericType> cached;
+  cached.insert(constantRate(4.), "rate2");
+  store.append(cached);
+  VC_TEST_ASSERT(cached.size() == 1);
+
+  impl::RateStore<NumericType> concurrent;
+  concurrent.insert(constantRate(5.), "rate3");
+  store.append(std::move(concurrent));
+  VC_TEST_ASSERT(concurrent.size() == 0);
+
+  VC_TEST_ASSERT(store.size() == 4);
+  auto pointData = store.toPointData();
+  VC_TEST_ASSERT(store.size() == 0);
+  VC_TEST_ASSERT(pointData->getScalarDataSize() == 4);
+
+  const std::vector<NumericType> expected = {1.5, 5., 4., 5.};
+  for (int i = 0; i < 4; ++i) {
+    VC_TEST_ASSERT(pointData->getScalarDataLabel(i) ==
+                   "rate" + std::to_string(i));
+    const auto &rate = *pointData->getScalarData(i);
+    VC_TEST_ASSERT(rate.size() == numPoints);
+    for (const auto r : rate)
+      VC_TEST_ASSERT_ISCLOSE(r, expected[i], 1e-6);
+  }
+}
+
+} // namespace viennacore
+
+int main() { VC_RUN_ALL_TESTS }
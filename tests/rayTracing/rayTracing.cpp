@@ -0,0 +1,108 @@
+#include <models/psSingleParticleProcess.hpp>
+#include <psRayTracing.hpp>
+
+#include <vcTestAsserts.hpp>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace viennacore {
+
+using namespace viennaps;
+
+template <class NumericType, int D>
+void setupTracer(viennaray::Trace<NumericType, D> &tracer,
+                 const std::vector<Vec3D<NumericType>> &points,
+                 const std::vector<Vec3D<NumericType>> &normals,
+                 const NumericType gridDelta) {
+  viennaray::BoundaryCondition boundaryConditions[D];
+  for (int i = 0; i < D; ++i)
+    boundaryConditions[i] = viennaray::BoundaryCondition::REFLECTIVE;
+  tracer.setBoundaryConditions(boundaryConditions);
+  tracer.setSourceDirection(D == 3 ? viennaray::TraceDirection::POS_Z
+                                   : viennaray::TraceDirection::POS_Y);
+  tracer.setNumberOfRaysPerPoint(100);
+  tracer.setUseRandomSeeds(false);
+  tracer.setCalculateFlux(false);
+  tracer.setGeometry(points, normals, gridDelta);
+  tracer.setMaterialIds(std::vector<int>(points.size(), 0));
+}
+
+// Concurrent tracing gives the same rates as sequential tracing. Every tracer
+// seeds its random numbers from its own state and number of threads, so the
+// sequential reference uses a fresh tracer per particle type and both paths
+// trace with a single thread per particle type.
+template <class NumericType, int D> void RunTest() {
+#ifdef _OPENMP
+  omp_set_num_threads(1);
+#endif
+  const NumericType gridDelta = 1.;
+  std::vector<Vec3D<NumericType>> points;
+  std::vector<Vec3D<NumericType>> normals;
+  const int numY = D == 3 ? 10 : 1;
+  for (int j = 0; j < numY; ++j) {
+    for (int i = 0; i < 10; ++i) {
+      Vec3D<NumericType> point{i * gridDelta, 0., 0.};
+      Vec3D<NumericType> normal{0., 1., 0.};
+      if constexpr (D == 3) {
+        point[1] = j * gridDelta;
+        normal = {0., 0., 1.};
+      }
+      points.push_back(point);
+      normals.push_back(normal);
+    }
+  }
+
+  std::vector<std::unique_ptr<viennaray::AbstractParticle<NumericType>>>
+      particles;
+  particles.push_back(
+      std::make_unique<impl::SingleParticle<NumericType, D>>(1., 1.));
+  particles.push_back(
+      std::make_unique<impl::SingleParticle<NumericType, D>>(0.2, 100.));
+  const auto numParticles = particles.size();
+  AdaptiveRayTracingParameters<NumericType> adaptive;
+
+  impl::RateStore<NumericType> sequentialRates;
+  for (auto &particle : particles) {
+    viennaray::Trace<NumericType, D> tracer;
+    setupTracer(tracer, points, normals, gridDelta);
+    viennaray::DataLog<NumericType> dataLog;
+    impl::traceParticle(tracer, particle, points.size(), 100, adaptive, true,
+                        sequentialRates, dataLog, 0);
+  }
+
+  std::vector<std::unique_ptr<viennaray::Trace<NumericType, D>>> tracers;
+  std::vector<viennaray::Trace<NumericType, D> *> tracerPointers;
+  for (std::size_t i = 0; i < numParticles; ++i) {
+    tracers.push_back(std::make_unique<viennaray::Trace<NumericType, D>>());
+    setupTracer(*tracers.back(), points, normals, gridDelta);
+    tracerPointers.push_back(tracers.back().get());
+  }
+  std::vector<viennaray::DataLog<NumericType>> dataLogs(numParticles);
+  impl::RateStore<NumericType> concurrentRates;
+  const auto tracedRays = impl::traceParticlesConcurrently(
+      tracerPointers, particles, points.size(), 100, adaptive, true,
+      concurrentRates, dataLogs, std::vector<int>(numParticles, 0));
+  VC_TEST_ASSERT(tracedRays.size() == numParticles);
+  for (const auto rays : tracedRays)
+    VC_TEST_ASSERT(rays == 100 * points.size());
+
+  VC_TEST_ASSERT(sequentialRates.size() == numParticles);
+  VC_TEST_ASSERT(concurrentRates.size() == numParticles);
+  auto sequential = sequentialRates.toPointData();
+  auto concurrent = concurrentRates.toPointData();
+  for (std::size_t i = 0; i < numParticles; ++i) {
+    VC_TEST_ASSERT(sequential->getScalarDataLabel(i) ==
+                   concurrent->getScalarDataLabel(i));
+    const auto &expected = *sequential->getScalarData(i);
+    const auto &rate = *concurrent->getScalarData(i);
+    VC_TEST_ASSERT(rate.size() == points.size());
+    for (std::size_t j = 0; j < rate.size(); ++j)
+      VC_TEST_ASSERT_ISCLOSE(rate[j], expected[j], 1e-6);
+  }
+}
+
+} // namespace viennacore
+
+int main() { VC_RUN_ALL_TESTS }
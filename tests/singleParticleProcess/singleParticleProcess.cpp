@@ -24,7 +24,7 @@ template <class NumericType, int D> void RunTest() {
     VC_TEST_ASSERT(model->getSurfaceModel());
     VC_TEST_ASSERT(model->getVelocityField());
     VC_TEST_ASSERT(model->getVelocityField()->getTranslationFieldOptions() ==
-                   2);
+                   3);
     VC_TEST_ASSERT(model->getParticleTypes().size() == 1);
 
     Process<NumericType, D>(domain, model, 2.).apply();
@@ -47,7 +47,7 @@ template <class NumericType, int D> void RunTest() {
     VC_TEST_ASSERT(model->getSurfaceModel());
     VC_TEST_ASSERT(model->getVelocityField());
     VC_TEST_ASSERT(model->getVelocityField()->getTranslationFieldOptions() ==
-                   2);
+                   3);
     VC_TEST_ASSERT(model->getParticleTypes().size() == 1);
 
     Process<NumericType, D>(domain, model, 2.).apply();
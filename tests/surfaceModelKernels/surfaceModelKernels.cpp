@@ -0,0 +1,504 @@
+#include <models/psFluorocarbonEtching.hpp>
+#include <models/psSF6O2Etching.hpp>
+#include <vcTestAsserts.hpp>
+
+#include <random>
+
+namespace viennacore {
+
+using namespace viennaps;
+
+// The point-wise surface model kernels as they were before the vectorized
+// rewrite, which serve as the reference for the results.
+
+template <typename NumericType, int D>
+class ReferenceSF6O2SurfaceModel : public SurfaceModel<NumericType> {
+  using SurfaceModel<NumericType>::coverages;
+  const SF6O2Parameters<NumericType> &params;
+
+public:
+  ReferenceSF6O2SurfaceModel(const SF6O2Parameters<NumericType> &pParams)
+      : params(pParams) {}
+
+  void initializeCoverages(unsigned numGeometryPoints) override {
+    if (coverages == nullptr) {
+      coverages = SmartPointer<viennals::PointData<NumericType>>::New();
+    } else {
+      coverages->clear();
+    }
+    std::vector<NumericType> cov(numGeometryPoints);
+    coverages->insertNextScalarData(cov, "eCoverage");
+    coverages->insertNextScalarData(cov, "oCoverage");
+  }
+
+  SmartPointer<std::vector<NumericType>>
+  calculateVelocities(SmartPointer<viennals::PointData<NumericType>> rates,
+                      const std::vector<Vec3D<NumericType>> &coordinates,
+                      const std::vector<NumericType> &materialIds) override {
+    updateCoverages(rates, materialIds);
+    const auto numPoints = rates->getScalarData(0)->size();
+    std::vector<NumericType> etchRate(numPoints, 0.);
+
+    const auto ionEnhancedRate = rates->getScalarData("ionEnhancedRate");
+    const auto ionSputteringRate = rates->getScalarData("ionSputteringRate");
+    const auto etchantRate = rates->getScalarData("etchantRate");
+    const auto eCoverage = coverages->getScalarData("eCoverage");
+    const auto oCoverage = coverages->getScalarData("oCoverage");
+
+    bool stop = false;
+
+    for (size_t i = 0; i < numPoints; ++i) {
+      if (coordinates[i][D - 1] < params.etchStopDepth) {
+        stop = true;
+        break;
+      }
+
+      if (MaterialMap::isMaterial(materialIds[i], Material::Mask)) {
+        etchRate[i] =
+            -(1 / params.Mask.rho) * ionSputteringRate->at(i) * params.ionFlux;
+      } else {
+        etchRate[i] =
+            -(1 / params.Si.rho) * (params.Si.k_sigma * eCoverage->at(i) / 4. +
+                                    ionSputteringRate->at(i) * params.ionFlux +
+                                    eCoverage->at(i) * ionEnhancedRate->at(i) *
+                                        params.ionFlux); // in um / s
+      }
+    }
+
+    if (stop) {
+      std::fill(etchRate.begin(), etchRate.end(), 0.);
+      Logger::getInstance().addInfo("Etch stop depth reached.").print();
+    }
+
+    return SmartPointer<std::vector<NumericType>>::New(std::move(etchRate));
+  }
+
+  void updateCoverages(SmartPointer<viennals::PointData<NumericType>> rates,
+                       const std::vector<NumericType> &materialIds) override {
+    // update coverages based on fluxes
+    const auto numPoints = rates->getScalarData(0)->size();
+
+    const auto etchantRate = rates->getScalarData("etchantRate");
+    const auto ionEnhancedRate = rates->getScalarData("ionEnhancedRate");
+    const auto oxygenRate = rates->getScalarData("oxygenRate");
+    const auto oxygenSputteringRate =
+        rates->getScalarData("oxygenSputteringRate");
+
+    // etchant fluorine coverage
+    auto eCoverage = coverages->getScalarData("eCoverage");
+    eCoverage->resize(numPoints);
+    // oxygen coverage
+    auto oCoverage = coverages->getScalarData("oCoverage");
+    oCoverage->resize(numPoints);
+    for (size_t i = 0; i < numPoints; ++i) {
+      if (etchantRate->at(i) < 1e-6) {
+        eCoverage->at(i) = 0;
+      } else {
+        eCoverage->at(i) =
+            etchantRate->at(i) * params.etchantFlux * params.beta_F /
+            (etchantRate->at(i) * params.etchantFlux * params.beta_F +
+             (params.Si.k_sigma + 2 * ionEnhancedRate->at(i) * params.ionFlux) *
+                 (1 + (oxygenRate->at(i) * params.oxygenFlux * params.beta_O) /
+                          (params.Si.beta_sigma +
+                           oxygenSputteringRate->at(i) * params.ionFlux)));
+      }
+
+      if (oxygenRate->at(i) < 1e-6) {
+        oCoverage->at(i) = 0;
+      } else {
+        oCoverage->at(i) =
+            oxygenRate->at(i) * params.oxygenFlux * params.beta_O /
+            (oxygenRate->at(i) * params.oxygenFlux * params.beta_O +
+             (params.Si.beta_sigma +
+              oxygenSputteringRate->at(i) * params.ionFlux) *
+                 (1 +
+                  (etchantRate->at(i) * params.etchantFlux * params.beta_F) /
+                      (params.Si.k_sigma +
+                       2 * ionEnhancedRate->at(i) * params.ionFlux)));
+      }
+    }
+  }
+};
+
+template <typename NumericType, int D>
+class ReferenceFluorocarbonSurfaceModel : public SurfaceModel<NumericType> {
+  using SurfaceModel<NumericType>::coverages;
+  static constexpr double eps = 1e-6;
+  const FluorocarbonParameters<NumericType> &p;
+
+public:
+  ReferenceFluorocarbonSurfaceModel(
+      const FluorocarbonParameters<NumericType> &parameters)
+      : p(parameters) {}
+
+  void initializeCoverages(unsigned numGeometryPoints) override {
+    if (coverages == nullptr) {
+      coverages = SmartPointer<viennals::PointData<NumericType>>::New();
+    } else {
+      coverages->clear();
+    }
+    std::vector<NumericType> cov(numGeometryPoints);
+    coverages->insertNextScalarData(cov, "eCoverage");
+    coverages->insertNextScalarData(cov, "pCoverage");
+    coverages->insertNextScalarData(cov, "peCoverage");
+  }
+
+  SmartPointer<std::vector<NumericType>>
+  calculateVelocities(SmartPointer<viennals::PointData<NumericType>> rates,
+                      const std::vector<Vec3D<NumericType>> &coordinates,
+                      const std::vector<NumericType> &materialIds) override {
+    updateCoverages(rates, materialIds);
+    const auto numPoints = materialIds.size();
+    std::vector<NumericType> etchRate(numPoints, 0.);
+
+    // inserted first, since the insertion might move the other rates
+    rates->insertNextScalarData(etchRate, "F_ev");
+    auto ionEnhancedRate = rates->getScalarData("ionEnhancedRate");
+    auto ionSputteringRate = rates->getScalarData("ionSputteringRate");
+    auto ionpeRate = rates->getScalarData("ionpeRate");
+    auto polyRate = rates->getScalarData("polyRate");
+    auto F_ev_rate = rates->getScalarData("F_ev");
+
+    const auto eCoverage = coverages->getScalarData("eCoverage");
+    const auto pCoverage = coverages->getScalarData("pCoverage");
+    const auto peCoverage = coverages->getScalarData("peCoverage");
+
+    bool etchStop = false;
+
+    // calculate etch rates
+    for (std::size_t i = 0; i < numPoints; ++i) {
+      if (coordinates[i][D - 1] <= p.etchStopDepth) {
+        etchStop = true;
+        break;
+      }
+
+      auto matId = MaterialMap::mapToMaterial(materialIds[i]);
+      if (matId == Material::Mask) {
+        etchRate[i] = (-1. / p.Mask.rho) * ionSputteringRate->at(i) * p.ionFlux;
+      } else if (pCoverage->at(i) >= 1.) {
+        // Deposition
+        etchRate[i] =
+            (1 / p.Polymer.rho) *
+            std::max((polyRate->at(i) * p.polyFlux * p.beta_p -
+                      ionpeRate->at(i) * p.ionFlux * peCoverage->at(i)),
+                     (NumericType)0);
+        assert(etchRate[i] >= 0 && "Negative deposition");
+      } else if (matId == Material::Polymer) {
+        // Etching depo layer
+        etchRate[i] =
+            std::min((1 / p.Polymer.rho) *
+                         (polyRate->at(i) * p.polyFlux * p.beta_p -
+                          ionpeRate->at(i) * p.ionFlux * peCoverage->at(i)),
+                     (NumericType)0);
+      } else {
+        NumericType density = 1.;
+        NumericType F_ev = 0.;
+        switch (matId) {
+        case Material::Si: {
+
+          density = -p.Si.rho;
+          F_ev = p.Si.K * p.etchantFlux *
+                 std::exp(-p.Si.E_a / (FluorocarbonParameters<NumericType>::kB *
+                                       p.temperature));
+          break;
+        }
+        case Material::SiO2: {
+
+          F_ev =
+              p.SiO2.K * p.etchantFlux *
+              std::exp(-p.SiO2.E_a / (FluorocarbonParameters<NumericType>::kB *
+                                      p.temperature));
+          density = -p.SiO2.rho;
+          break;
+        }
+        case Material::Si3N4: {
+
+          F_ev =
+              p.Si3N4.K * p.etchantFlux *
+              std::exp(-p.Si3N4.E_a / (FluorocarbonParameters<NumericType>::kB *
+                                       p.temperature));
+          density = -p.Si3N4.rho;
+          break;
+        }
+        default:
+          break;
+        }
+
+        etchRate[i] =
+            (1 / density) *
+            (F_ev * eCoverage->at(i) +
+             ionEnhancedRate->at(i) * p.ionFlux * eCoverage->at(i) +
+             ionSputteringRate->at(i) * p.ionFlux * (1. - eCoverage->at(i)));
+
+        F_ev_rate->at(i) = F_ev * eCoverage->at(i);
+        ionSputteringRate->at(i) =
+            ionSputteringRate->at(i) * p.ionFlux * (1. - eCoverage->at(i));
+        ionEnhancedRate->at(i) =
+            ionEnhancedRate->at(i) * p.ionFlux * eCoverage->at(i);
+      }
+
+      // etch rate is in nm / s
+
+      assert(!std::isnan(etchRate[i]) && "etchRate NaN");
+    }
+
+    if (etchStop) {
+      std::fill(etchRate.begin(), etchRate.end(), 0.);
+      Logger::getInstance().addInfo("Etch stop depth reached.").print();
+    }
+
+    return SmartPointer<std::vector<NumericType>>::New(etchRate);
+  }
+
+  void updateCoverages(SmartPointer<viennals::PointData<NumericType>> rates,
+                       const std::vector<NumericType> &materialIds) override {
+
+    const auto ionEnhancedRate = rates->getScalarData("ionEnhancedRate");
+    const auto ionpeRate = rates->getScalarData("ionpeRate");
+    const auto polyRate = rates->getScalarData("polyRate");
+    const auto etchantRate = rates->getScalarData("etchantRate");
+
+    const auto eCoverage = coverages->getScalarData("eCoverage");
+    const auto pCoverage = coverages->getScalarData("pCoverage");
+    const auto peCoverage = coverages->getScalarData("peCoverage");
+
+    // update coverages based on fluxes
+    const auto numPoints = ionEnhancedRate->size();
+    eCoverage->resize(numPoints);
+    pCoverage->resize(numPoints);
+    peCoverage->resize(numPoints);
+
+    // pe coverage
+    for (std::size_t i = 0; i < numPoints; ++i) {
+      if (etchantRate->at(i) == 0.) {
+        peCoverage->at(i) = 0.;
+      } else {
+        peCoverage->at(i) = (etchantRate->at(i) * p.etchantFlux * p.beta_pe) /
+                            (etchantRate->at(i) * p.etchantFlux * p.beta_pe +
+                             ionpeRate->at(i) * p.ionFlux);
+      }
+      assert(!std::isnan(peCoverage->at(i)) && "peCoverage NaN");
+    }
+
+    // polymer coverage
+    for (std::size_t i = 0; i < numPoints; ++i) {
+      if (polyRate->at(i) < eps) {
+        pCoverage->at(i) = 0.;
+      } else if (peCoverage->at(i) < eps || ionpeRate->at(i) < eps) {
+        pCoverage->at(i) = 1.;
+      } else {
+        pCoverage->at(i) =
+            (polyRate->at(i) * p.polyFlux * p.beta_p) /
+            (ionpeRate->at(i) * p.ionFlux * peCoverage->at(i) + p.delta_p);
+      }
+      assert(!std::isnan(pCoverage->at(i)) && "pCoverage NaN");
+    }
+
+    // etchant coverage
+    for (std::size_t i = 0; i < numPoints; ++i) {
+      if (pCoverage->at(i) < 1.) {
+        if (etchantRate->at(i) == 0.) {
+          eCoverage->at(i) = 0;
+        } else {
+          NumericType F_ev = 0.;
+          switch (MaterialMap::mapToMaterial(materialIds[i])) {
+          case Material::Si:
+            F_ev =
+                p.Si.K * p.etchantFlux *
+                std::exp(-p.Si.E_a / (FluorocarbonParameters<NumericType>::kB *
+                                      p.temperature));
+            break;
+          case Material::SiO2:
+            F_ev = p.SiO2.K * p.etchantFlux *
+                   std::exp(-p.SiO2.E_a /
+                            (FluorocarbonParameters<NumericType>::kB *
+                             p.temperature));
+            break;
+          case Material::Si3N4:
+            F_ev = p.Si3N4.K * p.etchantFlux *
+                   std::exp(-p.Si3N4.E_a /
+                            (FluorocarbonParameters<NumericType>::kB *
+                             p.temperature));
+            break;
+          default:
+            F_ev = 0.;
+          }
+          eCoverage->at(i) =
+              (etchantRate->at(i) * p.etchantFlux * p.beta_e *
+               (1. - pCoverage->at(i))) /
+              (p.k_ie * ionEnhancedRate->at(i) * p.ionFlux + p.k_ev * F_ev +
+               etchantRate->at(i) * p.etchantFlux * p.beta_e);
+        }
+      } else {
+        eCoverage->at(i) = 0.;
+      }
+      assert(!std::isnan(eCoverage->at(i)) && "eCoverage NaN");
+    }
+  }
+};
+
+template <class NumericType> struct SurfaceData {
+  std::vector<Vec3D<NumericType>> coordinates;
+  std::vector<NumericType> materialIds;
+  SmartPointer<viennals::PointData<NumericType>> rates;
+};
+
+// Random surface points in the unit cube. Each rate is zero on a fifth of
+// the points, which covers the zero flux cases of the models.
+template <class NumericType>
+SurfaceData<NumericType>
+generateSurfaceData(const unsigned numPoints,
+                    const std::vector<std::string> &rateLabels,
+                    const std::vector<Material> &materials) {
+  SurfaceData<NumericType> data;
+  std::mt19937_64 rng(42);
+  std::uniform_real_distribution<NumericType> uniform(0., 1.);
+  std::uniform_int_distribution<std::size_t> material(0, materials.size() - 1);
+
+  data.coordinates.resize(numPoints);
+  data.materialIds.resize(numPoints);
+  for (unsigned i = 0; i < numPoints; ++i) {
+    for (int j = 0; j < 3; ++j)
+      data.coordinates[i][j] = uniform(rng);
+    data.materialIds[i] = static_cast<NumericType>(materials[material(rng)]);
+  }
+
+  data.rates = SmartPointer<viennals::PointData<NumericType>>::New();
+  for (const auto &label : rateLabels) {
+    std::vector<NumericType> rate(numPoints);
+    for (auto &r : rate)
+      r = uniform(rng) < 0.2 ? 0. : uniform(rng);
+    data.rates->insertNextScalarData(std::move(rate), label);
+  }
+  return data;
+}
+
+template <class NumericType>
+void compareData(const std::vector<NumericType> &result,
+                 const std::vector<NumericType> &reference) {
+  const NumericType tolerance =
+      std::is_same_v<NumericType, float> ? 1e-5 : 1e-12;
+  VC_TEST_ASSERT(result.size() == reference.size());
+  for (std::size_t i = 0; i < result.size(); ++i) {
+    VC_TEST_ASSERT(!std::isnan(result[i]));
+    const NumericType scale =
+        std::max({std::abs(result[i]), std::abs(reference[i]), NumericType(1)});
+    VC_TEST_ASSERT_ISCLOSE(result[i], reference[i], tolerance * scale);
+  }
+}
+
+// Runs both models on copies of the same rates and compares the velocities,
+// the coverages and the rates, which the models modify. The reference
+// modifies the rates only partially if the etch stop depth is reached, so
+// they are only compared without an etch stop.
+template <class NumericType, int D, class Model, class Reference>
+void compareModels(Model &model, Reference &reference,
+                   const SurfaceData<NumericType> &data,
+                   const std::vector<std::string> &coverageLabels,
+                   const bool compareRates = true) {
+  const auto numPoints = data.materialIds.size();
+  auto rates = SmartPointer<viennals::PointData<NumericType>>::New(*data.rates);
+  auto refRates =
+      SmartPointer<viennals::PointData<NumericType>>::New(*data.rates);
+
+  model.initializeCoverages(numPoints);
+  reference.initializeCoverages(numPoints);
+  auto velocities =
+      model.calculateVelocities(rates, data.coordinates, data.materialIds);
+  auto refVelocities = reference.calculateVelocities(
+      refRates, data.coordinates, data.materialIds);
+
+  compareData(*velocities, *refVelocities);
+  for (const auto &label : coverageLabels)
+    compareData(*model.getCoverages()->getScalarData(label),
+                *reference.getCoverages()->getScalarData(label));
+  VC_TEST_ASSERT(rates->getScalarDataSize() == refRates->getScalarDataSize());
+  if (!compareRates)
+    return;
+  for (unsigned i = 0; i < refRates->getScalarDataSize(); ++i) {
+    const auto label = refRates->getScalarDataLabel(i);
+    compareData(*rates->getScalarData(label), *refRates->getScalarData(i));
+  }
+}
+
+template <class NumericType, int D> void RunSF6O2Test() {
+  SF6O2Parameters<NumericType> params;
+  auto data = generateSurfaceData<NumericType>(
+      1000,
+      {"ionSputteringRate", "ionEnhancedRate", "oxygenSputteringRate",
+       "etchantRate", "oxygenRate"},
+      {Material::Mask, Material::Si, Material::SiO2});
+  impl::SF6O2SurfaceModel<NumericType, D> model(params);
+  ReferenceSF6O2SurfaceModel<NumericType, D> reference(params);
+  compareModels<NumericType, D>(model, reference, data,
+                                {"eCoverage", "oCoverage"});
+
+  // all points stop etching once one of them reaches the etch stop depth
+  params.etchStopDepth = 0.5;
+  compareModels<NumericType, D>(model, reference, data,
+                                {"eCoverage", "oCoverage"}, false);
+  auto rates = SmartPointer<viennals::PointData<NumericType>>::New(*data.rates);
+  auto velocities =
+      model.calculateVelocities(rates, data.coordinates, data.materialIds);
+  for (const auto v : *velocities)
+    VC_TEST_ASSERT(v == 0.);
+}
+
+template <class NumericType, int D> void RunFluorocarbonTest() {
+  FluorocarbonParameters<NumericType> params;
+  auto data = generateSurfaceData<NumericType>(
+      1000,
+      {"ionSputteringRate", "ionEnhancedRate", "ionpeRate", "etchantRate",
+       "polyRate"},
+      {Material::Mask, Material::Si, Material::SiO2, Material::Si3N4,
+       Material::Polymer, Material::GaN});
+  impl::FluorocarbonSurfaceModel<NumericType, D> model(params);
+  ReferenceFluorocarbonSurfaceModel<NumericType, D> reference(params);
+  compareModels<NumericType, D>(model, reference, data,
+                                {"eCoverage", "pCoverage", "peCoverage"});
+
+  // make sure all branches of the kernels are covered by the random data
+  const auto &pCoverage = *model.getCoverages()->getScalarData("pCoverage");
+  const auto &etchantRate = *data.rates->getScalarData("etchantRate");
+  unsigned numMask = 0, numDeposition = 0, numPolymer = 0, numSubstrate = 0,
+           numNoEtchant = 0;
+  for (std::size_t i = 0; i < data.materialIds.size(); ++i) {
+    const auto material = MaterialMap::mapToMaterial(data.materialIds[i]);
+    if (material == Material::Mask)
+      ++numMask;
+    else if (pCoverage[i] >= 1.)
+      ++numDeposition;
+    else if (material == Material::Polymer)
+      ++numPolymer;
+    else
+      ++numSubstrate;
+    if (etchantRate[i] == 0.)
+      ++numNoEtchant;
+  }
+  VC_TEST_ASSERT(numMask > 0);
+  VC_TEST_ASSERT(numDeposition > 0);
+  VC_TEST_ASSERT(numPolymer > 0);
+  VC_TEST_ASSERT(numSubstrate > 0);
+  VC_TEST_ASSERT(numNoEtchant > 0);
+
+  // all points stop etching once one of them reaches the etch stop depth
+  params.etchStopDepth = 0.5;
+  compareModels<NumericType, D>(model, reference, data,
+                                {"eCoverage", "pCoverage", "peCoverage"},
+                                false);
+  auto rates = SmartPointer<viennals::PointData<NumericType>>::New(*data.rates);
+  auto velocities =
+      model.calculateVelocities(rates, data.coordinates, data.materialIds);
+  for (const auto v : *velocities)
+    VC_TEST_ASSERT(v == 0.);
+}
+
+template <class NumericType, int D> void RunTest() {
+  Logger::setLogLevel(LogLevel::WARNING);
+  RunSF6O2Test<NumericType, D>();
+  RunFluorocarbonTest<NumericType, D>();
+}
+
+} // namespace viennacore
+
+int main() { VC_RUN_ALL_TESTS }
@@ -0,0 +1,80 @@
+#include <geometries/psMakeStack.hpp>
+#include <psDomain.hpp>
+#include <psToDiskMesh.hpp>
+
+#include <lsBooleanOperation.hpp>
+#include <lsToDiskMesh.hpp>
+
+#include <vcTestAsserts.hpp>
+
+#include <unordered_map>
+
+namespace viennacore {
+
+using namespace viennaps;
+
+// Compare the disk mesh and translator with the ones of viennals::ToDiskMesh.
+template <class NumericType, int D>
+void compareWithReference(SmartPointer<Domain<NumericType, D>> domain,
+                          SmartPointer<viennals::Mesh<NumericType>> mesh,
+                          SmartPointer<Translator> translator) {
+  auto refMesh = SmartPointer<viennals::Mesh<NumericType>>::New();
+  auto refTranslator =
+      SmartPointer<std::unordered_map<unsigned long, unsigned long>>::New();
+  viennals::ToDiskMesh<NumericType, D> refConverter(refMesh);
+  for (const auto &ls : domain->getLevelSets())
+    refConverter.insertNextLevelSet(ls);
+  refConverter.setMaterialMap(domain->getMaterialMap()->getMaterialMap());
+  refConverter.setTranslator(refTranslator);
+  refConverter.apply();
+
+  const auto &nodes = mesh->getNodes();
+  const auto &refNodes = refMesh->getNodes();
+  VC_TEST_ASSERT(nodes.size() > 0);
+  VC_TEST_ASSERT(nodes.size() == refNodes.size());
+
+  const auto &normals = *mesh->getCellData().getVectorData("Normals");
+  const auto &refNormals = *refMesh->getCellData().getVectorData("Normals");
+  const auto &materialIds = *mesh->getCellData().getScalarData("MaterialIds");
+  const auto &refMaterialIds =
+      *refMesh->getCellData().getScalarData("MaterialIds");
+  for (std::size_t i = 0; i < nodes.size(); ++i) {
+    for (int j = 0; j < 3; ++j) {
+      VC_TEST_ASSERT_ISCLOSE(nodes[i][j], refNodes[i][j], 1e-4);
+      VC_TEST_ASSERT_ISCLOSE(normals[i][j], refNormals[i][j], 1e-4);
+    }
+    VC_TEST_ASSERT(materialIds[i] == refMaterialIds[i]);
+  }
+
+  VC_TEST_ASSERT(translator->size() == refTranslator->size());
+  for (const auto &entry : *refTranslator)
+    VC_TEST_ASSERT(translator->find(entry.first) == entry.second);
+}
+
+template <class NumericType, int D> void RunTest() {
+  // a trench through a stack of alternating materials
+  auto domain = SmartPointer<Domain<NumericType, D>>::New();
+  MakeStack<NumericType, D>(domain, 1., 20., 20., 3, 2., 2., 0., 6., 2.)
+      .apply();
+  VC_TEST_ASSERT(domain->getLevelSets().size() > 2);
+
+  auto mesh = SmartPointer<viennals::Mesh<NumericType>>::New();
+  auto translator = SmartPointer<Translator>::New();
+  ToDiskMesh<NumericType, D> converter(domain, mesh, translator);
+  converter.apply();
+  compareWithReference(domain, mesh, translator);
+
+  // changing a lower Level-Set in place changes the materials on the surface,
+  // which a second call of the same converter picks up
+  auto &levelSets = domain->getLevelSets();
+  viennals::BooleanOperation<NumericType, D>(
+      levelSets.front(), levelSets.back(),
+      viennals::BooleanOperationEnum::UNION)
+      .apply();
+  converter.apply();
+  compareWithReference(domain, mesh, translator);
+}
+
+} // namespace viennacore
+
+int main() { VC_RUN_ALL_TESTS }
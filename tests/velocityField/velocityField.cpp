@@ -0,0 +1,170 @@
+#include <models/psAnisotropicProcess.hpp>
+#include <models/psDirectionalEtching.hpp>
+#include <models/psIsotropicProcess.hpp>
+#include <models/psMultiRateProcess.hpp>
+
+#include <psTranslationField.hpp>
+
+#include <vcTestAsserts.hpp>
+
+#include <random>
+
+namespace viennacore {
+
+using namespace viennaps;
+
+template <class NumericType> struct Points {
+  std::vector<Vec3D<NumericType>> coordinates;
+  std::vector<int> materials;
+  std::vector<Vec3D<NumericType>> normals;
+  std::vector<unsigned long> pointIds;
+};
+
+// The batched velocities are the same as the per-point velocities.
+template <class NumericType>
+void compareScalar(VelocityField<NumericType> &field,
+                   const Points<NumericType> &points) {
+  std::vector<NumericType> velocities;
+  field.getScalarVelocities(points.coordinates, points.materials,
+                            points.normals, points.pointIds, velocities);
+  VC_TEST_ASSERT(velocities.size() == points.coordinates.size());
+  for (std::size_t i = 0; i < velocities.size(); ++i) {
+    const auto velocity =
+        field.getScalarVelocity(points.coordinates[i], points.materials[i],
+                                points.normals[i], points.pointIds[i]);
+    VC_TEST_ASSERT(velocities[i] == velocity);
+  }
+}
+
+template <class NumericType>
+void compareVector(VelocityField<NumericType> &field,
+                   const Points<NumericType> &points) {
+  std::vector<Vec3D<NumericType>> velocities;
+  field.getVectorVelocities(points.coordinates, points.materials,
+                            points.normals, points.pointIds, velocities);
+  VC_TEST_ASSERT(velocities.size() == points.coordinates.size());
+  for (std::size_t i = 0; i < velocities.size(); ++i) {
+    const auto velocity =
+        field.getVectorVelocity(points.coordinates[i], points.materials[i],
+                                points.normals[i], points.pointIds[i]);
+    VC_TEST_ASSERT(velocities[i] == velocity);
+  }
+}
+
+template <class NumericType, int D> void RunTest() {
+  const std::size_t numPoints = 1000;
+  const std::size_t numSurfacePoints = 500;
+  std::mt19937 rng(42);
+  std::uniform_real_distribution<NumericType> uniform(-1., 1.);
+  // includes IDs which are not a material
+  std::uniform_int_distribution<int> material(-2, MaterialMap::numMaterials);
+  // includes IDs without a surface point
+  std::uniform_int_distribution<unsigned long> pointId(0,
+                                                       numSurfacePoints + 10);
+
+  Points<NumericType> points;
+  for (std::size_t i = 0; i < numPoints; ++i) {
+    Vec3D<NumericType> coordinate{0., 0., 0.};
+    Vec3D<NumericType> normal{0., 0., 0.};
+    for (int j = 0; j < D; ++j) {
+      coordinate[j] = uniform(rng);
+      normal[j] = uniform(rng);
+    }
+    Normalize(normal);
+    points.coordinates.push_back(coordinate);
+    points.materials.push_back(material(rng));
+    points.normals.push_back(normal);
+    points.pointIds.push_back(pointId(rng));
+  }
+  points.pointIds.back() = Translator::invalidId;
+
+  auto surfaceVelocities =
+      SmartPointer<std::vector<NumericType>>::New(numSurfacePoints);
+  for (auto &velocity : *surfaceVelocities)
+    velocity = uniform(rng);
+
+  {
+    DefaultVelocityField<NumericType> field;
+    field.setVelocities(surfaceVelocities);
+    compareScalar(field, points);
+
+    // points without a surface point are not moved
+    std::vector<NumericType> velocities;
+    field.getScalarVelocities(points.coordinates, points.materials,
+                              points.normals, points.pointIds, velocities);
+    for (std::size_t i = 0; i < numPoints; ++i) {
+      if (points.pointIds[i] >= numSurfacePoints) {
+        VC_TEST_ASSERT(velocities[i] == 0.);
+      } else {
+        VC_TEST_ASSERT(velocities[i] ==
+                       (*surfaceVelocities)[points.pointIds[i]]);
+      }
+    }
+  }
+
+  {
+    impl::IsotropicVelocityField<NumericType, D> field(
+        -1., MaterialMask{Material::Mask, Material::SiO2});
+    compareScalar(field, points);
+  }
+
+  {
+    impl::DirectionalEtchVelocityField<NumericType, D> field(
+        {0., 0., -1.}, 1., 0.1, MaterialMask{Material::Mask});
+    compareVector(field, points);
+  }
+
+  {
+    impl::AnisotropicVelocityField<NumericType, D> field(
+        {0.707106781187, 0.707106781187, 0.},
+        {-0.707106781187, 0.707106781187, 0.}, 0.0166666666667,
+        0.0309166666667, 0.000121666666667, 0.0300166666667,
+        {{Material::Si, 1.}, {Material::SiGe, 0.5}});
+    compareScalar(field, points);
+  }
+
+  {
+    impl::MultiRateVelocityField<NumericType, D> field;
+    field.setIsotropicRate(Material::Si, -0.5);
+    field.addDirectionalRate(Material::Si, {0., 0., -1.}, 1.);
+    field.addDirectionalRate(Material::SiO2, {1., 0., 0.}, 0.2);
+    compareScalar(field, points);
+    compareVector(field, points);
+  }
+
+  // the batched translation gives the same IDs as the per-point translation,
+  // Level-Set points without a surface point are not moved
+  {
+    // the failed translations are expected
+    Logger::setLogLevel(LogLevel::ERROR);
+    auto translator = SmartPointer<Translator>::New(numPoints);
+    for (unsigned long i = 0; i < numSurfacePoints; ++i)
+      translator->insert(2 * i, i);
+
+    auto velocityField = SmartPointer<DefaultVelocityField<NumericType>>::New();
+    velocityField->setVelocities(surfaceVelocities);
+    TranslationField<NumericType> field(velocityField, nullptr);
+    field.setTranslator(translator);
+
+    std::vector<unsigned long> lsIds(numPoints);
+    for (unsigned long i = 0; i < numPoints; ++i)
+      lsIds[i] = i;
+    std::vector<NumericType> velocities;
+    field.getScalarVelocities(points.coordinates, points.materials,
+                              points.normals, lsIds, velocities);
+    VC_TEST_ASSERT(velocities.size() == numPoints);
+    for (std::size_t i = 0; i < numPoints; ++i) {
+      const auto velocity =
+          field.getScalarVelocity(points.coordinates[i], points.materials[i],
+                                  points.normals[i], lsIds[i]);
+      VC_TEST_ASSERT(velocities[i] == velocity);
+      const auto expected =
+          i % 2 == 0 ? (*surfaceVelocities)[i / 2] : NumericType(0.);
+      VC_TEST_ASSERT(velocities[i] == expected);
+    }
+  }
+}
+
+} // namespace viennacore
+
+int main() { VC_RUN_ALL_TESTS }